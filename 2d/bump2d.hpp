@@ -1,35 +1,36 @@
 #pragma once
 
-#include <algorithm>
-#include <limits.h>
-#include <map>
-#include <math.h>
-#include <set>
-#include <vector>
+#include "../common/bump.hpp"
+#include "../common/bump_fixed.hpp"
 
-namespace bump2d
-{
-
-#define UNUSED(x) (void)(x)
-#define MATH_HUGE HUGE_VAL
-
-#define Touch  1
-#define Cross  2
-#define Slide  3
-#define Bounce 4
-
-#define DELTA   1e-10 // -- floating-point margin of error
-#define iabs(a) ((a >= 0) ? a : -a)
+//-- 2D face of the shared bump::World<N> core: axis 0 is x, axis 1 is y.
 
-static double sign(double x)
+namespace bump2d
 {
-    return (x > 0) ? 1 : ((x == 0) ? 0 : -1);
-}
+using bump::BounceFilter;
+using bump::Cell;
+using bump::ColFilter;
+using bump::CrossFilter;
+using bump::ItemFilter;
+using bump::SlideFilter;
+using bump::TouchFilter;
+using bump::VisitedFilter;
+#ifdef BUMP_COUNTERS
+using bump::Counters;
+#endif
+
+typedef bump::Collision<2> Collision;
+typedef bump::ItemInfo<2> ItemInfo;
+typedef bump::Response<2> Response;
+typedef bump::FixedCollision<2> FixedCollision;
+typedef bump::FixedWorld<2> FixedWorld;
 
-static double nearest(double x, double a, double b)
-{
-    return fabs(a - x) < fabs(b - x) ? a : b;
-}
+struct Point {
+    double x, y;
+};
+struct Rect {
+    double x, y, w, h;
+};
 
 /*
 ------------------------------------------
@@ -37,91 +38,37 @@ static double nearest(double x, double a, double b)
 ------------------------------------------
  */
 
-static void rect_getNearestCorner(double x, double y, double w, double h,
-                                  double px, double py, double &nx, double &ny)
+static inline void rect_getNearestCorner(double x, double y, double w,
+                                         double h, double px, double py,
+                                         double &nx, double &ny)
 {
-    nx = nearest(px, x, x + w);
-    ny = nearest(py, y, y + h);
+    double pos[2] = {x, y}, size[2] = {w, h}, p[2] = {px, py}, n[2];
+    bump::box_getNearestCorner<2>(pos, size, p, n);
+    nx = n[0];
+    ny = n[1];
 }
 
-/*-- This is a generalized implementation of the liang-barsky algorithm, which
- also returns
- -- the normals of the sides where the segment intersects.
- -- Returns nil if the segment never touches the rect
- -- Notice that normals are only guaranteed to be accurate when initially ti1,
- ti2 == -math.huge, math.huge
- */
-static bool rect_getSegmentIntersectionIndices(double x, double y, double w,
-                                               double h, double x1, double y1,
-                                               double x2, double y2,
-                                               double &ti1, double &ti2,
-                                               double &nx1, double &ny1,
-                                               double &nx2, double &ny2)
+static inline bool rect_getSegmentIntersectionIndices(
+    double x, double y, double w, double h, double x1, double y1, double x2,
+    double y2, double &ti1, double &ti2, double &nx1, double &ny1, double &nx2,
+    double &ny2)
 {
-    double dx = x2 - x1;
-    double dy = y2 - y1;
-    double nx, ny;
-    double p, q, r;
-    nx1 = nx2 = ny1 = ny2 = 0;
-
-    for (int side = 1; side <= 4; side++) {
-        switch (side) {
-        case 1:
-            nx = -1;
-            ny = 0;
-            p  = -dx;
-            q  = x1 - x;
-            break; //-- left
-        case 2:
-            nx = 1;
-            ny = 0;
-            p  = dx;
-            q  = x + w - x1;
-            break; //-- right
-        case 3:
-            nx = 0;
-            ny = -1;
-            p  = -dy;
-            q  = y1 - y;
-            break; //-- top
-        case 4:
-            nx = 0;
-            ny = 1;
-            p  = dy;
-            q  = y + h - y1;
-            break; //-- bottom
-        }
-        if (p == 0) {
-            if (q <= 0)
-                return false;
-        } else {
-            r = q / p;
-            if (p < 0) {
-                if (r > ti2)
-                    return false;
-                if (r > ti1) {
-                    ti1 = r;
-                    nx1 = nx;
-                    ny1 = ny;
-                }
-            } else { //-- p > 0
-                if (r < ti1)
-                    return false;
-                if (r < ti2) {
-                    ti2 = r;
-                    nx2 = nx;
-                    ny2 = ny;
-                }
-            }
-        }
-    }
-    return true;
+    double pos[2] = {x, y}, size[2] = {w, h};
+    double p1[2] = {x1, y1}, p2[2] = {x2, y2};
+    double n1[2], n2[2];
+    bool hit = bump::box_getSegmentIntersectionIndices<2>(pos, size, p1, p2,
+                                                          ti1, ti2, n1, n2);
+    nx1 = n1[0];
+    ny1 = n1[1];
+    nx2 = n2[0];
+    ny2 = n2[1];
+    return hit;
 }
 
 //-- Calculates the minkowsky difference between 2 rects, which is another rect
-static void rect_getDiff(double x1, double y1, double w1, double h1, double x2,
-                         double y2, double w2, double h2, double &rx,
-                         double &ry, double &rw, double &rh)
+static inline void rect_getDiff(double x1, double y1, double w1, double h1,
+                                double x2, double y2, double w2, double h2,
+                                double &rx, double &ry, double &rw, double &rh)
 {
     rx = x2 - x1 - w1;
     ry = y2 - y1 - h1;
@@ -129,978 +76,376 @@ static void rect_getDiff(double x1, double y1, double w1, double h1, double x2,
     rh = h1 + h2;
 }
 
-static bool rect_containsPoint(double x, double y, double w, double h,
-                               double px, double py)
+static inline bool rect_containsPoint(double x, double y, double w, double h,
+                                      double px, double py)
 {
-    return ((px - x) > DELTA) && ((py - y) > DELTA) && ((x + w - px) > DELTA) &&
-           ((y + h - py) > DELTA);
+    double pos[2] = {x, y}, size[2] = {w, h}, p[2] = {px, py};
+    return bump::box_containsPoint<2>(pos, size, p);
 }
 
-static bool rect_containsRect(double x1, double y1, double w1, double h1,
-                              double x2, double y2, double w2, double h2)
+static inline bool rect_containsRect(double x1, double y1, double w1,
+                                     double h1, double x2, double y2,
+                                     double w2, double h2)
 {
     return x1 <= x2 && y1 >= y2 && x1 + w1 <= x2 + w2 && y1 + h1 <= y2 + h2;
 }
 
-static bool rect_isIntersecting(double x1, double y1, double w1, double h1,
-                                double x2, double y2, double w2, double h2)
+static inline bool rect_isIntersecting(double x1, double y1, double w1,
+                                       double h1, double x2, double y2,
+                                       double w2, double h2)
 {
-    return (x1 < (x2 + w2)) && (x2 < (x1 + w1)) && (y1 < (y2 + h2)) &&
-           (y2 < (y1 + h1));
+    double pos1[2] = {x1, y1}, size1[2] = {w1, h1};
+    double pos2[2] = {x2, y2}, size2[2] = {w2, h2};
+    return bump::box_isIntersecting<2>(pos1, size1, pos2, size2);
 }
 
-static double rect_getSquareDistance(double x1, double y1, double w1, double h1,
-                                     double x2, double y2, double w2, double h2)
+static inline double rect_getSquareDistance(double x1, double y1, double w1,
+                                            double h1, double x2, double y2,
+                                            double w2, double h2)
 {
-    double dx = x1 - x2 + (w1 - w2) / 2;
-    double dy = y1 - y2 + (h1 - h2) / 2;
-    return dx * dx + dy * dy;
+    bump::Box<2> b1 = {{x1, y1}, {w1, h1}};
+    bump::Box<2> b2 = {{x2, y2}, {w2, h2}};
+    return bump::box_getSquareDistance<2>(b1, b2);
 }
 
-struct Point {
-    double x, y;
-};
-struct Rect {
-    double x, y, w, h;
-};
-struct Collision {
-    bool overlaps;
-    int item;
-    int other;
-    int type;
-    double ti;
-    Point move;
-    Point normal;
-    Point touch;
-    Point response;
-    Rect itemRect;
-    Rect otherRect;
-};
-
-static bool rect_detectCollision(double x1, double y1, double w1, double h1,
-                                 double x2, double y2, double w2, double h2,
-                                 double goalX, double goalY, Collision &col)
+static inline bool rect_detectCollision(double x1, double y1, double w1,
+                                        double h1, double x2, double y2,
+                                        double w2, double h2, double goalX,
+                                        double goalY, Collision &col)
 {
-    double dx = goalX - x1, dy = goalY - y1;
-    double x, y, w, h;
-    rect_getDiff(x1, y1, w1, h1, x2, y2, w2, h2, x, y, w, h);
+    bump::Box<2> b1 = {{x1, y1}, {w1, h1}};
+    bump::Box<2> b2 = {{x2, y2}, {w2, h2}};
+    double goal[2]  = {goalX, goalY};
+    return bump::box_detectCollision<2>(b1, b2, goal, col);
+}
 
-    bool overlaps = false;
-    double ti;
-    bool cf   = false;
-    double nx = 0, ny = 0;
+/*------------------------------------------
+-- Tilemaps
+------------------------------------------*/
 
-    if (rect_containsPoint(x, y, w, h, 0, 0)) { //-- item was intersecting other
-        double px, py;
-        rect_getNearestCorner(x, y, w, h, 0, 0, px, py);
-        double wi = (w1 < fabs(px)) ? w1 : fabs(px);
-        double hi = (h1 < fabs(py)) ? h1 : fabs(py);
-        ti        = -wi * hi; //-- ti is the negative area of intersection
-        overlaps  = true;
-        cf        = true;
-    } else {
-        double ti1 = -MATH_HUGE, ti2 = MATH_HUGE;
-        double nx1, ny1, nx2, ny2;
-        if (rect_getSegmentIntersectionIndices(x, y, w, h, 0, 0, dx, dy, ti1,
-                                               ti2, nx1, ny1, nx2, ny2)) {
-            //-- item tunnels into other
-            if ((ti1 < 1) &&
-                (fabs(ti1 - ti2) >= DELTA) //-- special case for rect going
-                                           // through another rect's corner
-                && ((0 < (ti1 + DELTA)) || ((0 == ti1) && (ti2 > 0)))) {
-                ti       = ti1;
-                nx       = nx1;
-                ny       = ny1;
-                overlaps = false;
-                cf       = true;
+//-- Greedily merges the solid tiles of a width x height row-major grid into
+//-- rectangles: each one starts at the first free solid tile in scan order,
+//-- grows right as far as it can, then down while the whole span stays
+//-- solid. rects receives {x, y, w, h} in tiles per rectangle and tiles[i]
+//-- the index of the rectangle covering tile i, or -1.
+static inline void tilemap_mergeRects(const std::vector<bool> &solid,
+                                      int width, int height,
+                                      std::vector<int> &rects,
+                                      std::vector<int> &tiles)
+{
+    tiles.assign(width * height, -1);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (!solid[y * width + x] || tiles[y * width + x] >= 0) {
+                continue;
+            }
+            int w = 1;
+            while (x + w < width && solid[y * width + x + w] &&
+                   tiles[y * width + x + w] < 0) {
+                w++;
+            }
+            int h = 1;
+            for (; y + h < height; h++) {
+                int row = (y + h) * width + x, i = 0;
+                while (i < w && solid[row + i] && tiles[row + i] < 0) {
+                    i++;
+                }
+                if (i < w) {
+                    break;
+                }
             }
-        }
-    }
-
-    if (!cf)
-        return false;
-
-    double tx, ty;
 
-    if (overlaps) {
-        if ((dx == 0) && (dy == 0)) {
-            //-- intersecting and not moving - use minimum displacement vector
-            double px, py;
-            rect_getNearestCorner(x, y, w, h, 0, 0, px, py);
-            if (fabs(px) < fabs(py))
-                py = 0;
-            else
-                px = 0;
-            nx = sign(px);
-            ny = sign(py);
-            tx = x1 + px;
-            ty = y1 + py;
-        } else {
-            //-- intersecting and moving - move in the opposite direction
-            double ti1 = -MATH_HUGE;
-            double ti2 = 1;
-            double nx1, ny1, nx2, ny2;
-            if (!rect_getSegmentIntersectionIndices(
-                    x, y, w, h, 0, 0, dx, dy, ti1, ti2, nx1, ny1, nx2, ny2))
-                return false;
-            tx = x1 + dx * ti1;
-            ty = y1 + dy * ti1;
+            int r = rects.size() / 4;
+            for (int ty = y; ty < y + h; ty++) {
+                for (int tx = x; tx < x + w; tx++) {
+                    tiles[ty * width + tx] = r;
+                }
+            }
+            rects.push_back(x);
+            rects.push_back(y);
+            rects.push_back(w);
+            rects.push_back(h);
         }
-    } else //-- tunnel
-    {
-        tx = x1 + dx * ti;
-        ty = y1 + dy * ti;
     }
-
-    col.overlaps    = overlaps;
-    col.ti          = ti;
-    col.move.x      = dx;
-    col.move.y      = dy;
-    col.normal.x    = nx;
-    col.normal.y    = ny;
-    col.touch.x     = tx;
-    col.touch.y     = ty;
-    col.itemRect.x  = x1;
-    col.itemRect.y  = y1;
-    col.itemRect.w  = w1;
-    col.itemRect.h  = h1;
-    col.otherRect.x = x2;
-    col.otherRect.y = y2;
-    col.otherRect.w = w2;
-    col.otherRect.h = h2;
-    return true;
 }
 
-//------------------------------------------
-//-- Grid functions
-//------------------------------------------
-
-static void grid_toWorld(int cellSize, int cx, int cy, double &wx, double &wy)
-{
-    wx = (cx - 1) * cellSize;
-    wy = (cy - 1) * cellSize;
-}
-
-static void grid_toCell(int cellSize, double x, double y, int &cx, int &cy)
-{
-    cx = floor(x / cellSize) + 1;
-    cy = floor(y / cellSize) + 1;
-}
-
-/*-- grid_traverse* functions are based on "A Fast Voxel Traversal Algorithm for
- Ray Tracing",
- -- by John Amanides and Andrew Woo -
- http://www.cse.yorku.ca/~amana/research/grid.pdf
- -- It has been modified to include both cells when the ray "touches a grid
- corner",
- -- and with a different exit condition*/
+/*------------------------------------------
+-- Convex polygons
+------------------------------------------*/
 
-static int grid_traverse_initStep(int cellSize, int ct, double t1, double t2,
-                                  double &rx, double &ry)
+//-- Separating axis test between the convex polygon xy = {x1, y1, x2, y2,
+//-- ...} of n points, in either winding, and a rect. Like
+//-- rect_isIntersecting, shapes that only touch do not intersect.
+static inline bool polygon_intersectsRect(const double *xy, int n,
+                                          const double *pos,
+                                          const double *size)
 {
-    double v = t2 - t1;
-    if (v > 0) {
-        rx = cellSize / v;
-        ry = ((ct + v) * cellSize - t1) / v;
-        return 1;
-    }
-    if (v < 0) {
-        rx = -cellSize / v;
-        ry = ((ct + v - 1) * cellSize - t1) / v;
-        return -1;
+    //-- the rect's own axes: the polygon's bounding box against it
+    for (int a = 0; a < 2; a++) {
+        double lo = xy[a], hi = xy[a];
+        for (int i = 1; i < n; i++) {
+            lo = std::min(lo, xy[2 * i + a]);
+            hi = std::max(hi, xy[2 * i + a]);
+        }
+        if (hi <= pos[a] || pos[a] + size[a] <= lo) {
+            return false;
+        }
     }
-    rx = HUGE_VAL;
-    ry = HUGE_VAL;
-    return 0;
-}
-
-typedef void (*pointFunc)(void *data, int, int);
 
-static void grid_traverse(int cellSize, double x1, double y1, double x2,
-                          double y2, pointFunc f, void *data)
-{
-    int cx1, cy1, cx2, cy2;
-    double dx, tx, dy, ty;
-    grid_toCell(cellSize, x1, y1, cx1, cy1);
-    grid_toCell(cellSize, x2, y2, cx2, cy2);
-    int stepX = grid_traverse_initStep(cellSize, cx1, x1, x2, dx, tx);
-    int stepY = grid_traverse_initStep(cellSize, cy1, y1, y2, dy, ty);
-    int cx    = cx1;
-    int cy    = cy1;
-
-    f(data, cx, cy);
-
-    //-- The default implementation had an infinite loop problem when
-    //-- approaching the last cell in some occassions. We finish iterating
-    //-- when we are *next* to the last cell
-    while ((iabs(cx - cx2) + iabs(cy - cy2)) > 1) {
-        if (tx < ty) {
-            tx += dx;
-            cx += stepX;
-            f(data, cx, cy);
-        } else {
-            //-- Addition: include both cells when going through corners
-            if (tx == ty)
-                f(data, cx + stepX, cy);
-            ty += dy;
-            cy += stepY;
-            f(data, cx, cy);
+    //-- the normals of the polygon's edges
+    for (int i = 0; i < n; i++) {
+        int j     = (i + 1) % n;
+        double nx = xy[2 * i + 1] - xy[2 * j + 1];
+        double ny = xy[2 * j] - xy[2 * i];
+        if (nx == 0 && ny == 0) {
+            continue;
+        }
+        double lo = MATH_HUGE, hi = -MATH_HUGE;
+        for (int k = 0; k < n; k++) {
+            double d = nx * xy[2 * k] + ny * xy[2 * k + 1];
+            lo       = std::min(lo, d);
+            hi       = std::max(hi, d);
+        }
+        double base = nx * pos[0] + ny * pos[1];
+        double wx   = nx * size[0], wy = ny * size[1];
+        double rlo  = base + std::min(0.0, wx) + std::min(0.0, wy);
+        double rhi  = base + std::max(0.0, wx) + std::max(0.0, wy);
+        if (hi <= rlo || rhi <= lo) {
+            return false;
         }
     }
-
-    //-- If we have not arrived to the last cell, use it
-    if ((cx != cx2) || (cy != cy2))
-        f(data, cx2, cy2);
+    return true;
 }
 
-static void grid_toCellRect(int cellSize, double x, double y, double w,
-                            double h, int &cx, int &cy, int &cw, int &ch)
+//-- The x extent of the polygon within the band y0 <= y <= y1; false when
+//-- it does not reach the band
+static inline bool polygon_bandExtent(const double *xy, int n, double y0,
+                                      double y1, double &x0, double &x1)
 {
-    grid_toCell(cellSize, x, y, cx, cy);
-    int cr = ceil((x + w) / cellSize);
-    int cb = ceil((y + h) / cellSize);
-    cw     = cr - cx + 1;
-    ch     = cb - cy + 1;
-}
-
-struct World;
-
-/*------------------------------------------
- -- ColFilter
- ------------------------------------------*/
-
-struct ColFilter {
-    virtual int Filter(int item, int other) = 0;
-    virtual ~ColFilter(){};
-};
-
-struct VisitedFilter : ColFilter {
-    std::set<int> visited;
-    ColFilter *filter;
-    int Filter(int item, int other)
-    {
-        if (visited.find(other) != visited.end()) {
-            return 0;
+    x0 = MATH_HUGE;
+    x1 = -MATH_HUGE;
+    for (int i = 0; i < n; i++) {
+        int j     = (i + 1) % n;
+        double px = xy[2 * i], py = xy[2 * i + 1];
+        double qx = xy[2 * j], qy = xy[2 * j + 1];
+        if (std::max(py, qy) < y0 || std::min(py, qy) > y1) {
+            continue;
         }
-        return filter->Filter(item, other);
+        double t0 = 0, t1 = 1;
+        if (py != qy) {
+            double ta = (y0 - py) / (qy - py), tb = (y1 - py) / (qy - py);
+            t0        = std::max(0.0, std::min(ta, tb));
+            t1        = std::min(1.0, std::max(ta, tb));
+        }
+        double xa = px + (qx - px) * t0, xb = px + (qx - px) * t1;
+        x0        = std::min(x0, std::min(xa, xb));
+        x1        = std::max(x1, std::max(xa, xb));
     }
-};
-
-/*------------------------------------------
--- Responses
-------------------------------------------*/
-struct Response {
-    virtual void ComputeResponse(World *world, Collision &col, double x,
-                                 double y, double w, double h, double goalX,
-                                 double goalY, ColFilter *filter,
-                                 double &actualX, double &actualY,
-                                 std::vector<Collision> &cols) = 0;
-    virtual ~Response(){};
-};
+    return x0 <= x1;
+}
 
 /*------------------------------------------
 -- World
 ------------------------------------------*/
 
-struct Cell {
-    std::set<int> items;
-    int x, y;
-    Cell() : x(0), y(0) {}
-};
+struct World : bump::World<2> {
+    using bump::World<2>::add;
+    using bump::World<2>::update;
+    using bump::World<2>::project;
+    using bump::World<2>::check;
+    using bump::World<2>::move;
+    using bump::World<2>::queryPoint;
+    using bump::World<2>::querySegment;
+    using bump::World<2>::querySegmentWithCoords;
+    using bump::World<2>::toWorld;
+    using bump::World<2>::toCell;
 
-struct ItemInfo {
-    int item;
-    double ti1, ti2, weight;
-    double x1, y1, x2, y2;
-};
-
-struct ItemFilter {
-    virtual bool Filter(int item) = 0;
-    virtual ~ItemFilter(){};
-};
-
-struct CrossResponse;
-struct TouchResponse;
-struct SlideResponse;
-struct BounceResponse;
-
-struct SlideFilter : ColFilter {
-    int Filter(int item, int other)
-    {
-        UNUSED(item);
-        UNUSED(other);
-        return Slide;
-    };
-};
-
-struct TouchFilter : ColFilter {
-    int Filter(int item, int other)
-    {
-        UNUSED(item);
-        UNUSED(other);
-        return Touch;
-    };
-};
-
-struct CrossFilter : ColFilter {
-    int Filter(int item, int other)
-    {
-        UNUSED(item);
-        UNUSED(other);
-        return Cross;
-    };
-};
-
-struct BounceFilter : ColFilter {
-    int Filter(int item, int other)
-    {
-        UNUSED(item);
-        UNUSED(other);
-        return Bounce;
-    };
-};
-
-struct TouchResponse : Response {
-    void ComputeResponse(World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols);
-};
-
-struct CrossResponse : Response {
-    void ComputeResponse(World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols);
-};
-
-struct SlideResponse : Response {
-    void ComputeResponse(World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols);
-};
-
-struct BounceResponse : Response {
-    void ComputeResponse(World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols);
-};
-
-struct World {
-    int cellSize;
-    int itemId;
-    std::map<int, Response *> responses;
-    std::map<int, ColFilter *> filters;
-    std::map<int, Rect> rects;
-    std::map<int, std::map<int, Cell> > rows;
-
-    void initialize (int cellSize)
+    void getRect(int item, double &x, double &y, double &w, double &h)
     {
-        this->cellSize = cellSize;
-        this->itemId = 0;
-
-        CrossFilter *filterCross   = new CrossFilter();
-        TouchFilter *filterTouch   = new TouchFilter();
-        SlideFilter *filterSlide   = new SlideFilter();
-        BounceFilter *filterBounce = new BounceFilter();
-
-        this->addFilter(Touch, filterTouch);
-        this->addFilter(Cross, filterCross);
-        this->addFilter(Slide, filterSlide);
-        this->addFilter(Bounce, filterBounce);
-
-        CrossResponse *responseCross   = new CrossResponse();
-        TouchResponse *responseTouch   = new TouchResponse();
-        SlideResponse *responseSlide   = new SlideResponse();
-        BounceResponse *responseBounce = new BounceResponse();
-
-        this->addResponse(Touch, responseTouch);
-        this->addResponse(Cross, responseCross);
-        this->addResponse(Slide, responseSlide);
-        this->addResponse(Bounce, responseBounce);
+        const bump::Box<2, bump::Storage> &r = boxes.get(item);
+        x = r.pos[0];
+        y = r.pos[1];
+        w = r.size[0];
+        h = r.size[1];
     }
 
-    void release()
+    void toWorld(int cx, int cy, double &x, double &y)
     {
-        Response *responseTouch = this->getResponseById(Touch);
-        if(responseTouch) {
-            delete responseTouch;
-        }
-
-        Response *responseCross = this->getResponseById(Cross);
-        if(responseCross) {
-            delete responseCross;
-        }
-
-        Response *responseSlide = this->getResponseById(Slide);
-        if(responseSlide) {
-            delete responseSlide;
-        }
-
-        Response *responseBounce = this->getResponseById(Bounce);
-        if(responseBounce) {
-            delete responseBounce;
-        }
-
-        this->responses.erase(Touch);
-        this->responses.erase(Cross);
-        this->responses.erase(Bounce);
-        this->responses.erase(Slide);
-
-        ColFilter *filterTouch = this->getFilterById(Touch);
-        delete filterTouch;
-
-        ColFilter *filterCross = this->getFilterById(Cross);
-        delete filterCross;
-
-        ColFilter *filterSlide = this->getFilterById(Slide);
-        delete filterSlide;
-
-        ColFilter *filterBounce = this->getFilterById(Bounce);
-        delete filterBounce;
-
-        this->filters.erase(Touch);
-        this->filters.erase(Cross);
-        this->filters.erase(Bounce);
-        this->filters.erase(Slide);
-
-        this->clear();
+        int c[2] = {cx, cy};
+        double p[2];
+        toWorld(c, p);
+        x = p[0];
+        y = p[1];
     }
 
-    //-- Private functions and methods
-    static bool sortByWeight(ItemInfo a, ItemInfo b)
+    void toCell(double x, double y, int &cx, int &cy)
     {
-        return a.weight < b.weight;
+        double p[2] = {x, y};
+        int c[2];
+        toCell(p, c);
+        cx = c[0];
+        cy = c[1];
     }
 
-    static bool sortByTiAndDistance(Collision a, Collision b)
+    void queryRect(double x, double y, double w, double h, ItemFilter *filter,
+                   std::set<int> &items)
     {
-        if (a.ti == b.ti) {
-            double ad = rect_getSquareDistance(
-                a.itemRect.x, a.itemRect.y, a.itemRect.w, a.itemRect.h,
-                a.otherRect.x, a.otherRect.y, a.otherRect.w, a.otherRect.h);
-            double bd = rect_getSquareDistance(
-                a.itemRect.x, a.itemRect.y, a.itemRect.w, a.itemRect.h,
-                b.otherRect.x, b.otherRect.y, b.otherRect.w, b.otherRect.h);
-            return ad < bd;
-        }
-        return a.ti < b.ti;
+        double pos[2] = {x, y}, size[2] = {w, h};
+        queryBox(pos, size, filter, items);
     }
 
-    void addItemToCell(int item, int cx, int cy)
+    void queryPoint(double x, double y, ItemFilter *filter,
+                    std::set<int> &items)
     {
-        rows[cy][cx].items.insert(item);
+        double p[2] = {x, y};
+        queryPoint(p, filter, items);
     }
 
-    bool removeItemFromCell(int item, int cx, int cy)
+    void querySegment(double x1, double y1, double x2, double y2,
+                      ItemFilter *filter, std::set<int> &items)
     {
-        std::map<int, std::map<int, Cell> >::iterator row = rows.find(cy);
-        if (row == rows.end())
-            return false;
-        std::map<int, Cell>::iterator cell = row->second.find(cx);
-        if (cell == row->second.end())
-            return false;
-        if (cell->second.items.find(item) == cell->second.items.end())
-            return false;
-        cell->second.items.erase(item);
-        return true;
+        double p1[2] = {x1, y1}, p2[2] = {x2, y2};
+        querySegment(p1, p2, filter, items);
     }
 
-    void getDictItemsInCellRect(int cl, int ct, int cw, int ch,
-                                std::set<int> &items_dict)
+    //-- Items overlapping the convex polygon xy = {x1, y1, x2, y2, ...} of
+    //-- n points. Only the cells the polygon covers are read, a row of
+    //-- cells at a time, and each candidate gets an exact separating axis
+    //-- test.
+    void queryPolygon(const double *xy, int n, ItemFilter *filter,
+                      std::set<int> &items)
     {
-        for (int cy = ct; cy < ct + ch; cy++) {
-            std::map<int, std::map<int, Cell> >::iterator row = rows.find(cy);
-            if (row == rows.end())
+        double lo[2] = {xy[0], xy[1]}, hi[2] = {xy[0], xy[1]};
+        for (int i = 1; i < n; i++) {
+            for (int a = 0; a < 2; a++) {
+                lo[a] = std::min(lo[a], xy[2 * i + a]);
+                hi[a] = std::max(hi[a], xy[2 * i + a]);
+            }
+        }
+        double size[2] = {hi[0] - lo[0], hi[1] - lo[1]};
+        noteFootprint(size);
+        int c[2], len[2];
+        bump::grid_toCellBox<2>(cellSize, lo, size, c, len);
+
+        std::set<int> found;
+        for (int row = c[1]; row < c[1] + len[1]; row++) {
+            double y0 = std::max(lo[1], (row - 1) * cellSize.size[1]);
+            double y1 = std::min(hi[1], row * cellSize.size[1]);
+            double x0, x1;
+            if (!polygon_bandExtent(xy, n, y0, y1, x0, x1)) {
                 continue;
-            for (int cx = cl; cx < cl + cw; cx++) {
-                std::map<int, Cell>::iterator cell = row->second.find(cx);
-                if (cell == row->second.end())
-                    continue;
-                if (cell->second.items.size() > 0) {
-                    for (std::set<int>::iterator it =
-                             cell->second.items.begin();
-                         it != cell->second.items.end(); it++)
-                        items_dict.insert(*it);
-                }
             }
+            double pos[2] = {x0, y0}, span[2] = {x1 - x0, y1 - y0};
+            int rc[2], rlen[2];
+            bump::grid_toCellBox<2>(cellSize, pos, span, rc, rlen);
+            rc[1]   = row;
+            rlen[1] = 1;
+            getDictItemsInCellBox(rc, rlen, found);
         }
-    }
-    struct _CellTraversal {
-        World *world;
-        std::set<Cell *> cells;
-    };
-    static void cellsTraversal_(void *ctx, int cx, int cy)
-    {
-        struct _CellTraversal *ct = (struct _CellTraversal *)ctx;
-        std::map<int, std::map<int, Cell> >::iterator row =
-            ct->world->rows.find(cy);
-        if (row == ct->world->rows.end())
-            return;
-        std::map<int, Cell>::iterator cell = row->second.find(cx);
-        if (cell == row->second.end())
-            return;
-        ct->cells.insert(&cell->second);
-    }
-    
-    std::set<Cell *> getCellsTouchedBySegment(double x1, double y1, double x2,
-                                              double y2)
-    {
-        struct _CellTraversal ct;
-        ct.world = this;
-        grid_traverse(cellSize, x1, y1, x2, y2, cellsTraversal_, &ct);
-        return ct.cells;
-    }
 
-    void getInfoAboutItemsTouchedBySegment(double x1, double y1, double x2,
-                                           double y2, ItemFilter *filter,
-                                           std::vector<ItemInfo> &itemInfo)
-    {
-        std::set<Cell *> cells = getCellsTouchedBySegment(x1, y1, x2, y2);
-        std::set<int> visited;
-
-        for (std::set<Cell *>::iterator it = cells.begin(); it != cells.end();
+        for (std::set<int>::iterator it = found.begin(); it != found.end();
              it++) {
-            Cell *cell = (*it);
-            for (std::set<int>::iterator i = cell->items.begin();
-                 i != cell->items.end(); i++) {
-                if (visited.find(*i) == visited.end()) {
-                    visited.insert(*i);
-                    if ((!filter) || filter->Filter(*i)) {
-                        Rect r = rects[*i];
-                        double nx1, ny1, nx2, ny2;
-                        double ti1 = 0;
-                        double ti2 = 1;
-                        rect_getSegmentIntersectionIndices(
-                            r.x, r.y, r.w, r.h, x1, y1, x2, y2, ti1, ti2, nx1,
-                            ny1, nx2, ny2);
-                        if (ti1 && (((0 < ti1) && (ti1 < 1)) ||
-                                    ((0 < ti2) && (ti2 < 1)))) {
-                            //-- the sorting is according to the t of an
-                            // infinite line, not the segment
-                            double tii0 = -MATH_HUGE;
-                            double tii1 = MATH_HUGE;
-                            rect_getSegmentIntersectionIndices(
-                                r.x, r.y, r.w, r.h, x1, y1, x2, y2, tii0, tii1,
-                                nx1, ny1, nx2, ny2);
-                            ItemInfo ii;
-                            ii.item   = *i;
-                            ii.ti1    = ti1;
-                            ii.ti2    = ti2;
-                            ii.weight = tii0 < tii1 ? tii0 : tii1;
-                            itemInfo.push_back(ii);
-                        }
-                    }
-                }
+            if (filter && !filter->Filter(*it)) {
+                continue;
             }
-        }
-        std::sort(itemInfo.begin(), itemInfo.end(), sortByWeight);
-    }
-
-    Response *getResponseById(int id)
-    {
-        return responses[id];
-    }
-
-    void addResponse(int id, Response *response)
-    {
-        responses[id] = response;
-    }
-    
-    void addFilter(int id, ColFilter *filter)
-    {
-        filters[id] = filter;
-    }
-
-    ColFilter * getFilterById(int id) 
-    {
-        return filters[id];
-    }
-
-    void project(int item, double x, double y, double w, double h, double goalX,
-                 double goalY, ColFilter *filter,
-                 std::vector<Collision> &collisions)
-    {
-        std::set<int> visited;
-        if (item) {
-            visited.insert(item);
-        }
-
-        //-- This could probably be done with less cells using a polygon raster
-        // over the cells instead of a
-        //-- bounding rect of the whole movement. Conditional to building a
-        // queryPolygon method
-        double tl = (goalX < x) ? goalX : x;
-        double tt = (goalY < y) ? goalY : y;
-        double tr = ((goalX + w) > (x + w)) ? goalX + w : x + w;
-        double tb = ((goalY + h) > (y + h)) ? goalY + h : y + h;
-        double tw = tr - tl;
-        double th = tb - tt;
-
-        int cl, ct, cw, ch;
-        grid_toCellRect(cellSize, tl, tt, tw, th, cl, ct, cw, ch);
-
-        std::set<int> dictItemsInCellRect;
-        getDictItemsInCellRect(cl, ct, cw, ch, dictItemsInCellRect);
-
-        for (std::set<int>::iterator it = dictItemsInCellRect.begin();
-             it != dictItemsInCellRect.end(); it++) {
-            int other = *it;
-            if (visited.find(other) == visited.end()) {
-                visited.insert(other);
-                int responseId = filter->Filter(item, other);
-                if (responseId > 0) {
-                    double ox, oy, ow, oh;
-                    getRect(other, ox, oy, ow, oh);
-                    Collision col;
-                    if (rect_detectCollision(x, y, w, h, ox, oy, ow, oh, goalX,
-                                             goalY, col)) {
-                        col.other = other;
-                        col.item  = item;
-                        col.type  = responseId;
-                        collisions.push_back(col);
-                    }
-                }
+            bump::Box<2> b = boxOf(*it);
+            if (polygon_intersectsRect(xy, n, b.pos, b.size)) {
+                items.insert(*it);
             }
         }
-
-        std::sort(collisions.begin(), collisions.end(), sortByTiAndDistance);
-    }
-
-    int countCells()
-    {
-        int count = 0;
-        for (std::map<int, std::map<int, Cell> >::iterator row = rows.begin();
-             row != rows.end(); row++)
-            count += row->second.size();
-        return count;
-    }
-
-    bool hasItem(int item)
-    {
-        return rects.find(item) != rects.end();
     }
 
-    std::set<int> getItems()
+    //-- Items overlapping the w x h rect centered on cx, cy and turned by
+    //-- angle radians, counterclockwise in a y-up frame
+    void queryOrientedRect(double cx, double cy, double w, double h,
+                           double angle, ItemFilter *filter,
+                           std::set<int> &items)
     {
-        std::set<int> items;
-        for (std::map<int, Rect>::iterator r = rects.begin(); r != rects.end();
-             r++)
-            items.insert(r->first);
-        return items;
+        double ux = cos(angle) * w / 2, uy = sin(angle) * w / 2;
+        double vx = -sin(angle) * h / 2, vy = cos(angle) * h / 2;
+        double xy[8] = {cx - ux - vx, cy - uy - vy, cx + ux - vx, cy + uy - vy,
+                        cx + ux + vx, cy + uy + vy, cx - ux + vx, cy - uy + vy};
+        queryPolygon(xy, 4, filter, items);
     }
 
-    int countItems()
-    {
-        return rects.size();
-    }
-
-    void getRect(int item, double &x, double &y, double &w, double &h)
-    {
-        Rect r = rects[item];
-        x      = r.x;
-        y      = r.y;
-        w      = r.w;
-        h      = r.h;
-    }
-
-    void toWorld(int cx, int cy, double &x, double &y)
-    {
-        grid_toWorld(cellSize, cx, cy, x, y);
-    }
-    void toCell(double x, double y, int &cx, int &cy)
-    {
-        grid_toCell(cellSize, x, y, cx, cy);
-    }
-
-    //--- Query methods
-
-    void queryRect(double x, double y, double w, double h, ItemFilter *filter,
-                   std::set<int> &dictItemsInCellRect)
+    void querySegmentWithCoords(double x1, double y1, double x2, double y2,
+                                ItemFilter *filter,
+                                std::vector<ItemInfo> &itemInfo)
     {
-        int cl, ct, cw, ch;
-        grid_toCellRect(cellSize, x, y, w, h, cl, ct, cw, ch);
-        getDictItemsInCellRect(cl, ct, cw, ch, dictItemsInCellRect);
-        for (std::set<int>::iterator it = dictItemsInCellRect.begin();
-             it != dictItemsInCellRect.end();) {
-            bool drop = (filter && !filter->Filter(*it));
-            if (!drop) {
-                Rect rect = rects[*it];
-                drop |= !rect_isIntersecting(x, y, w, h, rect.x, rect.y, rect.w,
-                                             rect.h);
-            }
-            if (drop)
-                dictItemsInCellRect.erase(it++);
-            else
-                ++it;
-        }
+        double p1[2] = {x1, y1}, p2[2] = {x2, y2};
+        querySegmentWithCoords(p1, p2, filter, itemInfo);
     }
 
-    void queryPoint(double x, double y, ItemFilter *filter,
-                    std::set<int> &dictItemsInCellRect)
+    void getInfoAboutItemsTouchedBySegment(double x1, double y1, double x2,
+                                           double y2, ItemFilter *filter,
+                                           std::vector<ItemInfo> &itemInfo)
     {
-        int cx, cy;
-        toCell(x, y, cx, cy);
-        getDictItemsInCellRect(cx, cy, 1, 1, dictItemsInCellRect);
-        for (std::set<int>::iterator it = dictItemsInCellRect.begin();
-             it != dictItemsInCellRect.end();) {
-            Rect rect = rects[*it];
-            if ((filter && !filter->Filter(*it)) ||
-                !rect_containsPoint(rect.x, rect.y, rect.w, rect.h, x, y))
-                dictItemsInCellRect.erase(it++);
-            else
-                ++it;
-        }
+        double p1[2] = {x1, y1}, p2[2] = {x2, y2};
+        bump::World<2>::getInfoAboutItemsTouchedBySegment(p1, p2, filter,
+                                                          itemInfo);
     }
 
-    void querySegment(double x1, double y1, double x2, double y2,
-                      ItemFilter *filter, std::set<int> &items)
+    //-- Adds the solid tiles of a tilemap, whose top left corner is at the
+    //-- origin, as merged rects. ids receives the new items and tiles[i] the
+    //-- item covering tile i, or 0.
+    void addTilemap(const std::vector<bool> &solid, int width, int height,
+                    double tileSize, std::vector<int> &ids,
+                    std::vector<int> &tiles)
     {
-        std::vector<ItemInfo> itemInfo;
-        getInfoAboutItemsTouchedBySegment(x1, y1, x2, y2, filter, itemInfo);
-        for (std::vector<ItemInfo>::iterator it = itemInfo.begin();
-             it != itemInfo.end(); it++)
-            items.insert((*it).item);
-    }
+        std::vector<int> rects;
+        tilemap_mergeRects(solid, width, height, rects, tiles);
 
-    void querySegmentWithCoords(double x1, double y1, double x2, double y2,
-                                ItemFilter *filter,
-                                std::vector<ItemInfo> &itemInfo2)
-    {
-        std::vector<ItemInfo> itemInfo;
-        getInfoAboutItemsTouchedBySegment(x1, y1, x2, y2, filter, itemInfo);
-        double dx = x2 - x1, dy = y2 - y1;
-        for (std::vector<ItemInfo>::iterator it = itemInfo.begin();
-             it != itemInfo.end(); it++) {
-            ItemInfo i = *it;
-            i.x1       = x1 + dx * i.ti1;
-            i.y1       = y1 + dy * i.ti1;
-            i.x2       = x1 + dx * i.ti2;
-            i.y2       = y1 + dy * i.ti2;
-            itemInfo2.push_back(i);
+        int count = rects.size() / 4;
+        std::vector<double> packed(rects.size());
+        for (size_t i = 0; i < rects.size(); i++) {
+            packed[i] = rects[i] * tileSize;
         }
-    }
-
-    //--- Main methods
-    int allocateId()
-    {
-        if (itemId >= INT_MAX) {
-            itemId = 0;
+        ids.resize(count);
+        if (count > 0) {
+            addMany(&packed[0], count, &ids[0]);
         }
-
-        int nid = (++itemId);
-
-        while (hasItem(nid)) {
-            nid++;
+        for (size_t i = 0; i < tiles.size(); i++) {
+            tiles[i] = (tiles[i] < 0) ? 0 : ids[tiles[i]];
         }
-            
-        itemId = nid;
-        return nid;
     }
 
     void add(int item, double x, double y, double w, double h)
     {
-        Rect r;
-        r.x         = x;
-        r.y         = y;
-        r.w         = w;
-        r.h         = h;
-        rects[item] = r;
-
-        int cl, ct, cw, ch;
-        grid_toCellRect(cellSize, x, y, w, h, cl, ct, cw, ch);
-        for (int cy = ct; cy < ct + ch; cy++) {
-            for (int cx = cl; cx < cl + cw; cx++) {
-                addItemToCell(item, cx, cy);
-            }
-        }
-    }
-
-    void remove(int item)
-    {
-        Rect r = rects[item];
-        int cl, ct, cw, ch;
-        grid_toCellRect(cellSize, r.x, r.y, r.w, r.h, cl, ct, cw, ch);
-        for (int cy = ct; cy < ct + ch; cy++) {
-            for (int cx = cl; cx < cl + cw; cx++) {
-                removeItemFromCell(item, cx, cy);
-            }
-        }
-        rects.erase(item);
-    }
-
-    void clear() {
-        itemId = 0;
-        rects.clear();
-        rows.clear();
+        double pos[2] = {x, y}, size[2] = {w, h};
+        add(item, pos, size);
     }
 
     void update(int item, double x2, double y2, double w2, double h2)
     {
-        Rect r = rects[item];
-        if (w2 <= 0)
-            w2 = r.w;
-        if (h2 <= 0)
-            h2 = r.h;
-
-        if ((r.x != x2) || (r.y != y2) || (r.w != w2) || (r.h != h2)) {
-            int cl1, ct1, cw1, ch1;
-            grid_toCellRect(cellSize, r.x, r.y, r.w, r.h, cl1, ct1, cw1, ch1);
-            int cl2, ct2, cw2, ch2;
-            grid_toCellRect(cellSize, x2, y2, w2, h2, cl2, ct2, cw2, ch2);
-
-            if ((cl1 != cl2) || (ct1 != ct2) || (cw1 != cw2) || (ch1 != ch2)) {
-                int cr1 = cl1 + cw1 - 1, cb1 = ct1 + ch1 - 1;
-                int cr2 = cl2 + cw2 - 1, cb2 = ct2 + ch2 - 1;
-                bool cyOut;
-
-                for (int cy = ct1; cy <= cb1; cy++) {
-                    cyOut = (cy < ct2) || (cy > cb2);
-                    for (int cx = cl1; cx <= cr1; cx++) {
-                        if (cyOut || (cx < cl2) || (cx > cr2))
-                            removeItemFromCell(item, cx, cy);
-                    }
-                }
-
-                for (int cy = ct2; cy <= cb2; cy++) {
-                    cyOut = (cy < ct1) || (cy > cb1);
-                    for (int cx = cl2; cx <= cr2; cx++) {
-                        if (cyOut || (cx < cl1) || (cx > cr1))
-                            addItemToCell(item, cx, cy);
-                    }
-                }
-            }
-
-            Rect r;
-            r.x         = x2;
-            r.y         = y2;
-            r.w         = w2;
-            r.h         = h2;
-            rects[item] = r;
-        }
+        double pos[2] = {x2, y2}, size[2] = {w2, h2};
+        update(item, pos, size);
     }
 
-    void move(int item, double goalX, double goalY, ColFilter *filter,
-              double &actualX, double &actualY, std::vector<Collision> &cols)
+    void project(int item, double x, double y, double w, double h, double goalX,
+                 double goalY, ColFilter *filter,
+                 std::vector<Collision> &collisions)
     {
-        check(item, goalX, goalY, filter, actualX, actualY, cols);
-        update(item, actualX, actualY, -1, -1);
+        double pos[2] = {x, y}, size[2] = {w, h}, goal[2] = {goalX, goalY};
+        project(item, pos, size, goal, filter, collisions);
     }
 
     void check(int item, double goalX, double goalY, ColFilter *filter,
                double &actualX, double &actualY, std::vector<Collision> &cols)
     {
-        VisitedFilter vf;
-        vf.visited.insert(item);
-        vf.filter = filter;
-
-        Rect r = rects[item];
-
-        std::vector<Collision> projected_cols;
-        project(item, r.x, r.y, r.w, r.h, goalX, goalY, &vf, projected_cols);
-
-        while (projected_cols.size() > 0) {
-            Collision col = projected_cols[0];
-            vf.visited.insert(col.other);
-            Response *response = getResponseById(col.type);
-
-            projected_cols.clear();
-            response->ComputeResponse(this, col, r.x, r.y, r.w, r.h, goalX,
-                                      goalY, &vf, goalX, goalY, projected_cols);
-            cols.push_back(col);
-        }
-
-        actualX = goalX;
-        actualY = goalY;
-    }
-};
-
-void TouchResponse::ComputeResponse(World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols)
-    {
-        UNUSED(world);
-        UNUSED(x);
-        UNUSED(y);
-        UNUSED(w);
-        UNUSED(h);
-        UNUSED(filter);
-        UNUSED(goalX);
-        UNUSED(goalY);
-        UNUSED(cols);
-        actualX = col.touch.x;
-        actualY = col.touch.y;
+        double goal[2] = {goalX, goalY}, actual[2];
+        check(item, goal, filter, actual, cols);
+        actualX = actual[0];
+        actualY = actual[1];
     }
 
-void CrossResponse :: ComputeResponse (World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols)
-    {
-        world->project(col.item, x, y, w, h, goalX, goalY, filter, cols);
-        actualX = goalX;
-        actualY = goalY;
-    }
-
-void SlideResponse :: ComputeResponse (World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols)
-    {
-        double sx = col.touch.x;
-        double sy = col.touch.y;
-
-        if ((col.move.x != 0) || (col.move.y != 0)) {
-            if (col.normal.x == 0)
-                sx = goalX;
-            else
-                sy = goalY;
-        }
-
-        col.response.x = sx;
-        col.response.y = sy;
-
-        x     = col.touch.x;
-        y     = col.touch.y;
-        goalX = sx;
-        goalY = sy;
-        world->project(col.item, x, y, w, h, goalX, goalY, filter, cols);
-        actualX = goalX;
-        actualY = goalY;
-    }
-
-void BounceResponse ::ComputeResponse (World *world, Collision &col, double x, double y,
-                         double w, double h, double goalX, double goalY,
-                         ColFilter *filter, double &actualX, double &actualY,
-                         std::vector<Collision> &cols)
+    void move(int item, double goalX, double goalY, ColFilter *filter,
+              double &actualX, double &actualY, std::vector<Collision> &cols)
     {
-        double tx = col.touch.x;
-        double ty = col.touch.y;
-        double bx = tx;
-        double by = ty;
-
-        if ((col.move.x != 0) || (col.move.y != 0)) {
-            double bnx = goalX - tx, bny = goalY - ty;
-            if (col.normal.x == 0)
-                bny = -bny;
-            else
-                bnx = -bnx;
-            bx = tx + bnx;
-            by = ty + bny;
-        }
-
-        col.response.x = bx;
-        col.response.y = by;
-        x              = tx;
-        y              = ty;
-        goalX          = bx;
-        goalY          = by;
-        world->project(col.item, x, y, w, h, goalX, goalY, filter, cols);
-        actualX = goalX;
-        actualY = goalY;
+        double goal[2] = {goalX, goalY}, actual[2];
+        move(item, goal, filter, actual, cols);
+        actualX = actual[0];
+        actualY = actual[1];
     }
+};
 
-} // namespace bump
+} // namespace bump2d
@@ -1,4 +1,5 @@
 #include "bump2d.hpp"
+#include "../common/bump_snapshot.hpp"
 #include <lua.hpp>
 
 using namespace bump2d;
@@ -37,17 +38,17 @@ static void assertNumber(lua_State *L, int narg, const char *name)
     if (d == 0 && !lua_isnumber(L, narg)) /* avoid extra test when d is not 0 */
     {
         lua_pushfstring(L, "%s must be a number, but was %s (a %s)", name,
-                        luaL_tostring(L, narg), lua_typename(L, narg));
+                        luaL_tostring(L, narg), luaL_typename(L, narg));
         lua_error(L);
     }
 }
 
 static void assertIsPositiveNumber(lua_State *L, int narg, const char *name)
 {
-    lua_Integer d = lua_tointeger(L, narg);
-    if (d <= 0) {
-        lua_pushfstring(L, "%s must be a positive integer, but was %s (a %s)",
-                        name, luaL_tostring(L, narg), lua_typename(L, narg));
+    lua_Number d = lua_tonumber(L, narg);
+    if (!lua_isnumber(L, narg) || d <= 0) {
+        lua_pushfstring(L, "%s must be a positive number, but was %s (a %s)",
+                        name, luaL_tostring(L, narg), luaL_typename(L, narg));
         lua_error(L);
     }
 }
@@ -60,6 +61,149 @@ static void assertIsRect(lua_State *L, int x, int y, int w, int h)
     assertIsPositiveNumber(L, h, "h");
 }
 
+/*------------------------------------------
+-- Result tables
+--
+-- Queries and move accept an optional trailing table. When given it is
+-- filled in place (nested collision tables included) and entries past the
+-- new length are cleared, so a caller can keep one table per call site and
+-- the steady state allocates nothing.
+------------------------------------------*/
+
+static void pushResultTable(lua_State *L, int narg, int narr)
+{
+    if (lua_istable(L, narg)) {
+        lua_pushvalue(L, narg);
+    } else {
+        lua_createtable(L, narr, 0);
+    }
+}
+
+// -- clears t[n + 1], t[n + 2], ... of the result table at the top
+static void trimResultTable(lua_State *L, int n)
+{
+    for (int i = n + 1; lua_rawgeti(L, -1, i) != LUA_TNIL; i++) {
+        lua_pop(L, 1);
+        lua_pushnil(L);
+        lua_rawseti(L, -2, i);
+    }
+    lua_pop(L, 1);
+}
+
+// -- pushes t[i] of the table at the top when it is a table, or a new table
+// stored at t[i]
+static void reuseTableAt(lua_State *L, int i, int nrec)
+{
+    if (lua_rawgeti(L, -1, i) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, nrec);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, i);
+    }
+}
+
+// -- same as reuseTableAt, for the field k
+static void reuseTableField(lua_State *L, const char *k, int nrec)
+{
+    if (lua_getfield(L, -1, k) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, nrec);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -3, k);
+    }
+}
+
+static void setPointField(lua_State *L, const char *k, const double *p)
+{
+    reuseTableField(L, k, 2);
+    lua_pushnumber(L, p[0]);
+    lua_setfield(L, -2, "x");
+    lua_pushnumber(L, p[1]);
+    lua_setfield(L, -2, "y");
+    lua_pop(L, 1);
+}
+
+static void setRectField(lua_State *L, const char *k, const bump::Box<2> &r)
+{
+    reuseTableField(L, k, 4);
+    lua_pushnumber(L, r.pos[0]);
+    lua_setfield(L, -2, "x");
+    lua_pushnumber(L, r.pos[1]);
+    lua_setfield(L, -2, "y");
+    lua_pushnumber(L, r.size[0]);
+    lua_setfield(L, -2, "w");
+    lua_pushnumber(L, r.size[1]);
+    lua_setfield(L, -2, "h");
+    lua_pop(L, 1);
+}
+
+// -- fills the collision table at the top of the stack
+static void setCollisionFields(lua_State *L, const Collision &col)
+{
+    lua_pushnumber(L, col.item);
+    lua_setfield(L, -2, "item");
+    lua_pushnumber(L, col.other);
+    lua_setfield(L, -2, "other");
+    lua_pushnumber(L, col.type);
+    lua_setfield(L, -2, "type");
+    lua_pushboolean(L, col.overlaps);
+    lua_setfield(L, -2, "overlaps");
+    lua_pushnumber(L, col.ti);
+    lua_setfield(L, -2, "ti");
+
+    setPointField(L, "move", col.move);
+    setPointField(L, "normal", col.normal);
+    setPointField(L, "touch", col.touch);
+
+    if (col.type == Slide) {
+        setPointField(L, "slide", col.response);
+        lua_pushnil(L);
+        lua_setfield(L, -2, "bounce");
+    } else if (col.type == Bounce) {
+        setPointField(L, "bounce", col.response);
+        lua_pushnil(L);
+        lua_setfield(L, -2, "slide");
+    } else {
+        lua_pushnil(L);
+        lua_setfield(L, -2, "slide");
+        lua_pushnil(L);
+        lua_setfield(L, -2, "bounce");
+    }
+
+    setRectField(L, "itemRect", col.itemBox);
+    setRectField(L, "otherRect", col.otherBox);
+}
+
+// -- leaves the collisions on the stack as a result table (the one at narg
+// when given) and returns its length
+static int pushCollisions(lua_State *L, int narg,
+                          const std::vector<Collision> &cols)
+{
+    pushResultTable(L, narg, cols.size());
+    int n = 0;
+    for (std::vector<Collision>::const_iterator it = cols.begin();
+         it != cols.end(); it++) {
+        reuseTableAt(L, ++n, 12);
+        setCollisionFields(L, *it);
+        lua_pop(L, 1);
+    }
+    trimResultTable(L, n);
+    return n;
+}
+
+static int pushItems(lua_State *L, int narg, const std::set<int> &items)
+{
+    pushResultTable(L, narg, items.size());
+    int n = 0;
+    for (std::set<int>::const_iterator it = items.begin(); it != items.end();
+         it++) {
+        lua_pushnumber(L, *it);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    return n;
+}
+
 static int worldProject(lua_State *L)
 {
     BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
@@ -93,42 +237,42 @@ static int worldProject(lua_State *L)
         lua_setfield(L, -2, "ti");
 
         lua_newtable(L);
-        lua_pushnumber(L, (*it).move.x);
+        lua_pushnumber(L, (*it).move[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).move.y);
+        lua_pushnumber(L, (*it).move[1]);
         lua_setfield(L, -2, "y");
         lua_setfield(L, -2, "move");
         lua_newtable(L);
-        lua_pushnumber(L, (*it).normal.x);
+        lua_pushnumber(L, (*it).normal[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).normal.y);
+        lua_pushnumber(L, (*it).normal[1]);
         lua_setfield(L, -2, "y");
         lua_setfield(L, -2, "normal");
         lua_newtable(L);
-        lua_pushnumber(L, (*it).touch.x);
+        lua_pushnumber(L, (*it).touch[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).touch.y);
+        lua_pushnumber(L, (*it).touch[1]);
         lua_setfield(L, -2, "y");
         lua_setfield(L, -2, "touch");
 
         lua_newtable(L);
-        lua_pushnumber(L, (*it).itemRect.x);
+        lua_pushnumber(L, (*it).itemBox.pos[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).itemRect.y);
+        lua_pushnumber(L, (*it).itemBox.pos[1]);
         lua_setfield(L, -2, "y");
-        lua_pushnumber(L, (*it).itemRect.w);
+        lua_pushnumber(L, (*it).itemBox.size[0]);
         lua_setfield(L, -2, "w");
-        lua_pushnumber(L, (*it).itemRect.h);
+        lua_pushnumber(L, (*it).itemBox.size[1]);
         lua_setfield(L, -2, "h");
         lua_setfield(L, -2, "itemRect");
         lua_newtable(L);
-        lua_pushnumber(L, (*it).otherRect.x);
+        lua_pushnumber(L, (*it).otherBox.pos[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).otherRect.y);
+        lua_pushnumber(L, (*it).otherBox.pos[1]);
         lua_setfield(L, -2, "y");
-        lua_pushnumber(L, (*it).otherRect.w);
+        lua_pushnumber(L, (*it).otherBox.size[0]);
         lua_setfield(L, -2, "w");
-        lua_pushnumber(L, (*it).otherRect.h);
+        lua_pushnumber(L, (*it).otherBox.size[1]);
         lua_setfield(L, -2, "h");
         lua_setfield(L, -2, "otherRect");
 
@@ -216,14 +360,8 @@ static int worldQueryRect(lua_State *L)
     ItemFilter *f = NULL;
     std::set<int> items;
     world->queryRect(x, y, w, h, f, items);
-    lua_createtable(L, items.size(), 0);
-    int n = 0;
-    for (std::set<int>::iterator it = items.begin(); it != items.end(); it++) {
-        lua_pushnumber(L, *it);
-        lua_rawseti(L, -2, ++n);
-    }
-    lua_remove(L, -2);
-    return 1;
+    lua_pushinteger(L, pushItems(L, 6, items));
+    return 2;
 }
 
 static int worldQueryPoint(lua_State *L)
@@ -236,14 +374,8 @@ static int worldQueryPoint(lua_State *L)
     ItemFilter *f = NULL;
     std::set<int> items;
     world->queryPoint(x, y, f, items);
-    lua_createtable(L, items.size(), 0);
-    int n = 0;
-    for (std::set<int>::iterator it = items.begin(); it != items.end(); it++) {
-        lua_pushnumber(L, *it);
-        lua_rawseti(L, -2, ++n);
-    }
-    lua_remove(L, -2);
-    return 1;
+    lua_pushinteger(L, pushItems(L, 4, items));
+    return 2;
 }
 
 static int worldQuerySegment(lua_State *L)
@@ -258,14 +390,150 @@ static int worldQuerySegment(lua_State *L)
     ItemFilter *f = NULL;
     std::set<int> items;
     world->querySegment(x1, y1, x2, y2, f, items);
-    lua_createtable(L, items.size(), 0);
+    lua_pushinteger(L, pushItems(L, 6, items));
+    return 2;
+}
+
+// world:queryPolygon({x1, y1, x2, y2, ...} [, out]) -> items overlapping the
+// convex polygon of those points, in either winding, and their count
+static int worldQueryPolygon(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 2 == 0 && len >= 6, 2,
+                  "expected at least 3 points {x1, y1, x2, y2, x3, y3, ...}");
+    std::vector<double> xy(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        xy[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+
+    ItemFilter *f = NULL;
+    std::set<int> items;
+    world->queryPolygon(xy.data(), len / 2, f, items);
+    lua_pushinteger(L, pushItems(L, 3, items));
+    return 2;
+}
+
+// world:queryOrientedRect(cx, cy, w, h, angle [, out]) -> items overlapping
+// the w x h rect centered on cx, cy and turned by angle radians
+static int worldQueryOrientedRect(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    double cx         = luaL_checknumber(L, 2);
+    double cy         = luaL_checknumber(L, 3);
+    assertIsPositiveNumber(L, 4, "w");
+    assertIsPositiveNumber(L, 5, "h");
+    double w     = lua_tonumber(L, 4);
+    double h     = lua_tonumber(L, 5);
+    double angle = luaL_checknumber(L, 6);
+
+    ItemFilter *f = NULL;
+    std::set<int> items;
+    world->queryOrientedRect(cx, cy, w, h, angle, f, items);
+    lua_pushinteger(L, pushItems(L, 7, items));
+    return 2;
+}
+
+// shared driver for queryPointMany and firstHitMany: the points are answered
+// in one batch, grouped by cell
+static int pointMany(lua_State *L, bool first)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 2 == 0, 2, "expected {x, y, ...}");
+    std::vector<double> points(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        points[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+    int count = len / 2;
+    std::vector<int> start, items;
+    world->queryPointMany(points.data(), count, NULL, first, start, items);
+
+    pushResultTable(L, 3, first ? count : count + items.size());
     int n = 0;
-    for (std::set<int>::iterator it = items.begin(); it != items.end(); it++) {
-        lua_pushnumber(L, *it);
+    for (int i = 0; i < count; i++) {
+        if (first) {
+            lua_pushinteger(L, start[i] < start[i + 1] ? items[start[i]] : 0);
+            lua_rawseti(L, -2, ++n);
+            continue;
+        }
+        lua_pushinteger(L, start[i + 1] - start[i]);
         lua_rawseti(L, -2, ++n);
+        for (int k = start[i]; k < start[i + 1]; k++) {
+            lua_pushinteger(L, items[k]);
+            lua_rawseti(L, -2, ++n);
+        }
     }
-    lua_remove(L, -2);
-    return 1;
+    trimResultTable(L, n);
+    lua_pushinteger(L, n);
+    return 2;
+}
+
+// world:queryPointMany({x, y, ...} [, out]) -> out = {n1, id..., n2, id...},
+// #out
+static int worldQueryPointMany(lua_State *L)
+{
+    return pointMany(L, false);
+}
+
+// world:firstHitMany({x, y, ...} [, out]) -> out = {id1, id2, ...}, the
+// lowest id of an item holding each point or 0 for none, and #out
+static int worldFirstHitMany(lua_State *L)
+{
+    return pointMany(L, true);
+}
+
+// world:lineOfSightMany({x1, y1, x2, y2, ...} [, transparent [, out]]) ->
+// out, number of segments. Bit (i - 1) % 32 of out[(i - 1) // 32 + 1] is set
+// when no item crosses segment i, items listed in transparent (the viewers
+// and their targets, say) excepted. Each walk stops at its first hit.
+static int worldLineOfSightMany(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 4 == 0, 2, "expected {x1, y1, x2, y2, ...}");
+
+    bump::ExcludeFilter transparent;
+    if (!lua_isnoneornil(L, 3)) {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        int n = (int)lua_rawlen(L, 3);
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, 3, i);
+            transparent.excluded.insert((int)lua_tointeger(L, -1));
+            lua_pop(L, 1);
+        }
+    }
+
+    std::vector<double> segments(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        segments[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+    std::vector<unsigned> clear;
+    world->lineOfSightMany(segments.data(), len / 4, &transparent, clear);
+
+    pushResultTable(L, 4, clear.size());
+    int n = 0;
+    for (std::vector<unsigned>::iterator it = clear.begin(); it != clear.end();
+         it++) {
+        lua_pushinteger(L, *it);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, len / 4);
+    return 2;
 }
 
 // static int worldQuerySegmentWithCoords(lua_State *L)
@@ -335,6 +603,105 @@ static int worldRemove(lua_State *L)
     return 0;
 }
 
+// world:addMany({x, y, w, h, ...}) -> {id1, id2, ...}, number of rects added
+static int worldAddMany(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 4 == 0, 2, "expected {x, y, w, h, ...}");
+
+    static const char *names[] = {"x", "y", "w", "h"};
+    int count = len / 4;
+    std::vector<double> packed(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        int isnum;
+        packed[i] = lua_tonumberx(L, -1, &isnum);
+        lua_pop(L, 1);
+        if (!isnum || (i % 4 >= 2 && packed[i] <= 0)) {
+            return luaL_error(L, "rect %d: %s must be a %snumber", i / 4 + 1,
+                              names[i % 4], i % 4 >= 2 ? "positive " : "");
+        }
+    }
+
+    std::vector<int> ids(count);
+    world->addMany(packed.data(), count, ids.data());
+
+    lua_createtable(L, count, 0);
+    for (int i = 0; i < count; i++) {
+        lua_pushinteger(L, ids[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_pushinteger(L, count);
+    return 2;
+}
+
+// world:addTilemap(data, width, height, tileSize [, solidMask]) -> ids, tiles
+// data holds width * height tile values, row by row; a tile is solid when
+// value & solidMask is not 0 (by default, when it is not 0). Solid tiles are
+// merged into as few rects as the greedy pass finds; tiles[i] is the item
+// covering data[i], nil for open tiles.
+static int worldAddTilemap(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_Integer width  = luaL_checkinteger(L, 3);
+    lua_Integer height = luaL_checkinteger(L, 4);
+    assertIsPositiveNumber(L, 5, "tileSize");
+    double tileSize = lua_tonumber(L, 5);
+    lua_Integer mask = luaL_optinteger(L, 6, -1);
+    luaL_argcheck(L, width > 0 && width < INT_MAX, 3, "must be positive");
+    luaL_argcheck(L, height > 0 && height < INT_MAX / width, 4,
+                  "must be positive");
+    luaL_argcheck(L, (lua_Integer)lua_rawlen(L, 2) >= width * height, 2,
+                  "expected width * height tiles");
+
+    int n = width * height;
+    std::vector<bool> solid(n);
+    for (int i = 0; i < n; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        solid[i] = (lua_tointeger(L, -1) & mask) != 0;
+        lua_pop(L, 1);
+    }
+
+    std::vector<int> ids, tiles;
+    world->addTilemap(solid, width, height, tileSize, ids, tiles);
+
+    lua_createtable(L, ids.size(), 0);
+    for (size_t i = 0; i < ids.size(); i++) {
+        lua_pushinteger(L, ids[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_createtable(L, n, 0);
+    for (int i = 0; i < n; i++) {
+        if (tiles[i]) {
+            lua_pushinteger(L, tiles[i]);
+            lua_rawseti(L, -2, i + 1);
+        }
+    }
+    return 2;
+}
+
+// world:removeMany({id1, id2, ...}); ids not in the world are skipped
+static int worldRemoveMany(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    std::vector<int> items(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        items[i] = (int)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+    }
+    world->removeMany(items.data(), len);
+    return 0;
+}
+
 static int worldClear(lua_State *L)
 {
     BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
@@ -369,162 +736,1035 @@ static int worldMove(lua_State *L)
     double ax, ay;
     std::vector<Collision> items;
     world->move(item, x, y, filter, ax, ay, items);
-    int n = 0;
-    lua_createtable(L, items.size(), 0);
-    for (std::vector<Collision>::iterator it = items.begin(); it != items.end();
-         it++) {
-        lua_createtable(L, 0, 10);
-        lua_pushnumber(L, (*it).item);
-        lua_setfield(L, -2, "item");
-        lua_pushnumber(L, (*it).other);
-        lua_setfield(L, -2, "other");
-        lua_pushnumber(L, (*it).type);
-        lua_setfield(L, -2, "type");
-        lua_pushboolean(L, (*it).overlaps);
-        lua_setfield(L, -2, "overlaps");
-        lua_pushnumber(L, (*it).ti);
-        lua_setfield(L, -2, "ti");
+    lua_pushnumber(L, ax);
+    lua_pushnumber(L, ay);
+    lua_pushinteger(L, pushCollisions(L, 6, items));
 
-        lua_createtable(L, 0, 2);
-        lua_pushnumber(L, (*it).move.x);
-        lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).move.y);
-        lua_setfield(L, -2, "y");
-        lua_setfield(L, -2, "move");
-        lua_createtable(L, 0, 2);
-        lua_pushnumber(L, (*it).normal.x);
-        lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).normal.y);
-        lua_setfield(L, -2, "y");
-        lua_setfield(L, -2, "normal");
-        lua_createtable(L, 0, 2);
-        lua_pushnumber(L, (*it).touch.x);
-        lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).touch.y);
-        lua_setfield(L, -2, "y");
-        lua_setfield(L, -2, "touch");
+    return 4;
+}
 
-        if (((*it).type == Bounce) || ((*it).type == Slide)) {
-            lua_createtable(L, 0, 2);
-            lua_pushnumber(L, (*it).response.x);
-            lua_setfield(L, -2, "x");
-            lua_pushnumber(L, (*it).response.y);
-            lua_setfield(L, -2, "y");
-            lua_pushnumber(L, (*it).type);
-            lua_setfield(L, -2, "type");
+// world:moveSwept({id1, gx1, gy1, id2, ...} [, filter [, out [, cols]]])
+// moves distinct items together, with the time of impact between two movers
+// taken from their relative motion. out = {ax1, ay1, ncols1, ax2, ...};
+// cols receives the collisions of every mover in order. Returns out, the
+// number of moves, cols and its length.
+static int worldMoveSwept(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    luaL_checktype(L, 2, LUA_TTABLE);
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 3, Slide));
+    luaL_argcheck(L, filter, 3, "unknown response type");
+
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 3 == 0, 2, "expected {item, x, y, ...}");
+    int count = len / 3;
+    std::vector<int> items(count);
+    std::vector<double> goals(2 * count);
+    std::set<int> seen;
+    for (int i = 0; i < count; i++) {
+        lua_rawgeti(L, 2, 3 * i + 1);
+        lua_rawgeti(L, 2, 3 * i + 2);
+        lua_rawgeti(L, 2, 3 * i + 3);
+        items[i]         = (int)lua_tointeger(L, -3);
+        goals[2 * i]     = lua_tonumber(L, -2);
+        goals[2 * i + 1] = lua_tonumber(L, -1);
+        lua_pop(L, 3);
+        if (!world->hasItem(items[i])) {
+            return luaL_error(L, "Item %d must be added to the world before "
+                                 "being used",
+                              items[i]);
         }
+        luaL_argcheck(L, seen.insert(items[i]).second, 2,
+                      "an item moves more than once");
+    }
 
-        lua_createtable(L, 0, 4);
-        lua_pushnumber(L, (*it).itemRect.x);
-        lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).itemRect.y);
-        lua_setfield(L, -2, "y");
-        lua_pushnumber(L, (*it).itemRect.w);
-        lua_setfield(L, -2, "w");
-        lua_pushnumber(L, (*it).itemRect.h);
-        lua_setfield(L, -2, "h");
-        lua_setfield(L, -2, "itemRect");
-        lua_createtable(L, 0, 4);
-        lua_pushnumber(L, (*it).otherRect.x);
-        lua_setfield(L, -2, "x");
-        lua_pushnumber(L, (*it).otherRect.y);
-        lua_setfield(L, -2, "y");
-        lua_pushnumber(L, (*it).otherRect.w);
-        lua_setfield(L, -2, "w");
-        lua_pushnumber(L, (*it).otherRect.h);
-        lua_setfield(L, -2, "h");
-        lua_setfield(L, -2, "otherRect");
+    std::vector<double> actual(2 * count);
+    std::vector<int> ncols(count);
+    std::vector<Collision> cols;
+    if (count > 0) {
+        world->moveSwept(items.data(), goals.data(), count, filter,
+                         actual.data(), ncols.data(), cols);
+    }
 
+    pushResultTable(L, 4, len);
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        lua_pushnumber(L, actual[2 * i]);
+        lua_rawseti(L, -2, ++n);
+        lua_pushnumber(L, actual[2 * i + 1]);
+        lua_rawseti(L, -2, ++n);
+        lua_pushinteger(L, ncols[i]);
         lua_rawseti(L, -2, ++n);
     }
-    lua_pushnumber(L, ax);
-    lua_pushnumber(L, ay);
-    lua_pushvalue(L, -3);
-    lua_remove(L, -4);
-    lua_pushinteger(L, n);
-
+    trimResultTable(L, n);
+    lua_pushinteger(L, count);
+    lua_pushinteger(L, pushCollisions(L, 5, cols));
     return 4;
 }
 
-static int worldCellSize(lua_State *L)
+// world:setBody(item, vx, vy [, gx, gy [, response]]) makes item a body that
+// world:step() moves with velocity (vx, vy) and gravity (gx, gy), using
+// response (default slide)
+static int worldSetBody(lua_State *L)
 {
-    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
-    World *world      = bump->world;
-    lua_pushnumber(L, world->cellSize);
-    return 1;
+    BumpWorld2d *bump  = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world       = bump->world;
+    int item           = luaL_checkinteger(L, 2);
+    double velocity[2] = {luaL_checknumber(L, 3), luaL_checknumber(L, 4)};
+    double gravity[2]  = {luaL_optnumber(L, 5, 0), luaL_optnumber(L, 6, 0)};
+    int response       = luaL_optinteger(L, 7, Slide);
+    if (!world->hasItem(item)) {
+        return luaL_error(L, "Item %d must be added to the world before "
+                             "being used",
+                          item);
+    }
+    luaL_argcheck(L, world->getFilterById(response), 7,
+                  "unknown response type");
+    world->setBody(item, velocity, gravity, response);
+    return 0;
 }
 
-static int bumpWorldRelease(lua_State *L)
+// world:getBody(item) -> vx, vy, gx, gy, response, or nil when item is not
+// a body
+static int worldGetBody(lua_State *L)
 {
-    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
-    if (NULL == bump) {
-        return luaL_argerror(L, 1, "invalid lua-bump pointer");
+    BumpWorld2d *bump   = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world        = bump->world;
+    bump::Body<2> *body = world->getBody(luaL_checkinteger(L, 2));
+    if (body == NULL) {
+        lua_pushnil(L);
+        return 1;
     }
+    lua_pushnumber(L, body->velocity[0]);
+    lua_pushnumber(L, body->velocity[1]);
+    lua_pushnumber(L, body->gravity[0]);
+    lua_pushnumber(L, body->gravity[1]);
+    lua_pushinteger(L, body->response);
+    return 5;
+}
 
-    bump->world->release();
-    delete bump->world;
-    bump->world = NULL;
+static int worldRemoveBody(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    world->removeBody(luaL_checkinteger(L, 2));
     return 0;
 }
 
-static int bumpNewWorld(lua_State *L)
+// world:step(dt [, out]) moves every body and returns the ones that
+// collided, and their count
+static int worldStep(lua_State *L)
 {
-    int cellSize = luaL_optinteger(L, 1, 64);
-
-    BumpWorld2d *bump = (BumpWorld2d *)lua_newuserdatauv(L, sizeof(BumpWorld2d), 0);
-    World *world      = new World();
-    world->initialize(cellSize);
-    bump->world       = world;
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    double dt         = luaL_checknumber(L, 2);
+    std::vector<int> hit;
+    world->step(dt, hit);
 
-    if (luaL_newmetatable(L, METANAME)) // mt
-    {
-        luaL_Reg l[] = {
-            {"project",      worldProject     },
-            {"countCells",   worldCountCells  },
-            {"hasItem",      worldHasItem     },
-            {"countItems",   worldCountItems  },
-            {"getRect",      worldGetRect     },
-            {"toWorld",      worldToWorld     },
-            {"toCell",       worldToCell      },
-            {"queryRect",    worldQueryRect   },
-            {"queryPoint",   worldQueryPoint  },
-            {"querySegment", worldQuerySegment},
- // {"querySegmentWithCoords", worldQuerySegmentWithCoords},
-            {"add",          worldAdd         },
-            {"remove",       worldRemove      },
-            {"update",       worldUpdate      },
-            {"move",         worldMove        },
-            {"cellSize",     worldCellSize    },
-            {"clear",        worldClear       },
-            {NULL,           NULL             }
-        };
-        luaL_newlib(L, l);              //{}
-        lua_setfield(L, -2, "__index"); // mt[__index] = {}
-        lua_pushcfunction(L, bumpWorldRelease);
-        lua_setfield(L, -2, "__gc"); // mt[__gc] = bumpWorldRelease
+    pushResultTable(L, 3, hit.size());
+    int n = 0;
+    for (std::vector<int>::iterator it = hit.begin(); it != hit.end(); it++) {
+        lua_pushinteger(L, *it);
+        lua_rawseti(L, -2, ++n);
     }
-    lua_setmetatable(L, -2); // set userdata metatable
-    return 1;
+    trimResultTable(L, n);
+    lua_pushinteger(L, n);
+    return 2;
 }
 
-static int rectGetNearestCorner(lua_State *L)
+//-- Lazy move results: world:moveLazy() copies the collisions into one
+//-- userdata array, and cols:other(i), cols:normal(i), ... read single
+//-- fields of it as plain numbers, without building any table.
+#define COLLISIONS_METANAME "_bump_collisions_2d"
+
+struct CollisionArray2d {
+    size_t n;
+    Collision cols[1];
+};
+
+static const Collision &checkCollision(lua_State *L)
 {
-    double x1 = luaL_checknumber(L, 1);
-    double y1 = luaL_checknumber(L, 2);
-    double w1 = luaL_checknumber(L, 3);
-    double h1 = luaL_checknumber(L, 4);
-    double px = luaL_checknumber(L, 5);
-    double py = luaL_checknumber(L, 6);
-    double nx, ny;
-    rect_getNearestCorner(x1, y1, w1, h1, px, py, nx, ny);
-    lua_pushnumber(L, nx);
-    lua_pushnumber(L, ny);
-    return 2;
+    CollisionArray2d *arr =
+        (CollisionArray2d *)luaL_checkudata(L, 1, COLLISIONS_METANAME);
+    lua_Integer i = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, i >= 1 && (size_t)i <= arr->n, 2,
+                  "collision index out of range");
+    return arr->cols[i - 1];
 }
 
-static int rectGetSegmentIntersectionIndices(lua_State *L)
+static int pushPair(lua_State *L, const double *v)
 {
-    double x1  = luaL_checknumber(L, 1);
+    lua_pushnumber(L, v[0]);
+    lua_pushnumber(L, v[1]);
+    return 2;
+}
+
+static int pushBox(lua_State *L, const bump::Box<2> &b)
+{
+    pushPair(L, b.pos);
+    pushPair(L, b.size);
+    return 4;
+}
+
+// cols:other(i), cols:item(i), cols:type(i), cols:ti(i) -> number
+static int collisionsOther(lua_State *L)
+{
+    lua_pushnumber(L, checkCollision(L).other);
+    return 1;
+}
+
+static int collisionsItem(lua_State *L)
+{
+    lua_pushnumber(L, checkCollision(L).item);
+    return 1;
+}
+
+static int collisionsType(lua_State *L)
+{
+    lua_pushnumber(L, checkCollision(L).type);
+    return 1;
+}
+
+static int collisionsTi(lua_State *L)
+{
+    lua_pushnumber(L, checkCollision(L).ti);
+    return 1;
+}
+
+// cols:overlaps(i) -> boolean
+static int collisionsOverlaps(lua_State *L)
+{
+    lua_pushboolean(L, checkCollision(L).overlaps);
+    return 1;
+}
+
+// cols:normal(i), cols:move(i), cols:touch(i) -> x, y
+static int collisionsNormal(lua_State *L)
+{
+    return pushPair(L, checkCollision(L).normal);
+}
+
+static int collisionsMove(lua_State *L)
+{
+    return pushPair(L, checkCollision(L).move);
+}
+
+static int collisionsTouch(lua_State *L)
+{
+    return pushPair(L, checkCollision(L).touch);
+}
+
+// cols:slide(i), cols:bounce(i) -> x, y, or nil for another response
+static int collisionsResponse(lua_State *L, int type)
+{
+    const Collision &col = checkCollision(L);
+    if (col.type != type) {
+        lua_pushnil(L);
+        return 1;
+    }
+    return pushPair(L, col.response);
+}
+
+static int collisionsSlide(lua_State *L)
+{
+    return collisionsResponse(L, Slide);
+}
+
+static int collisionsBounce(lua_State *L)
+{
+    return collisionsResponse(L, Bounce);
+}
+
+// cols:itemRect(i), cols:otherRect(i) -> x, y, w, h
+static int collisionsItemRect(lua_State *L)
+{
+    return pushBox(L, checkCollision(L).itemBox);
+}
+
+static int collisionsOtherRect(lua_State *L)
+{
+    return pushBox(L, checkCollision(L).otherBox);
+}
+
+static int collisionsLen(lua_State *L)
+{
+    CollisionArray2d *arr =
+        (CollisionArray2d *)luaL_checkudata(L, 1, COLLISIONS_METANAME);
+    lua_pushinteger(L, arr->n);
+    return 1;
+}
+
+static void pushCollisionArray(lua_State *L, const std::vector<Collision> &cols)
+{
+    size_t n    = cols.size();
+    size_t size = sizeof(CollisionArray2d) + (n ? n - 1 : 0) * sizeof(Collision);
+    CollisionArray2d *arr = (CollisionArray2d *)lua_newuserdatauv(L, size, 0);
+    arr->n                = n;
+    if (n) {
+        memcpy(arr->cols, &cols[0], n * sizeof(Collision));
+    }
+    if (luaL_newmetatable(L, COLLISIONS_METANAME)) {
+        luaL_Reg l[] = {
+            {"other",     collisionsOther    },
+            {"item",      collisionsItem     },
+            {"type",      collisionsType     },
+            {"ti",        collisionsTi       },
+            {"overlaps",  collisionsOverlaps },
+            {"normal",    collisionsNormal   },
+            {"move",      collisionsMove     },
+            {"touch",     collisionsTouch    },
+            {"slide",     collisionsSlide    },
+            {"bounce",    collisionsBounce   },
+            {"itemRect",  collisionsItemRect },
+            {"otherRect", collisionsOtherRect},
+            {NULL,        NULL               }
+        };
+        luaL_newlib(L, l);
+        lua_setfield(L, -2, "__index");
+        lua_pushcfunction(L, collisionsLen);
+        lua_setfield(L, -2, "__len");
+    }
+    lua_setmetatable(L, -2);
+}
+
+// world:moveLazy(item, x, y [, filter]) -> x, y, cols, len like world:move(),
+// with cols a userdata array read through cols:other(i), cols:normal(i), ...
+static int worldMoveLazy(lua_State *L)
+{
+    World *world      = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    int item          = lua_tonumber(L, 2);
+    double x          = luaL_checknumber(L, 3);
+    double y          = luaL_checknumber(L, 4);
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 5, Slide));
+    luaL_argcheck(L, filter, 5, "unknown response type");
+
+    double ax, ay;
+    std::vector<Collision> cols;
+    world->move(item, x, y, filter, ax, ay, cols);
+    lua_pushnumber(L, ax);
+    lua_pushnumber(L, ay);
+    pushCollisionArray(L, cols);
+    lua_pushinteger(L, cols.size());
+    return 4;
+}
+
+// -- reads the cell sizes at narg, narg + 1, ...: one per axis, each
+// defaulting to the one before it, the first to def when def > 0
+static void checkCellSizes(lua_State *L, int narg, double def, double *sizes)
+{
+    for (int a = 0; a < 2; a++) {
+        double d = (a == 0) ? def : sizes[a - 1];
+        sizes[a] = (d > 0) ? luaL_optnumber(L, narg + a, d)
+                           : luaL_checknumber(L, narg + a);
+        luaL_argcheck(L, sizes[a] > 0 && sizes[a] < HUGE_VAL, narg + a,
+                      "cell size must be a positive number");
+    }
+}
+
+// world:cellSize() -> the cell width, height
+static int worldCellSize(lua_State *L)
+{
+    World *world = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    for (int a = 0; a < 2; a++) {
+        lua_pushnumber(L, world->cellSize.size[a]);
+    }
+    return 2;
+}
+
+// world:suggestCellSize([reset]) -> cell sizes for the current items and the
+// queries seen so far, one per axis; reset forgets those queries
+static int worldSuggestCellSize(lua_State *L)
+{
+    World *world = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    double sizes[2];
+    world->suggestCellSize(sizes);
+    if (lua_toboolean(L, 2)) {
+        world->resetFootprints();
+    }
+    for (int a = 0; a < 2; a++) {
+        lua_pushnumber(L, sizes[a]);
+    }
+    return 2;
+}
+
+// world:rebuild(w, h) -> re-buckets every item under the new cell sizes;
+// omitted ones repeat the one before
+static int worldRebuild(lua_State *L)
+{
+    World *world = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    double sizes[2];
+    checkCellSizes(L, 2, 0, sizes);
+    world->rebuild(sizes);
+    return 0;
+}
+
+/*------------------------------------------
+-- Navigation
+--
+-- world:setNavigation() keeps a walkability bitmap in the world, updated on
+-- every add, update and remove, which findPath() and flowField() search.
+------------------------------------------*/
+#define FLOWFIELD_METANAME "_bump_flowfield_2d"
+
+//-- a flow field with its own copy of the tile geometry, so it stays
+//-- usable after the world changes; next[n] is followed by dist[n]
+struct FlowField2d {
+    bump::NavTiles<2> tiles;
+    int n;
+    int data[1];
+};
+
+static bump::NavGrid<2> &checkNavigation(lua_State *L, World *world)
+{
+    if (!world->nav.enabled()) {
+        luaL_error(L, "navigation is not set up, see world:setNavigation()");
+    }
+    return world->nav;
+}
+
+// world:setNavigation(x, y, w, h, tileWidth [, tileHeight]) rasterizes every
+// item but the passable ones into tiles over that area
+static int worldSetNavigation(lua_State *L)
+{
+    World *world = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    double pos[2], size[2], tiles[2];
+    for (int a = 0; a < 2; a++) {
+        pos[a]  = luaL_checknumber(L, 2 + a);
+        size[a] = luaL_checknumber(L, 4 + a);
+        luaL_argcheck(L, size[a] > 0, 4 + a, "area must not be empty");
+    }
+    checkCellSizes(L, 6, 0, tiles);
+    double total = 1;
+    for (int a = 0; a < 2; a++) {
+        total *= ceil(size[a] / tiles[a]);
+    }
+    luaL_argcheck(L, total <= (1 << 24), 6,
+                  "area covers too many tiles for their size");
+    world->navigate(pos, size, tiles);
+    return 0;
+}
+
+// world:setPassable(item [, passable]): a passable item (an agent, a pickup)
+// does not block paths; passable defaults to true
+static int worldSetPassable(lua_State *L)
+{
+    World *world = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    int item     = luaL_checkinteger(L, 2);
+    if (!world->hasItem(item)) {
+        return luaL_error(L, "Item %d must be added to the world before "
+                             "being used",
+                          item);
+    }
+    world->setPassable(item, lua_isnoneornil(L, 3) || lua_toboolean(L, 3));
+    return 0;
+}
+
+// world:isWalkable(x, y) -> false outside the navigation area
+static int worldIsWalkable(lua_State *L)
+{
+    World *world          = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    bump::NavGrid<2> &nav = checkNavigation(L, world);
+    double p[2]           = {luaL_checknumber(L, 2), luaL_checknumber(L, 3)};
+    int c[2];
+    lua_pushboolean(L, nav.toTile(p, c) && nav.walkable(c));
+    return 1;
+}
+
+// world:findPath(x1, y1, x2, y2 [, out]) -> {x, y, x, y, ...}, number of
+// points: the tile centers from the start tile to the goal one, or nil when
+// the goal cannot be reached
+static int worldFindPath(lua_State *L)
+{
+    World *world          = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    bump::NavGrid<2> &nav = checkNavigation(L, world);
+    double p1[2]          = {luaL_checknumber(L, 2), luaL_checknumber(L, 3)};
+    double p2[2]          = {luaL_checknumber(L, 4), luaL_checknumber(L, 5)};
+    int c1[2], c2[2];
+    std::vector<int> path;
+    if (!nav.toTile(p1, c1) || !nav.toTile(p2, c2) ||
+        !nav.findPath(c1, c2, path)) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    pushResultTable(L, 6, 2 * path.size());
+    int n = 0;
+    for (std::vector<int>::iterator it = path.begin(); it != path.end();
+         it++) {
+        int c[2];
+        double p[2];
+        nav.tileOf(*it, c);
+        nav.toWorld(c, p);
+        lua_pushnumber(L, p[0]);
+        lua_rawseti(L, -2, ++n);
+        lua_pushnumber(L, p[1]);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, path.size());
+    return 2;
+}
+
+//-- the tile of the point at 2, 3 in field, or -1 outside its area
+static int flowFieldTile(lua_State *L, FlowField2d *field)
+{
+    double p[2] = {luaL_checknumber(L, 2), luaL_checknumber(L, 3)};
+    int c[2];
+    return field->tiles.toTile(p, c) ? field->tiles.index(c) : -1;
+}
+
+// field:next(x, y) -> the center of the tile to head for, or nil when the
+// goal cannot be reached from there
+static int flowFieldNext(lua_State *L)
+{
+    FlowField2d *field =
+        (FlowField2d *)luaL_checkudata(L, 1, FLOWFIELD_METANAME);
+    int i = flowFieldTile(L, field);
+    if (i < 0 || field->data[i] < 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+    int c[2];
+    double p[2];
+    field->tiles.tileOf(field->data[i], c);
+    field->tiles.toWorld(c, p);
+    lua_pushnumber(L, p[0]);
+    lua_pushnumber(L, p[1]);
+    return 2;
+}
+
+// field:distance(x, y) -> steps left to the goal, or nil
+static int flowFieldDistance(lua_State *L)
+{
+    FlowField2d *field =
+        (FlowField2d *)luaL_checkudata(L, 1, FLOWFIELD_METANAME);
+    int i = flowFieldTile(L, field);
+    if (i < 0 || field->data[field->n + i] < 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushinteger(L, field->data[field->n + i]);
+    return 1;
+}
+
+// world:flowField(x, y) -> a field that leads every agent toward the tile of
+// x, y; see field:next() and field:distance()
+static int worldFlowField(lua_State *L)
+{
+    World *world          = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    bump::NavGrid<2> &nav = checkNavigation(L, world);
+    double p[2]           = {luaL_checknumber(L, 2), luaL_checknumber(L, 3)};
+    int c[2];
+    std::vector<int> next, dist;
+    if (nav.toTile(p, c)) {
+        nav.flowField(c, next, dist);
+    } else {
+        next.assign(nav.blockers.size(), -1);
+        dist.assign(nav.blockers.size(), -1);
+    }
+
+    int n              = (int)next.size();
+    FlowField2d *field = (FlowField2d *)lua_newuserdatauv(
+        L, sizeof(FlowField2d) + (2 * n - 1) * sizeof(int), 0);
+    field->tiles = nav;
+    field->n     = n;
+    std::copy(next.begin(), next.end(), field->data);
+    std::copy(dist.begin(), dist.end(), field->data + n);
+    if (luaL_newmetatable(L, FLOWFIELD_METANAME)) {
+        luaL_Reg l[] = {
+            {"next",     flowFieldNext    },
+            {"distance", flowFieldDistance},
+            {NULL,       NULL             }
+        };
+        luaL_newlib(L, l);
+        lua_setfield(L, -2, "__index");
+    }
+    lua_setmetatable(L, -2);
+    return 1;
+}
+
+// world:counters([reset]) -> table of hot-path operation counts, or nil when
+// the module was built without BUMP_COUNTERS
+static int worldCounters(lua_State *L)
+{
+#ifdef BUMP_COUNTERS
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    World *world      = bump->world;
+    Counters &c       = world->counters;
+
+    lua_createtable(L, 0, 7);
+    lauxh_pushint2tbl(L, "cellsVisited", c.cellsVisited);
+    lauxh_pushint2tbl(L, "candidates", c.candidates);
+    lauxh_pushint2tbl(L, "dedupeHits", c.dedupeHits);
+    lauxh_pushint2tbl(L, "detectCalls", c.detectCalls);
+    lauxh_pushint2tbl(L, "detectHits", c.detectHits);
+    lauxh_pushint2tbl(L, "responseIters", c.responseIters);
+    lauxh_pushint2tbl(L, "traverseSteps", c.traverseSteps);
+    if (lua_toboolean(L, 2)) {
+        c.reset();
+    }
+#else
+    lua_pushnil(L);
+#endif
+    return 1;
+}
+
+static int bumpWorldRelease(lua_State *L)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_touserdata(L, 1);
+    if (NULL == bump) {
+        return luaL_argerror(L, 1, "invalid lua-bump pointer");
+    }
+
+    bump->world->release();
+    delete bump->world;
+    bump->world = NULL;
+    return 0;
+}
+
+// world:save(path) -> true, or nil and an error message
+static int worldSave(lua_State *L)
+{
+    World *world    = ((BumpWorld2d *)lua_touserdata(L, 1))->world;
+    const char *err = bump::snapshot_save(*world, luaL_checkstring(L, 2));
+    if (err) {
+        lua_pushnil(L);
+        lua_pushstring(L, err);
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static World *pushWorld(lua_State *L, const double *cellSizes)
+{
+    BumpWorld2d *bump = (BumpWorld2d *)lua_newuserdatauv(L, sizeof(BumpWorld2d), 0);
+    World *world      = new World();
+    world->initialize(cellSizes);
+    bump->world       = world;
+
+    if (luaL_newmetatable(L, METANAME)) // mt
+    {
+        luaL_Reg l[] = {
+            {"project",           worldProject          },
+            {"countCells",        worldCountCells       },
+            {"hasItem",           worldHasItem          },
+            {"countItems",        worldCountItems       },
+            {"getRect",           worldGetRect          },
+            {"toWorld",           worldToWorld          },
+            {"toCell",            worldToCell           },
+            {"queryRect",         worldQueryRect        },
+            {"queryPoint",        worldQueryPoint       },
+            {"querySegment",      worldQuerySegment     },
+            {"queryPolygon",      worldQueryPolygon     },
+            {"queryOrientedRect", worldQueryOrientedRect},
+            {"queryPointMany",    worldQueryPointMany   },
+            {"firstHitMany",      worldFirstHitMany     },
+            {"lineOfSightMany",   worldLineOfSightMany  },
+ // {"querySegmentWithCoords", worldQuerySegmentWithCoords},
+            {"add",               worldAdd              },
+            {"remove",            worldRemove           },
+            {"addMany",           worldAddMany          },
+            {"removeMany",        worldRemoveMany       },
+            {"addTilemap",        worldAddTilemap       },
+            {"update",            worldUpdate           },
+            {"move",              worldMove             },
+            {"moveLazy",          worldMoveLazy         },
+            {"moveSwept",         worldMoveSwept        },
+            {"setBody",           worldSetBody          },
+            {"getBody",           worldGetBody          },
+            {"removeBody",        worldRemoveBody       },
+            {"step",              worldStep             },
+            {"setNavigation",     worldSetNavigation    },
+            {"setPassable",       worldSetPassable      },
+            {"isWalkable",        worldIsWalkable       },
+            {"findPath",          worldFindPath         },
+            {"flowField",         worldFlowField        },
+            {"cellSize",          worldCellSize         },
+            {"suggestCellSize",   worldSuggestCellSize  },
+            {"rebuild",           worldRebuild          },
+            {"clear",             worldClear            },
+            {"counters",          worldCounters         },
+            {"save",              worldSave             },
+            {NULL,                NULL                  }
+        };
+        luaL_newlib(L, l);              //{}
+        lua_setfield(L, -2, "__index"); // mt[__index] = {}
+        lua_pushcfunction(L, bumpWorldRelease);
+        lua_setfield(L, -2, "__gc"); // mt[__gc] = bumpWorldRelease
+    }
+    lua_setmetatable(L, -2); // set userdata metatable
+    return world;
+}
+
+// bump2d.load(path) -> a world rebuilt from world:save(), or nil and an error
+// message
+static int bumpLoad(lua_State *L)
+{
+    const char *path    = luaL_checkstring(L, 1);
+    double cellSizes[2] = {64, 64};
+    World *world        = pushWorld(L, cellSizes);
+    const char *err     = bump::snapshot_load(*world, path);
+    if (err) {
+        lua_pushnil(L);
+        lua_pushstring(L, err);
+        return 2;
+    }
+    return 1;
+}
+
+// bump2d.newWorld([cellWidth [, cellHeight]]) -> a world whose cells may be
+// non-square and fractional; the height defaults to the width
+static int bumpNewWorld(lua_State *L)
+{
+    double cellSizes[2];
+    checkCellSizes(L, 1, 64, cellSizes);
+    pushWorld(L, cellSizes);
+    return 1;
+}
+
+// bump2d.newBoundedWorld(x, y, w, h [, cellWidth [, cellHeight]]) -> a world
+// that keeps the cells over the given area in a flat array; items may still
+// leave it
+static int bumpNewBoundedWorld(lua_State *L)
+{
+    double pos[2], size[2], cellSizes[2];
+    for (int a = 0; a < 2; a++) {
+        pos[a]  = luaL_checknumber(L, 1 + a);
+        size[a] = luaL_checknumber(L, 3 + a);
+        luaL_argcheck(L, size[a] > 0, 3 + a, "bounds must not be empty");
+    }
+    checkCellSizes(L, 5, 64, cellSizes);
+
+    bump::CellSize<2> cs;
+    cs.set(cellSizes);
+    int lo[2], len[2];
+    bump::grid_toCellBox<2>(cs, pos, size, lo, len);
+    double total = 1;
+    for (int a = 0; a < 2; a++) {
+        total *= len[a];
+    }
+    luaL_argcheck(L, total <= (1 << 24), 1,
+                  "bounds cover too many cells for their cell size");
+
+    World *world = pushWorld(L, cellSizes);
+    world->bound(pos, size);
+    return 1;
+}
+
+/*------------------------------------------
+-- Fixed-point world
+------------------------------------------*/
+
+#define FIXED_METANAME "_bump_fixed_world_2d"
+
+struct BumpFixedWorld2d {
+    FixedWorld *world;
+};
+
+static int checkFixed(lua_State *L, int narg)
+{
+    lua_Integer v = luaL_checkinteger(L, narg);
+    luaL_argcheck(L, v > -FIXED_LIMIT && v < FIXED_LIMIT, narg,
+                  "fixed-point coordinate out of range");
+    return (int)v;
+}
+
+static void checkFixedRect(lua_State *L, int x, int *pos, int *size)
+{
+    pos[0]  = checkFixed(L, x);
+    pos[1]  = checkFixed(L, x + 1);
+    size[0] = checkFixed(L, x + 2);
+    size[1] = checkFixed(L, x + 3);
+    luaL_argcheck(L, size[0] > 0, x + 2, "w must be a positive integer");
+    luaL_argcheck(L, size[1] > 0, x + 3, "h must be a positive integer");
+}
+
+static inline FixedWorld *toFixedWorld(lua_State *L)
+{
+    BumpFixedWorld2d *bump =
+        (BumpFixedWorld2d *)luaL_checkudata(L, 1, FIXED_METANAME);
+    return bump->world;
+}
+
+static void pushFixedRect(lua_State *L, const bump::Box<2, int> &b)
+{
+    lua_createtable(L, 0, 4);
+    lauxh_pushint2tbl(L, "x", b.pos[0]);
+    lauxh_pushint2tbl(L, "y", b.pos[1]);
+    lauxh_pushint2tbl(L, "w", b.size[0]);
+    lauxh_pushint2tbl(L, "h", b.size[1]);
+}
+
+static void pushFixedVector(lua_State *L, const int *v)
+{
+    lua_createtable(L, 0, 2);
+    lauxh_pushint2tbl(L, "x", v[0]);
+    lauxh_pushint2tbl(L, "y", v[1]);
+}
+
+static void pushItemSet(lua_State *L, std::set<int> &items)
+{
+    lua_createtable(L, items.size(), 0);
+    int n = 0;
+    for (std::set<int>::iterator it = items.begin(); it != items.end(); it++) {
+        lua_pushinteger(L, *it);
+        lua_rawseti(L, -2, ++n);
+    }
+}
+
+static int fixedWorldAdd(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int pos[2], size[2];
+    checkFixedRect(L, 2, pos, size);
+
+    int item = world->allocateId();
+    world->add(item, pos, size);
+    lua_pushinteger(L, item);
+    return 1;
+}
+
+static int fixedWorldRemove(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    world->remove(luaL_checkinteger(L, 2));
+    return 0;
+}
+
+static int fixedWorldUpdate(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int item          = luaL_checkinteger(L, 2);
+    int pos[2]        = {checkFixed(L, 3), checkFixed(L, 4)};
+    int size[2]       = {(int)luaL_optinteger(L, 5, 0),
+                         (int)luaL_optinteger(L, 6, 0)};
+    luaL_argcheck(L, world->hasItem(item), 2, "item is not in the world");
+    world->update(item, pos, size);
+    return 0;
+}
+
+static int fixedWorldMoveOrCheck(lua_State *L, bool commit)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int item          = luaL_checkinteger(L, 2);
+    int goal[2]       = {checkFixed(L, 3), checkFixed(L, 4)};
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 5, Slide));
+    luaL_argcheck(L, world->hasItem(item), 2, "item is not in the world");
+    luaL_argcheck(L, filter != NULL, 5, "unknown response type");
+
+    int actual[2];
+    std::vector<FixedCollision> cols;
+    if (commit) {
+        world->move(item, goal, filter, actual, cols);
+    } else {
+        world->check(item, goal, filter, actual, cols);
+    }
+
+    lua_pushinteger(L, actual[0]);
+    lua_pushinteger(L, actual[1]);
+    lua_createtable(L, cols.size(), 0);
+    int n = 0;
+    for (std::vector<FixedCollision>::iterator it = cols.begin();
+         it != cols.end(); it++) {
+        lua_createtable(L, 0, 12);
+        lauxh_pushint2tbl(L, "item", (*it).item);
+        lauxh_pushint2tbl(L, "other", (*it).other);
+        lauxh_pushint2tbl(L, "type", (*it).type);
+        lua_pushboolean(L, (*it).overlaps);
+        lua_setfield(L, -2, "overlaps");
+        //-- the exact time of impact, as an unreduced fraction
+        lua_createtable(L, 0, 2);
+        lauxh_pushint2tbl(L, "num", (*it).ti.num);
+        lauxh_pushint2tbl(L, "den", (*it).ti.den);
+        lua_setfield(L, -2, "ti");
+
+        pushFixedVector(L, (*it).move);
+        lua_setfield(L, -2, "move");
+        pushFixedVector(L, (*it).normal);
+        lua_setfield(L, -2, "normal");
+        pushFixedVector(L, (*it).touch);
+        lua_setfield(L, -2, "touch");
+        if (((*it).type == Bounce) || ((*it).type == Slide)) {
+            pushFixedVector(L, (*it).response);
+            lua_setfield(L, -2, (*it).type == Slide ? "slide" : "bounce");
+        }
+        pushFixedRect(L, (*it).itemBox);
+        lua_setfield(L, -2, "itemRect");
+        pushFixedRect(L, (*it).otherBox);
+        lua_setfield(L, -2, "otherRect");
+
+        lua_rawseti(L, -2, ++n);
+    }
+    lua_pushinteger(L, n);
+    return 4;
+}
+
+static int fixedWorldMove(lua_State *L)
+{
+    return fixedWorldMoveOrCheck(L, true);
+}
+
+static int fixedWorldCheck(lua_State *L)
+{
+    return fixedWorldMoveOrCheck(L, false);
+}
+
+static int fixedWorldGetRect(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int item          = luaL_checkinteger(L, 2);
+    luaL_argcheck(L, world->hasItem(item), 2, "item is not in the world");
+    int pos[2], size[2];
+    world->getBox(item, pos, size);
+    lua_pushinteger(L, pos[0]);
+    lua_pushinteger(L, pos[1]);
+    lua_pushinteger(L, size[0]);
+    lua_pushinteger(L, size[1]);
+    return 4;
+}
+
+static int fixedWorldHasItem(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    lua_pushboolean(L, world->hasItem(luaL_checkinteger(L, 2)));
+    return 1;
+}
+
+static int fixedWorldCountItems(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    lua_pushinteger(L, world->countItems());
+    return 1;
+}
+
+static int fixedWorldCountCells(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    lua_pushinteger(L, world->countCells());
+    return 1;
+}
+
+static int fixedWorldQueryRect(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int pos[2], size[2];
+    checkFixedRect(L, 2, pos, size);
+    std::set<int> items;
+    world->queryBox(pos, size, NULL, items);
+    pushItemSet(L, items);
+    return 1;
+}
+
+static int fixedWorldQueryPoint(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int p[2]          = {checkFixed(L, 2), checkFixed(L, 3)};
+    std::set<int> items;
+    world->queryPoint(p, NULL, items);
+    pushItemSet(L, items);
+    return 1;
+}
+
+static int fixedWorldToCell(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    int p[2]          = {checkFixed(L, 2), checkFixed(L, 3)};
+    int c[2];
+    world->toCell(p, c);
+    lua_pushinteger(L, c[0]);
+    lua_pushinteger(L, c[1]);
+    return 2;
+}
+
+static int fixedWorldCellSize(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    lua_pushinteger(L, world->cellSize);
+    return 1;
+}
+
+static int fixedWorldClear(lua_State *L)
+{
+    FixedWorld *world = toFixedWorld(L);
+    world->clear();
+    return 0;
+}
+
+static int bumpFixedWorldRelease(lua_State *L)
+{
+    BumpFixedWorld2d *bump = (BumpFixedWorld2d *)lua_touserdata(L, 1);
+    if (NULL == bump || NULL == bump->world) {
+        return 0;
+    }
+
+    bump->world->release();
+    delete bump->world;
+    bump->world = NULL;
+    return 0;
+}
+
+// bump2d.newFixedWorld([cellSize]) -> a world on integer coordinates whose
+// move() results are bit-identical on every platform and build
+static int bumpNewFixedWorld(lua_State *L)
+{
+    lua_Integer cellSize = luaL_optinteger(L, 1, 64);
+    luaL_argcheck(L, cellSize > 0 && cellSize < FIXED_LIMIT, 1,
+                  "cellSize must be a positive integer");
+
+    BumpFixedWorld2d *bump = (BumpFixedWorld2d *)lua_newuserdatauv(
+        L, sizeof(BumpFixedWorld2d), 0);
+    FixedWorld *world = new FixedWorld();
+    world->initialize(cellSize);
+    bump->world = world;
+
+    if (luaL_newmetatable(L, FIXED_METANAME)) // mt
+    {
+        luaL_Reg l[] = {
+            {"add",        fixedWorldAdd       },
+            {"remove",     fixedWorldRemove    },
+            {"update",     fixedWorldUpdate    },
+            {"move",       fixedWorldMove      },
+            {"check",      fixedWorldCheck     },
+            {"getRect",    fixedWorldGetRect   },
+            {"hasItem",    fixedWorldHasItem   },
+            {"countItems", fixedWorldCountItems},
+            {"countCells", fixedWorldCountCells},
+            {"queryRect",  fixedWorldQueryRect },
+            {"queryPoint", fixedWorldQueryPoint},
+            {"toCell",     fixedWorldToCell    },
+            {"cellSize",   fixedWorldCellSize  },
+            {"clear",      fixedWorldClear     },
+            {NULL,         NULL                }
+        };
+        luaL_newlib(L, l);              //{}
+        lua_setfield(L, -2, "__index"); // mt[__index] = {}
+        lua_pushcfunction(L, bumpFixedWorldRelease);
+        lua_setfield(L, -2, "__gc"); // mt[__gc] = bumpFixedWorldRelease
+    }
+    lua_setmetatable(L, -2); // set userdata metatable
+    return 1;
+}
+
+static int rectGetNearestCorner(lua_State *L)
+{
+    double x1 = luaL_checknumber(L, 1);
+    double y1 = luaL_checknumber(L, 2);
+    double w1 = luaL_checknumber(L, 3);
+    double h1 = luaL_checknumber(L, 4);
+    double px = luaL_checknumber(L, 5);
+    double py = luaL_checknumber(L, 6);
+    double nx, ny;
+    rect_getNearestCorner(x1, y1, w1, h1, px, py, nx, ny);
+    lua_pushnumber(L, nx);
+    lua_pushnumber(L, ny);
+    return 2;
+}
+
+static int rectGetSegmentIntersectionIndices(lua_State *L)
+{
+    double x1  = luaL_checknumber(L, 1);
     double y1  = luaL_checknumber(L, 2);
     double w1  = luaL_checknumber(L, 3);
     double h1  = luaL_checknumber(L, 4);
@@ -641,42 +1881,42 @@ static int rectDetectCollision(lua_State *L)
         lua_setfield(L, -2, "ti");
 
         lua_newtable(L);
-        lua_pushnumber(L, col.move.x);
+        lua_pushnumber(L, col.move[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, col.move.y);
+        lua_pushnumber(L, col.move[1]);
         lua_setfield(L, -2, "y");
         lua_setfield(L, -2, "move");
         lua_newtable(L);
-        lua_pushnumber(L, col.normal.x);
+        lua_pushnumber(L, col.normal[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, col.normal.y);
+        lua_pushnumber(L, col.normal[1]);
         lua_setfield(L, -2, "y");
         lua_setfield(L, -2, "normal");
         lua_newtable(L);
-        lua_pushnumber(L, col.touch.x);
+        lua_pushnumber(L, col.touch[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, col.touch.y);
+        lua_pushnumber(L, col.touch[1]);
         lua_setfield(L, -2, "y");
         lua_setfield(L, -2, "touch");
 
         lua_newtable(L);
-        lua_pushnumber(L, col.itemRect.x);
+        lua_pushnumber(L, col.itemBox.pos[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, col.itemRect.y);
+        lua_pushnumber(L, col.itemBox.pos[1]);
         lua_setfield(L, -2, "y");
-        lua_pushnumber(L, col.itemRect.w);
+        lua_pushnumber(L, col.itemBox.size[0]);
         lua_setfield(L, -2, "w");
-        lua_pushnumber(L, col.itemRect.h);
+        lua_pushnumber(L, col.itemBox.size[1]);
         lua_setfield(L, -2, "h");
         lua_setfield(L, -2, "itemRect");
         lua_newtable(L);
-        lua_pushnumber(L, col.otherRect.x);
+        lua_pushnumber(L, col.otherBox.pos[0]);
         lua_setfield(L, -2, "x");
-        lua_pushnumber(L, col.otherRect.y);
+        lua_pushnumber(L, col.otherBox.pos[1]);
         lua_setfield(L, -2, "y");
-        lua_pushnumber(L, col.otherRect.w);
+        lua_pushnumber(L, col.otherBox.size[0]);
         lua_setfield(L, -2, "w");
-        lua_pushnumber(L, col.otherRect.h);
+        lua_pushnumber(L, col.otherBox.size[1]);
         lua_setfield(L, -2, "h");
         lua_setfield(L, -2, "otherRect");
         return 1;
@@ -688,8 +1928,11 @@ extern "C" {
 int LUAMOD_API luaopen_bump2d(lua_State *L)
 {
     const luaL_Reg bumpFuncs[] = {
-        {"newWorld", bumpNewWorld},
-        {NULL,       NULL        },
+        {"newWorld",        bumpNewWorld       },
+        {"newBoundedWorld", bumpNewBoundedWorld},
+        {"newFixedWorld",   bumpNewFixedWorld  },
+        {"load",            bumpLoad           },
+        {NULL,              NULL               },
     };
 
     luaL_newlib(L, bumpFuncs);
@@ -714,6 +1957,14 @@ int LUAMOD_API luaopen_bump2d(lua_State *L)
     lauxh_pushint2tbl(L, "slide", Slide);
     lauxh_pushint2tbl(L, "bounce", Bounce);
 
+    //-- true when item boxes are stored as float (built with BUMP_FLOAT32)
+#ifdef BUMP_FLOAT32
+    lua_pushboolean(L, 1);
+#else
+    lua_pushboolean(L, 0);
+#endif
+    lua_setfield(L, -2, "float32");
+
     return 1;
 }
 }
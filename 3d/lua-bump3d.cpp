@@ -1,13 +1,1272 @@
 #include "bump3d.hpp"
+#include "../common/bump_snapshot.hpp"
 #include <lua.hpp>
 
 using namespace bump3d;
 
 #define METANAME "_bump_world_3d"
 
+struct BumpWorld3d {
+    World *world;
+};
+
+static inline void lauxh_pushint2tblat(lua_State *L, const char *k,
+                                       lua_Integer v, int at)
+{
+    if (at < 0) {
+        at -= 2;
+    }
+    lua_pushstring(L, k);
+    lua_pushinteger(L, v);
+    lua_rawset(L, at);
+}
+#define lauxh_pushint2tbl(L, k, v) lauxh_pushint2tblat(L, k, v, -1)
+
+static inline void lauxh_pushnum2tbl(lua_State *L, const char *k, lua_Number v)
+{
+    lua_pushnumber(L, v);
+    lua_setfield(L, -2, k);
+}
+
+static void assertNumber(lua_State *L, int narg, const char *name)
+{
+    if (!lua_isnumber(L, narg)) {
+        luaL_error(L, "%s must be a number, but was %s (a %s)", name,
+                   luaL_tolstring(L, narg, NULL), luaL_typename(L, narg));
+    }
+}
+
+static void assertIsPositiveNumber(lua_State *L, int narg, const char *name)
+{
+    if (!lua_isnumber(L, narg) || !(lua_tonumber(L, narg) > 0)) {
+        luaL_error(L, "%s must be a positive number, but was %s (a %s)", name,
+                   luaL_tolstring(L, narg, NULL), luaL_typename(L, narg));
+    }
+}
+
+static void assertIsCube(lua_State *L, int x, int y, int z, int w, int h,
+                         int d)
+{
+    assertNumber(L, x, "x");
+    assertNumber(L, y, "y");
+    assertNumber(L, z, "z");
+    assertIsPositiveNumber(L, w, "w");
+    assertIsPositiveNumber(L, h, "h");
+    assertIsPositiveNumber(L, d, "d");
+}
+
+static World *checkWorld(lua_State *L)
+{
+    BumpWorld3d *bump = (BumpWorld3d *)lua_touserdata(L, 1);
+    if (NULL == bump || NULL == bump->world) {
+        luaL_argerror(L, 1, "invalid lua-bump world");
+    }
+    return bump->world;
+}
+
+static int checkItem(lua_State *L, World *world, int narg)
+{
+    int item = (int)luaL_checkinteger(L, narg);
+    if (!world->hasItem(item)) {
+        luaL_error(L, "Item %d must be added to the world before being used",
+                   item);
+    }
+    return item;
+}
+
+/*------------------------------------------
+-- Result tables
+--
+-- Every query and move accepts an optional trailing table. When given it is
+-- filled in place (nested collision tables included) and entries past the
+-- new length are cleared, so a caller can keep one table per call site and
+-- the steady state allocates nothing.
+------------------------------------------*/
+
+static void pushResultTable(lua_State *L, int narg, int narr)
+{
+    if (lua_istable(L, narg)) {
+        lua_pushvalue(L, narg);
+    } else {
+        lua_createtable(L, narr, 0);
+    }
+}
+
+// -- clears t[n + 1], t[n + 2], ... of the result table at the top
+static void trimResultTable(lua_State *L, int n)
+{
+    for (int i = n + 1; lua_rawgeti(L, -1, i) != LUA_TNIL; i++) {
+        lua_pop(L, 1);
+        lua_pushnil(L);
+        lua_rawseti(L, -2, i);
+    }
+    lua_pop(L, 1);
+}
+
+// -- pushes t[i] of the table at the top when it is a table, or a new table
+// stored at t[i]
+static void reuseTableAt(lua_State *L, int i, int nrec)
+{
+    if (lua_rawgeti(L, -1, i) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, nrec);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, -3, i);
+    }
+}
+
+// -- same as reuseTableAt, for the field k
+static void reuseTableField(lua_State *L, const char *k, int nrec)
+{
+    if (lua_getfield(L, -1, k) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_createtable(L, 0, nrec);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -3, k);
+    }
+}
+
+static void setPointField(lua_State *L, const char *k, const double *p)
+{
+    reuseTableField(L, k, 3);
+    lauxh_pushnum2tbl(L, "x", p[0]);
+    lauxh_pushnum2tbl(L, "y", p[1]);
+    lauxh_pushnum2tbl(L, "z", p[2]);
+    lua_pop(L, 1);
+}
+
+static void setCubeField(lua_State *L, const char *k, const bump::Box<3> &c)
+{
+    reuseTableField(L, k, 6);
+    lauxh_pushnum2tbl(L, "x", c.pos[0]);
+    lauxh_pushnum2tbl(L, "y", c.pos[1]);
+    lauxh_pushnum2tbl(L, "z", c.pos[2]);
+    lauxh_pushnum2tbl(L, "w", c.size[0]);
+    lauxh_pushnum2tbl(L, "h", c.size[1]);
+    lauxh_pushnum2tbl(L, "d", c.size[2]);
+    lua_pop(L, 1);
+}
+
+// -- fills the collision table at the top of the stack
+static void setCollisionFields(lua_State *L, const Collision &col)
+{
+    lua_pushinteger(L, col.item);
+    lua_setfield(L, -2, "item");
+    lua_pushinteger(L, col.other);
+    lua_setfield(L, -2, "other");
+    lua_pushinteger(L, col.type);
+    lua_setfield(L, -2, "type");
+    lua_pushboolean(L, col.overlaps);
+    lua_setfield(L, -2, "overlaps");
+    lauxh_pushnum2tbl(L, "ti", col.ti);
+
+    setPointField(L, "move", col.move);
+    setPointField(L, "normal", col.normal);
+    setPointField(L, "touch", col.touch);
+
+    if (col.type == Slide) {
+        setPointField(L, "slide", col.response);
+        lua_pushnil(L);
+        lua_setfield(L, -2, "bounce");
+    } else if (col.type == Bounce) {
+        setPointField(L, "bounce", col.response);
+        lua_pushnil(L);
+        lua_setfield(L, -2, "slide");
+    } else {
+        lua_pushnil(L);
+        lua_setfield(L, -2, "slide");
+        lua_pushnil(L);
+        lua_setfield(L, -2, "bounce");
+    }
+
+    setCubeField(L, "itemCube", col.itemBox);
+    setCubeField(L, "otherCube", col.otherBox);
+}
+
+// -- leaves the collisions on the stack as a result table (the one at narg
+// when given) and returns its length
+static int pushCollisions(lua_State *L, int narg,
+                          const std::vector<Collision> &cols)
+{
+    pushResultTable(L, narg, cols.size());
+    int n = 0;
+    for (std::vector<Collision>::const_iterator it = cols.begin();
+         it != cols.end(); it++) {
+        reuseTableAt(L, ++n, 14);
+        setCollisionFields(L, *it);
+        lua_pop(L, 1);
+    }
+    trimResultTable(L, n);
+    return n;
+}
+
+template <typename Items>
+static int pushItems(lua_State *L, int narg, const Items &items)
+{
+    pushResultTable(L, narg, items.size());
+    int n = 0;
+    for (typename Items::const_iterator it = items.begin(); it != items.end();
+         it++) {
+        lua_pushinteger(L, *it);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    return n;
+}
+
+/*------------------------------------------
+-- World methods
+------------------------------------------*/
+
+static int worldProject(lua_State *L)
+{
+    World *world = checkWorld(L);
+
+    int item          = (int)luaL_optinteger(L, 2, 0);
+    double x          = luaL_checknumber(L, 3);
+    double y          = luaL_checknumber(L, 4);
+    double z          = luaL_checknumber(L, 5);
+    double w          = luaL_checknumber(L, 6);
+    double h          = luaL_checknumber(L, 7);
+    double d          = luaL_checknumber(L, 8);
+    double gx         = luaL_checknumber(L, 9);
+    double gy         = luaL_checknumber(L, 10);
+    double gz         = luaL_checknumber(L, 11);
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 12, Slide));
+    luaL_argcheck(L, filter, 12, "unknown response type");
+
+    std::vector<Collision> cols;
+    world->project(item, x, y, z, w, h, d, gx, gy, gz, filter, cols);
+    lua_pushinteger(L, pushCollisions(L, 13, cols));
+    return 2;
+}
+
+static int worldCountCells(lua_State *L)
+{
+    World *world = checkWorld(L);
+    lua_pushinteger(L, world->countCells());
+    return 1;
+}
+
+static int worldCountItems(lua_State *L)
+{
+    World *world = checkWorld(L);
+    lua_pushinteger(L, world->countItems());
+    return 1;
+}
+
+static int worldHasItem(lua_State *L)
+{
+    World *world = checkWorld(L);
+    lua_pushboolean(L, world->hasItem((int)luaL_checkinteger(L, 2)));
+    return 1;
+}
+
+static int worldGetCube(lua_State *L)
+{
+    World *world = checkWorld(L);
+    int item     = checkItem(L, world, 2);
+    double x, y, z, w, h, d;
+    world->getCube(item, x, y, z, w, h, d);
+    lua_pushnumber(L, x);
+    lua_pushnumber(L, y);
+    lua_pushnumber(L, z);
+    lua_pushnumber(L, w);
+    lua_pushnumber(L, h);
+    lua_pushnumber(L, d);
+    return 6;
+}
+
+static int worldToWorld(lua_State *L)
+{
+    World *world = checkWorld(L);
+    int cx       = (int)luaL_checkinteger(L, 2);
+    int cy       = (int)luaL_checkinteger(L, 3);
+    int cz       = (int)luaL_checkinteger(L, 4);
+    double x, y, z;
+    world->toWorld(cx, cy, cz, x, y, z);
+    lua_pushnumber(L, x);
+    lua_pushnumber(L, y);
+    lua_pushnumber(L, z);
+    return 3;
+}
+
+static int worldToCell(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double x     = luaL_checknumber(L, 2);
+    double y     = luaL_checknumber(L, 3);
+    double z     = luaL_checknumber(L, 4);
+    int cx, cy, cz;
+    world->toCell(x, y, z, cx, cy, cz);
+    lua_pushinteger(L, cx);
+    lua_pushinteger(L, cy);
+    lua_pushinteger(L, cz);
+    return 3;
+}
+
+static int worldQueryCube(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double x     = luaL_checknumber(L, 2);
+    double y     = luaL_checknumber(L, 3);
+    double z     = luaL_checknumber(L, 4);
+    double w     = luaL_checknumber(L, 5);
+    double h     = luaL_checknumber(L, 6);
+    double d     = luaL_checknumber(L, 7);
+
+    std::set<int> items;
+    world->queryCube(x, y, z, w, h, d, NULL, items);
+    lua_pushinteger(L, pushItems(L, 8, items));
+    return 2;
+}
+
+static int worldQueryPoint(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double x     = luaL_checknumber(L, 2);
+    double y     = luaL_checknumber(L, 3);
+    double z     = luaL_checknumber(L, 4);
+
+    std::set<int> items;
+    world->queryPoint(x, y, z, NULL, items);
+    lua_pushinteger(L, pushItems(L, 5, items));
+    return 2;
+}
+
+static void querySegmentInfo(World *world, double x1, double y1, double z1,
+                             double x2, double y2, double z2,
+                             std::vector<int> &items)
+{
+    std::vector<ItemInfo> itemInfo;
+    world->getInfoAboutItemsTouchedBySegment(x1, y1, z1, x2, y2, z2, NULL,
+                                             itemInfo);
+    for (std::vector<ItemInfo>::iterator it = itemInfo.begin();
+         it != itemInfo.end(); it++) {
+        items.push_back((*it).item);
+    }
+}
+
+// -- world:querySegment keeps the touch order (World::querySegment returns a
+// std::set, which would sort the ids instead)
+static int worldQuerySegment(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double x1    = luaL_checknumber(L, 2);
+    double y1    = luaL_checknumber(L, 3);
+    double z1    = luaL_checknumber(L, 4);
+    double x2    = luaL_checknumber(L, 5);
+    double y2    = luaL_checknumber(L, 6);
+    double z2    = luaL_checknumber(L, 7);
+
+    std::vector<int> items;
+    querySegmentInfo(world, x1, y1, z1, x2, y2, z2, items);
+    lua_pushinteger(L, pushItems(L, 8, items));
+    return 2;
+}
+
+static int worldQuerySegmentWithCoords(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double x1    = luaL_checknumber(L, 2);
+    double y1    = luaL_checknumber(L, 3);
+    double z1    = luaL_checknumber(L, 4);
+    double x2    = luaL_checknumber(L, 5);
+    double y2    = luaL_checknumber(L, 6);
+    double z2    = luaL_checknumber(L, 7);
+
+    std::vector<ItemInfo> items;
+    world->querySegmentWithCoords(x1, y1, z1, x2, y2, z2, NULL, items);
+    pushResultTable(L, 8, items.size());
+    int n = 0;
+    for (std::vector<ItemInfo>::iterator it = items.begin(); it != items.end();
+         it++) {
+        reuseTableAt(L, ++n, 9);
+        lua_pushinteger(L, (*it).item);
+        lua_setfield(L, -2, "item");
+        lauxh_pushnum2tbl(L, "ti1", (*it).ti1);
+        lauxh_pushnum2tbl(L, "ti2", (*it).ti2);
+        lauxh_pushnum2tbl(L, "x1", (*it).p1[0]);
+        lauxh_pushnum2tbl(L, "y1", (*it).p1[1]);
+        lauxh_pushnum2tbl(L, "z1", (*it).p1[2]);
+        lauxh_pushnum2tbl(L, "x2", (*it).p2[0]);
+        lauxh_pushnum2tbl(L, "y2", (*it).p2[1]);
+        lauxh_pushnum2tbl(L, "z2", (*it).p2[2]);
+        lua_pop(L, 1);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, n);
+    return 2;
+}
+
+static int worldAdd(lua_State *L)
+{
+    World *world = checkWorld(L);
+    assertIsCube(L, 2, 3, 4, 5, 6, 7);
+
+    double x = lua_tonumber(L, 2);
+    double y = lua_tonumber(L, 3);
+    double z = lua_tonumber(L, 4);
+    double w = lua_tonumber(L, 5);
+    double h = lua_tonumber(L, 6);
+    double d = lua_tonumber(L, 7);
+
+    int item = world->allocateId();
+    world->add(item, x, y, z, w, h, d);
+
+    lua_pushinteger(L, item);
+    return 1;
+}
+
+static int worldRemove(lua_State *L)
+{
+    World *world = checkWorld(L);
+    world->remove(checkItem(L, world, 2));
+    return 0;
+}
+
+static int worldClear(lua_State *L)
+{
+    World *world = checkWorld(L);
+    world->clear();
+    return 0;
+}
+
+// -- world:update(item, x, y, z [, w, h, d]): w, h and d keep their current
+// value when omitted
+static int worldUpdate(lua_State *L)
+{
+    World *world = checkWorld(L);
+    int item     = checkItem(L, world, 2);
+    assertNumber(L, 3, "x");
+    assertNumber(L, 4, "y");
+    assertNumber(L, 5, "z");
+    double w = -1, h = -1, d = -1;
+    if (!lua_isnoneornil(L, 6)) {
+        assertIsPositiveNumber(L, 6, "w");
+        assertIsPositiveNumber(L, 7, "h");
+        assertIsPositiveNumber(L, 8, "d");
+        w = lua_tonumber(L, 6);
+        h = lua_tonumber(L, 7);
+        d = lua_tonumber(L, 8);
+    }
+    world->update(item, lua_tonumber(L, 3), lua_tonumber(L, 4),
+                  lua_tonumber(L, 5), w, h, d);
+    return 0;
+}
+
+static int moveOrCheck(lua_State *L, bool commit)
+{
+    World *world      = checkWorld(L);
+    int item          = checkItem(L, world, 2);
+    double x          = luaL_checknumber(L, 3);
+    double y          = luaL_checknumber(L, 4);
+    double z          = luaL_checknumber(L, 5);
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 6, Slide));
+    luaL_argcheck(L, filter, 6, "unknown response type");
+
+    double ax, ay, az;
+    std::vector<Collision> cols;
+    if (commit) {
+        world->move(item, x, y, z, filter, ax, ay, az, cols);
+    } else {
+        world->check(item, x, y, z, filter, ax, ay, az, cols);
+    }
+    lua_pushnumber(L, ax);
+    lua_pushnumber(L, ay);
+    lua_pushnumber(L, az);
+    lua_pushinteger(L, pushCollisions(L, 7, cols));
+    return 5;
+}
+
+static int worldMove(lua_State *L)
+{
+    return moveOrCheck(L, true);
+}
+
+static int worldCheck(lua_State *L)
+{
+    return moveOrCheck(L, false);
+}
+
+/*------------------------------------------
+-- Kinematic bodies
+------------------------------------------*/
+
+// -- world:setBody(item, vx, vy, vz [, gx, gy, gz [, response]]): item becomes
+// -- a body that world:step() moves with that velocity and gravity
+static int worldSetBody(lua_State *L)
+{
+    World *world = checkWorld(L);
+    int item     = checkItem(L, world, 2);
+    double velocity[3], gravity[3];
+    for (int a = 0; a < 3; a++) {
+        velocity[a] = luaL_checknumber(L, 3 + a);
+        gravity[a]  = luaL_optnumber(L, 6 + a, 0);
+    }
+    int response = luaL_optinteger(L, 9, Slide);
+    luaL_argcheck(L, world->getFilterById(response), 9,
+                  "unknown response type");
+    world->setBody(item, velocity, gravity, response);
+    return 0;
+}
+
+// -- world:getBody(item) -> vx, vy, vz, gx, gy, gz, response, or nil
+static int worldGetBody(lua_State *L)
+{
+    World *world        = checkWorld(L);
+    bump::Body<3> *body = world->getBody((int)luaL_checkinteger(L, 2));
+    if (body == NULL) {
+        lua_pushnil(L);
+        return 1;
+    }
+    for (int a = 0; a < 3; a++) {
+        lua_pushnumber(L, body->velocity[a]);
+    }
+    for (int a = 0; a < 3; a++) {
+        lua_pushnumber(L, body->gravity[a]);
+    }
+    lua_pushinteger(L, body->response);
+    return 7;
+}
+
+static int worldRemoveBody(lua_State *L)
+{
+    World *world = checkWorld(L);
+    world->removeBody((int)luaL_checkinteger(L, 2));
+    return 0;
+}
+
+// -- world:step(dt [, out]) moves every body; returns the ones that collided
+// -- and their count
+static int worldStep(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double dt    = luaL_checknumber(L, 2);
+    std::vector<int> hit;
+    world->step(dt, hit);
+
+    pushResultTable(L, 3, hit.size());
+    int n = 0;
+    for (std::vector<int>::iterator it = hit.begin(); it != hit.end(); it++) {
+        lua_pushinteger(L, *it);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, n);
+    return 2;
+}
+
+/*------------------------------------------
+-- Batch methods
+--
+-- Inputs and outputs are flat arrays, so a whole frame of moves or queries
+-- costs one call into C and no per-entry tables.
+------------------------------------------*/
+
+// -- world:moveMany({id1, gx1, gy1, gz1, id2, ...} [, filter [, out]])
+// -- out = {ax1, ay1, az1, ncols1, ax2, ...}; returns out, number of moves
+static int worldMoveMany(lua_State *L)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 3, Slide));
+    luaL_argcheck(L, filter, 3, "unknown response type");
+
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 4 == 0, 2, "expected {item, x, y, z, ...}");
+
+    pushResultTable(L, 4, len);
+    std::vector<Collision> cols;
+    int n = 0;
+    for (int i = 1; i <= len; i += 4) {
+        lua_rawgeti(L, 2, i);
+        lua_rawgeti(L, 2, i + 1);
+        lua_rawgeti(L, 2, i + 2);
+        lua_rawgeti(L, 2, i + 3);
+        int item = (int)lua_tointeger(L, -4);
+        double x = lua_tonumber(L, -3);
+        double y = lua_tonumber(L, -2);
+        double z = lua_tonumber(L, -1);
+        lua_pop(L, 4);
+        if (!world->hasItem(item)) {
+            return luaL_error(L, "Item %d must be added to the world before "
+                                 "being used",
+                              item);
+        }
+
+        double ax, ay, az;
+        cols.clear();
+        world->move(item, x, y, z, filter, ax, ay, az, cols);
+        lua_pushnumber(L, ax);
+        lua_rawseti(L, -2, ++n);
+        lua_pushnumber(L, ay);
+        lua_rawseti(L, -2, ++n);
+        lua_pushnumber(L, az);
+        lua_rawseti(L, -2, ++n);
+        lua_pushinteger(L, cols.size());
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, len / 4);
+    return 2;
+}
+
+// -- world:moveSwept({id1, gx1, gy1, gz1, ...} [, filter [, out [, cols]]])
+// -- like moveMany, but the items move together and two movers meet at the
+// -- time of impact of their relative motion; cols receives the collisions
+// -- of every mover in order. Returns out, number of moves, cols, its length
+static int worldMoveSwept(lua_State *L)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    ColFilter *filter = world->getFilterById(luaL_optinteger(L, 3, Slide));
+    luaL_argcheck(L, filter, 3, "unknown response type");
+
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 4 == 0, 2, "expected {item, x, y, z, ...}");
+    int count = len / 4;
+    std::vector<int> items(count);
+    std::vector<double> goals(3 * count);
+    std::set<int> seen;
+    for (int i = 0; i < count; i++) {
+        for (int k = 0; k < 4; k++) {
+            lua_rawgeti(L, 2, 4 * i + k + 1);
+        }
+        items[i] = (int)lua_tointeger(L, -4);
+        for (int a = 0; a < 3; a++) {
+            goals[3 * i + a] = lua_tonumber(L, a - 3);
+        }
+        lua_pop(L, 4);
+        if (!world->hasItem(items[i])) {
+            return luaL_error(L, "Item %d must be added to the world before "
+                                 "being used",
+                              items[i]);
+        }
+        luaL_argcheck(L, seen.insert(items[i]).second, 2,
+                      "an item moves more than once");
+    }
+
+    std::vector<double> actual(3 * count);
+    std::vector<int> ncols(count);
+    std::vector<Collision> cols;
+    if (count > 0) {
+        world->moveSwept(items.data(), goals.data(), count, filter,
+                         actual.data(), ncols.data(), cols);
+    }
+
+    pushResultTable(L, 4, len);
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        for (int a = 0; a < 3; a++) {
+            lua_pushnumber(L, actual[3 * i + a]);
+            lua_rawseti(L, -2, ++n);
+        }
+        lua_pushinteger(L, ncols[i]);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, count);
+    lua_pushinteger(L, pushCollisions(L, 5, cols));
+    return 4;
+}
+
+// -- shared driver for the query*Many methods: reads `stride` numbers per
+// query from the table at 2 and appends {count, id...} per query to the
+// result table
+template <int stride, typename Query>
+static int queryMany(lua_State *L, const char *shape, Query query)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % stride == 0, 2, shape);
+
+    pushResultTable(L, 3, len);
+    double a[stride];
+    std::vector<int> items;
+    int n = 0;
+    for (int i = 1; i <= len; i += stride) {
+        for (int k = 0; k < stride; k++) {
+            lua_rawgeti(L, 2, i + k);
+            a[k] = lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+        items.clear();
+        query(world, a, items);
+        lua_pushinteger(L, items.size());
+        lua_rawseti(L, -2, ++n);
+        for (std::vector<int>::iterator it = items.begin(); it != items.end();
+             it++) {
+            lua_pushinteger(L, *it);
+            lua_rawseti(L, -2, ++n);
+        }
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, n);
+    return 2;
+}
+
+static void queryCubeOne(World *world, const double *a, std::vector<int> &out)
+{
+    std::set<int> items;
+    world->queryCube(a[0], a[1], a[2], a[3], a[4], a[5], NULL, items);
+    out.assign(items.begin(), items.end());
+}
+
+static void querySegmentOne(World *world, const double *a,
+                            std::vector<int> &out)
+{
+    querySegmentInfo(world, a[0], a[1], a[2], a[3], a[4], a[5], out);
+}
+
+// -- world:queryCubeMany({x, y, z, w, h, d, ...} [, out])
+// -- out = {n1, id..., n2, id...}; returns out, #out
+static int worldQueryCubeMany(lua_State *L)
+{
+    return queryMany<6>(L, "expected {x, y, z, w, h, d, ...}", queryCubeOne);
+}
+
+// -- shared driver for queryPointMany and firstHitMany: the points are
+// -- answered in one batch, grouped by cell
+static int pointMany(lua_State *L, bool first)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 3 == 0, 2, "expected {x, y, z, ...}");
+    std::vector<double> points(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        points[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+    int count = len / 3;
+    std::vector<int> start, items;
+    world->queryPointMany(points.data(), count, NULL, first, start, items);
+
+    pushResultTable(L, 3, first ? count : count + items.size());
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (first) {
+            lua_pushinteger(L, start[i] < start[i + 1] ? items[start[i]] : 0);
+            lua_rawseti(L, -2, ++n);
+            continue;
+        }
+        lua_pushinteger(L, start[i + 1] - start[i]);
+        lua_rawseti(L, -2, ++n);
+        for (int k = start[i]; k < start[i + 1]; k++) {
+            lua_pushinteger(L, items[k]);
+            lua_rawseti(L, -2, ++n);
+        }
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, n);
+    return 2;
+}
+
+// -- world:queryPointMany({x, y, z, ...} [, out])
+static int worldQueryPointMany(lua_State *L)
+{
+    return pointMany(L, false);
+}
+
+// -- world:firstHitMany({x, y, z, ...} [, out]) -> out = {id1, id2, ...}, the
+// -- lowest id of an item holding each point, 0 for none
+static int worldFirstHitMany(lua_State *L)
+{
+    return pointMany(L, true);
+}
+
+// -- world:querySegmentMany({x1, y1, z1, x2, y2, z2, ...} [, out])
+static int worldQuerySegmentMany(lua_State *L)
+{
+    return queryMany<6>(L, "expected {x1, y1, z1, x2, y2, z2, ...}",
+                        querySegmentOne);
+}
+
+// -- world:lineOfSightMany({x1, y1, z1, x2, y2, z2, ...} [, transparent
+// -- [, out]]) -> out, number of segments: bit (i - 1) % 32 of
+// -- out[(i - 1) // 32 + 1] is set when no item but the transparent ones
+// -- crosses segment i; each walk stops at its first hit
+static int worldLineOfSightMany(lua_State *L)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 6 == 0, 2, "expected {x1, y1, z1, x2, y2, z2, ...}");
+
+    bump::ExcludeFilter transparent;
+    if (!lua_isnoneornil(L, 3)) {
+        luaL_checktype(L, 3, LUA_TTABLE);
+        int n = (int)lua_rawlen(L, 3);
+        for (int i = 1; i <= n; i++) {
+            lua_rawgeti(L, 3, i);
+            transparent.excluded.insert((int)lua_tointeger(L, -1));
+            lua_pop(L, 1);
+        }
+    }
+
+    std::vector<double> segments(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        segments[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+    }
+    std::vector<unsigned> clear;
+    world->lineOfSightMany(segments.data(), len / 6, &transparent, clear);
+
+    pushResultTable(L, 4, clear.size());
+    int n = 0;
+    for (std::vector<unsigned>::iterator it = clear.begin(); it != clear.end();
+         it++) {
+        lua_pushinteger(L, *it);
+        lua_rawseti(L, -2, ++n);
+    }
+    trimResultTable(L, n);
+    lua_pushinteger(L, len / 6);
+    return 2;
+}
+
+// -- world:addMany({x, y, z, w, h, d, ...} [, out])
+// -- out = {id1, id2, ...}; returns out, number of cubes added
+static int worldAddMany(lua_State *L)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    luaL_argcheck(L, len % 6 == 0, 2, "expected {x, y, z, w, h, d, ...}");
+
+    static const char *names[] = {"x", "y", "z", "w", "h", "d"};
+    int count = len / 6;
+    std::vector<double> packed(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        int isnum;
+        packed[i] = lua_tonumberx(L, -1, &isnum);
+        lua_pop(L, 1);
+        if (!isnum || (i % 6 >= 3 && packed[i] <= 0)) {
+            return luaL_error(L, "cube %d: %s must be a %snumber", i / 6 + 1,
+                              names[i % 6], i % 6 >= 3 ? "positive " : "");
+        }
+    }
+
+    std::vector<int> ids(count);
+    world->addMany(packed.data(), count, ids.data());
+
+    pushResultTable(L, 3, count);
+    for (int i = 0; i < count; i++) {
+        lua_pushinteger(L, ids[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    trimResultTable(L, count);
+    lua_pushinteger(L, count);
+    return 2;
+}
+
+// -- world:removeMany({id1, id2, ...}); ids not in the world are skipped
+static int worldRemoveMany(lua_State *L)
+{
+    World *world = checkWorld(L);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    int len = (int)lua_rawlen(L, 2);
+    std::vector<int> items(len);
+    for (int i = 0; i < len; i++) {
+        lua_rawgeti(L, 2, i + 1);
+        items[i] = (int)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+    }
+    world->removeMany(items.data(), len);
+    return 0;
+}
+
+// -- reads the cell sizes at narg, narg + 1, ...: one per axis, each
+// defaulting to the one before it, the first to def when def > 0
+static void checkCellSizes(lua_State *L, int narg, double def, double *sizes)
+{
+    for (int a = 0; a < 3; a++) {
+        double d = (a == 0) ? def : sizes[a - 1];
+        sizes[a] = (d > 0) ? luaL_optnumber(L, narg + a, d)
+                           : luaL_checknumber(L, narg + a);
+        luaL_argcheck(L, sizes[a] > 0 && sizes[a] < HUGE_VAL, narg + a,
+                      "cell size must be a positive number");
+    }
+}
+
+// world:cellSize() -> the cell width, height, depth
+static int worldCellSize(lua_State *L)
+{
+    World *world = checkWorld(L);
+    for (int a = 0; a < 3; a++) {
+        lua_pushnumber(L, world->cellSize.size[a]);
+    }
+    return 3;
+}
+
+// world:suggestCellSize([reset]) -> cell sizes for the current items and the
+// queries seen so far, one per axis; reset forgets those queries
+static int worldSuggestCellSize(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double sizes[3];
+    world->suggestCellSize(sizes);
+    if (lua_toboolean(L, 2)) {
+        world->resetFootprints();
+    }
+    for (int a = 0; a < 3; a++) {
+        lua_pushnumber(L, sizes[a]);
+    }
+    return 3;
+}
+
+// world:rebuild(w, h, d) -> re-buckets every item under the new cell sizes;
+// omitted ones repeat the one before
+static int worldRebuild(lua_State *L)
+{
+    World *world = checkWorld(L);
+    double sizes[3];
+    checkCellSizes(L, 2, 0, sizes);
+    world->rebuild(sizes);
+    return 0;
+}
+
+// world:counters([reset]) -> table of hot-path operation counts, or nil when
+// the module was built without BUMP_COUNTERS
+static int worldCounters(lua_State *L)
+{
+#ifdef BUMP_COUNTERS
+    World *world = checkWorld(L);
+    Counters &c  = world->counters;
+
+    lua_createtable(L, 0, 7);
+    lauxh_pushint2tbl(L, "cellsVisited", c.cellsVisited);
+    lauxh_pushint2tbl(L, "candidates", c.candidates);
+    lauxh_pushint2tbl(L, "dedupeHits", c.dedupeHits);
+    lauxh_pushint2tbl(L, "detectCalls", c.detectCalls);
+    lauxh_pushint2tbl(L, "detectHits", c.detectHits);
+    lauxh_pushint2tbl(L, "responseIters", c.responseIters);
+    lauxh_pushint2tbl(L, "traverseSteps", c.traverseSteps);
+    if (lua_toboolean(L, 2)) {
+        c.reset();
+    }
+#else
+    lua_pushnil(L);
+#endif
+    return 1;
+}
+
+static int bumpWorldRelease(lua_State *L)
+{
+    BumpWorld3d *bump = (BumpWorld3d *)lua_touserdata(L, 1);
+    if (NULL == bump) {
+        return luaL_argerror(L, 1, "invalid lua-bump pointer");
+    }
+
+    delete bump->world;
+    bump->world = NULL;
+    return 0;
+}
+
+// world:save(path) -> true, or nil and an error message
+static int worldSave(lua_State *L)
+{
+    World *world    = ((BumpWorld3d *)lua_touserdata(L, 1))->world;
+    const char *err = bump::snapshot_save(*world, luaL_checkstring(L, 2));
+    if (err) {
+        lua_pushnil(L);
+        lua_pushstring(L, err);
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+static World *pushWorld(lua_State *L, const double *cellSizes)
+{
+    BumpWorld3d *bump =
+        (BumpWorld3d *)lua_newuserdatauv(L, sizeof(BumpWorld3d), 0);
+    World *world = new World(cellSizes);
+    bump->world  = world;
+
+    if (luaL_newmetatable(L, METANAME)) // mt
+    {
+        luaL_Reg l[] = {
+            {"project",                worldProject               },
+            {"countCells",             worldCountCells            },
+            {"hasItem",                worldHasItem               },
+            {"countItems",             worldCountItems            },
+            {"getCube",                worldGetCube               },
+            {"toWorld",                worldToWorld               },
+            {"toCell",                 worldToCell                },
+            {"queryCube",              worldQueryCube             },
+            {"queryPoint",             worldQueryPoint            },
+            {"querySegment",           worldQuerySegment          },
+            {"querySegmentWithCoords", worldQuerySegmentWithCoords},
+            {"queryCubeMany",          worldQueryCubeMany         },
+            {"queryPointMany",         worldQueryPointMany        },
+            {"firstHitMany",           worldFirstHitMany          },
+            {"querySegmentMany",       worldQuerySegmentMany      },
+            {"lineOfSightMany",        worldLineOfSightMany       },
+            {"add",                    worldAdd                   },
+            {"remove",                 worldRemove                },
+            {"update",                 worldUpdate                },
+            {"move",                   worldMove                  },
+            {"check",                  worldCheck                 },
+            {"moveMany",               worldMoveMany              },
+            {"moveSwept",              worldMoveSwept             },
+            {"setBody",                worldSetBody               },
+            {"getBody",                worldGetBody               },
+            {"removeBody",             worldRemoveBody            },
+            {"step",                   worldStep                  },
+            {"addMany",                worldAddMany               },
+            {"removeMany",             worldRemoveMany            },
+            {"cellSize",               worldCellSize              },
+            {"suggestCellSize",        worldSuggestCellSize       },
+            {"rebuild",                worldRebuild               },
+            {"clear",                  worldClear                 },
+            {"counters",               worldCounters              },
+            {"save",                   worldSave                  },
+            {NULL,                     NULL                       }
+        };
+        luaL_newlib(L, l);              //{}
+        lua_setfield(L, -2, "__index"); // mt[__index] = {}
+        lua_pushcfunction(L, bumpWorldRelease);
+        lua_setfield(L, -2, "__gc"); // mt[__gc] = bumpWorldRelease
+    }
+    lua_setmetatable(L, -2); // set userdata metatable
+    return world;
+}
+
+// bump3d.load(path) -> a world rebuilt from world:save(), or nil and an error
+// message
+static int bumpLoad(lua_State *L)
+{
+    const char *path    = luaL_checkstring(L, 1);
+    double cellSizes[3] = {64, 64, 64};
+    World *world        = pushWorld(L, cellSizes);
+    const char *err     = bump::snapshot_load(*world, path);
+    if (err) {
+        lua_pushnil(L);
+        lua_pushstring(L, err);
+        return 2;
+    }
+    return 1;
+}
+
+// bump3d.newWorld([cellWidth [, cellHeight [, cellDepth]]]) -> a world whose
+// cells may be non-cubic and fractional; omitted sizes repeat the one before
+static int bumpNewWorld(lua_State *L)
+{
+    double cellSizes[3];
+    checkCellSizes(L, 1, 64, cellSizes);
+    pushWorld(L, cellSizes);
+    return 1;
+}
+
+// bump3d.newBoundedWorld(x, y, z, w, h, d [, cellWidth [, cellHeight
+// [, cellDepth]]]) -> a world that keeps the cells over the given area in a
+// flat array; items may still leave it
+static int bumpNewBoundedWorld(lua_State *L)
+{
+    double pos[3], size[3], cellSizes[3];
+    for (int a = 0; a < 3; a++) {
+        pos[a]  = luaL_checknumber(L, 1 + a);
+        size[a] = luaL_checknumber(L, 4 + a);
+        luaL_argcheck(L, size[a] > 0, 4 + a, "bounds must not be empty");
+    }
+    checkCellSizes(L, 7, 64, cellSizes);
+
+    bump::CellSize<3> cs;
+    cs.set(cellSizes);
+    int lo[3], len[3];
+    bump::grid_toCellBox<3>(cs, pos, size, lo, len);
+    double total = 1;
+    for (int a = 0; a < 3; a++) {
+        total *= len[a];
+    }
+    luaL_argcheck(L, total <= (1 << 24), 1,
+                  "bounds cover too many cells for their cell size");
+
+    World *world = pushWorld(L, cellSizes);
+    world->bound(pos, size);
+    return 1;
+}
+
+/*------------------------------------------
+-- cube.* helpers
+------------------------------------------*/
+
+static int cubeGetNearestCorner(lua_State *L)
+{
+    double x  = luaL_checknumber(L, 1);
+    double y  = luaL_checknumber(L, 2);
+    double z  = luaL_checknumber(L, 3);
+    double w  = luaL_checknumber(L, 4);
+    double h  = luaL_checknumber(L, 5);
+    double d  = luaL_checknumber(L, 6);
+    double px = luaL_checknumber(L, 7);
+    double py = luaL_checknumber(L, 8);
+    double pz = luaL_checknumber(L, 9);
+    double nx, ny, nz;
+    cube_getNearestCorner(x, y, z, w, h, d, px, py, pz, nx, ny, nz);
+    lua_pushnumber(L, nx);
+    lua_pushnumber(L, ny);
+    lua_pushnumber(L, nz);
+    return 3;
+}
+
+// -- cube.getSegmentIntersectionIndices(x,y,z,w,h,d, x1,y1,z1, x2,y2,z2
+// [, ti1, ti2]) -> ti1, ti2, nx1, ny1, nz1, nx2, ny2, nz2 or nothing
+static int cubeGetSegmentIntersectionIndices(lua_State *L)
+{
+    double x   = luaL_checknumber(L, 1);
+    double y   = luaL_checknumber(L, 2);
+    double z   = luaL_checknumber(L, 3);
+    double w   = luaL_checknumber(L, 4);
+    double h   = luaL_checknumber(L, 5);
+    double d   = luaL_checknumber(L, 6);
+    double x1  = luaL_checknumber(L, 7);
+    double y1  = luaL_checknumber(L, 8);
+    double z1  = luaL_checknumber(L, 9);
+    double x2  = luaL_checknumber(L, 10);
+    double y2  = luaL_checknumber(L, 11);
+    double z2  = luaL_checknumber(L, 12);
+    double ti1 = luaL_optnumber(L, 13, 0);
+    double ti2 = luaL_optnumber(L, 14, 1);
+    double nx1, ny1, nz1, nx2, ny2, nz2;
+    if (!cube_getSegmentIntersectionIndices(x, y, z, w, h, d, x1, y1, z1, x2,
+                                            y2, z2, ti1, ti2, nx1, ny1, nz1,
+                                            nx2, ny2, nz2)) {
+        return 0;
+    }
+    lua_pushnumber(L, ti1);
+    lua_pushnumber(L, ti2);
+    lua_pushnumber(L, nx1);
+    lua_pushnumber(L, ny1);
+    lua_pushnumber(L, nz1);
+    lua_pushnumber(L, nx2);
+    lua_pushnumber(L, ny2);
+    lua_pushnumber(L, nz2);
+    return 8;
+}
+
+static void checkTwoCubes(lua_State *L, double *a)
+{
+    for (int i = 0; i < 12; i++) {
+        a[i] = luaL_checknumber(L, i + 1);
+    }
+}
+
+static int cubeGetDiff(lua_State *L)
+{
+    double a[12];
+    checkTwoCubes(L, a);
+    double x, y, z, w, h, d;
+    cube_getDiff(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9],
+                 a[10], a[11], x, y, z, w, h, d);
+    lua_pushnumber(L, x);
+    lua_pushnumber(L, y);
+    lua_pushnumber(L, z);
+    lua_pushnumber(L, w);
+    lua_pushnumber(L, h);
+    lua_pushnumber(L, d);
+    return 6;
+}
+
+static int cubeContainsPoint(lua_State *L)
+{
+    double a[9];
+    for (int i = 0; i < 9; i++) {
+        a[i] = luaL_checknumber(L, i + 1);
+    }
+    lua_pushboolean(L, cube_containsPoint(a[0], a[1], a[2], a[3], a[4], a[5],
+                                          a[6], a[7], a[8]));
+    return 1;
+}
+
+static int cubeIsIntersecting(lua_State *L)
+{
+    double a[12];
+    checkTwoCubes(L, a);
+    lua_pushboolean(L, cube_isIntersecting(a[0], a[1], a[2], a[3], a[4], a[5],
+                                           a[6], a[7], a[8], a[9], a[10],
+                                           a[11]));
+    return 1;
+}
+
+static int cubeGetCubeDistance(lua_State *L)
+{
+    double a[12];
+    checkTwoCubes(L, a);
+    lua_pushnumber(L, cube_getCubeDistance(a[0], a[1], a[2], a[3], a[4], a[5],
+                                           a[6], a[7], a[8], a[9], a[10],
+                                           a[11]));
+    return 1;
+}
+
+static int cubeDetectCollision(lua_State *L)
+{
+    double a[12];
+    checkTwoCubes(L, a);
+    double gx = luaL_optnumber(L, 13, a[0]);
+    double gy = luaL_optnumber(L, 14, a[1]);
+    double gz = luaL_optnumber(L, 15, a[2]);
+    Collision col;
+    if (!cube_detectCollision(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7],
+                              a[8], a[9], a[10], a[11], gx, gy, gz, col)) {
+        return 0;
+    }
+    lua_createtable(L, 0, 8);
+    lua_pushboolean(L, col.overlaps);
+    lua_setfield(L, -2, "overlaps");
+    lauxh_pushnum2tbl(L, "ti", col.ti);
+    setPointField(L, "move", col.move);
+    setPointField(L, "normal", col.normal);
+    setPointField(L, "touch", col.touch);
+    setCubeField(L, "itemCube", col.itemBox);
+    setCubeField(L, "otherCube", col.otherBox);
+    return 1;
+}
+
 extern "C" {
 int LUAMOD_API luaopen_bump3d(lua_State *L)
 {
+    const luaL_Reg bumpFuncs[] = {
+        {"newWorld",        bumpNewWorld       },
+        {"newBoundedWorld", bumpNewBoundedWorld},
+        {"load",            bumpLoad           },
+        {NULL,              NULL               },
+    };
+
+    luaL_newlib(L, bumpFuncs);
+
+    const luaL_Reg cubeFuncs[] = {
+        {"getNearestCorner",              cubeGetNearestCorner             },
+        {"getSegmentIntersectionIndices", cubeGetSegmentIntersectionIndices},
+        {"getDiff",                       cubeGetDiff                      },
+        {"containsPoint",                 cubeContainsPoint                },
+        {"isIntersecting",                cubeIsIntersecting               },
+        {"getCubeDistance",               cubeGetCubeDistance              },
+        {"detectCollision",               cubeDetectCollision              },
+        {NULL,                            NULL                             },
+    };
+
+    luaL_newlib(L, cubeFuncs);
+    lua_setfield(L, -2, "cube");
+
+    lauxh_pushint2tbl(L, "touch", Touch);
+    lauxh_pushint2tbl(L, "cross", Cross);
+    lauxh_pushint2tbl(L, "slide", Slide);
+    lauxh_pushint2tbl(L, "bounce", Bounce);
+
+    //-- true when item boxes are stored as float (built with BUMP_FLOAT32)
+#ifdef BUMP_FLOAT32
+    lua_pushboolean(L, 1);
+#else
+    lua_pushboolean(L, 0);
+#endif
+    lua_setfield(L, -2, "float32");
+
     return 1;
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,612 @@
+// Native microbenchmarks for bump2d::World and bump3d::World.
+//
+// Needs neither Lua nor skynet: the worlds are driven directly through their
+// C++ API. Every (dim, items, density, cellSize) case populates one world and
+// then times each operation on it, emitting one JSON object per line:
+//
+//   {"dim":2,"op":"queryRect","items":10000,"density":0.25,"cellSize":64,
+//    "ops":20000,"ns_per_op":812.4,"allocs_per_op":3.02,
+//    "bytes_per_op":121.7,"peak_heap_bytes":5310245,"peak_rss_kb":14120}
+//
+// allocs/bytes per op come from the counting operator new below, peak heap
+// is the highest live heap size seen while the op ran, and peak rss is the
+// process high-water mark so far.
+//
+//   ./bench [--dim=2,3] [--items=1000,10000,100000,1000000]
+//           [--density=0.05,0.25,1] [--cell=16,64,256] [--ops=N]
+//           [--only=add,move_slide,...] [--seed=N]
+
+#include "../2d/bump2d.hpp"
+#include "../3d/bump3d.hpp"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <time.h>
+
+/*------------------------------------------
+-- Allocation accounting
+------------------------------------------*/
+
+#define ALLOC_HEADER 16 // keeps the malloc alignment of the returned block
+
+// -- kept out of line so that the compiler never pairs the malloc/free
+// -- inside them with the new/delete at a call site
+#if defined(__GNUC__)
+#define ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define ALLOC_NOINLINE
+#endif
+
+static size_t allocCount  = 0;
+static size_t allocBytes  = 0;
+static size_t liveBytes   = 0;
+static size_t peakBytes   = 0;
+
+ALLOC_NOINLINE void *operator new(size_t size)
+{
+    char *p = (char *)malloc(size + ALLOC_HEADER);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    *(size_t *)p = size;
+    allocCount++;
+    allocBytes += size;
+    liveBytes += size;
+    if (liveBytes > peakBytes) {
+        peakBytes = liveBytes;
+    }
+    return p + ALLOC_HEADER;
+}
+
+ALLOC_NOINLINE void operator delete(void *ptr) noexcept
+{
+    if (!ptr) {
+        return;
+    }
+    char *p = (char *)ptr - ALLOC_HEADER;
+    liveBytes -= *(size_t *)p;
+    free(p);
+}
+
+ALLOC_NOINLINE void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+ALLOC_NOINLINE void operator delete[](void *ptr) noexcept
+{
+    operator delete(ptr);
+}
+
+ALLOC_NOINLINE void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+ALLOC_NOINLINE void operator delete[](void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+/*------------------------------------------
+-- Helpers
+------------------------------------------*/
+
+static unsigned long long rngState = 88172645463325252ULL;
+
+static double frand(double lo, double hi)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return lo + (hi - lo) * ((rngState >> 11) * (1.0 / 9007199254740992.0));
+}
+
+static double nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peakRssKb()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#ifdef __APPLE__
+    return ru.ru_maxrss / 1024;
+#else
+    return ru.ru_maxrss;
+#endif
+}
+
+static std::vector<double> parseList(const char *s)
+{
+    std::vector<double> v;
+    while (*s) {
+        char *end;
+        double d = strtod(s, &end);
+        if (end == s) {
+            break;
+        }
+        v.push_back(d);
+        s = (*end == ',') ? end + 1 : end;
+    }
+    return v;
+}
+
+struct Case {
+    int dim;
+    int items;
+    double density;
+    int cellSize;
+};
+
+struct Sample {
+    double start;
+    size_t allocs, bytes;
+};
+
+static std::string only;
+
+static bool enabled(const char *op)
+{
+    if (only.empty()) {
+        return true;
+    }
+    std::string list = "," + only + ",";
+    return list.find(std::string(",") + op + ",") != std::string::npos;
+}
+
+static void begin(Sample &s)
+{
+    peakBytes = liveBytes;
+    s.allocs  = allocCount;
+    s.bytes   = allocBytes;
+    s.start   = nowNs();
+}
+
+static void end(const Case &c, const char *op, int ops, const Sample &s)
+{
+    double ns = nowNs() - s.start;
+    if (ops <= 0) {
+        return;
+    }
+    printf("{\"dim\":%d,\"op\":\"%s\",\"items\":%d,\"density\":%g,"
+           "\"cellSize\":%d,\"ops\":%d,\"ns_per_op\":%.1f,"
+           "\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f,"
+           "\"peak_heap_bytes\":%zu,\"peak_rss_kb\":%ld}\n",
+           c.dim, op, c.items, c.density, c.cellSize, ops, ns / ops,
+           (double)(allocCount - s.allocs) / ops,
+           (double)(allocBytes - s.bytes) / ops, peakBytes, peakRssKb());
+    fflush(stdout);
+}
+
+// -- items are 4..28 units wide per axis (16 on average); the world extent is
+// chosen so that the summed item area (volume) covers `density` of it
+#define ITEM_MIN 4.0
+#define ITEM_MAX 28.0
+#define ITEM_AVG 16.0
+
+// -- a spawned wave (monsters, a loaded chunk) goes in with one addMany();
+// -- the load_* ops put the whole input into an empty world and take it out
+// -- again, item by item and then as one batch
+#define WAVE_SIZE 5000
+
+/*------------------------------------------
+-- 2D
+------------------------------------------*/
+
+static void bench2d(const Case &c, int ops)
+{
+    using namespace bump2d;
+
+    double side = sqrt(c.items * ITEM_AVG * ITEM_AVG / c.density);
+    World world;
+    world.initialize(c.cellSize);
+
+    std::vector<int> ids;
+    ids.reserve(c.items);
+    std::vector<Rect> input(c.items);
+    for (int i = 0; i < c.items; i++) {
+        input[i].x = frand(0, side);
+        input[i].y = frand(0, side);
+        input[i].w = frand(ITEM_MIN, ITEM_MAX);
+        input[i].h = frand(ITEM_MIN, ITEM_MAX);
+    }
+
+    Sample s;
+    begin(s);
+    for (int i = 0; i < c.items; i++) {
+        int id = world.allocateId();
+        world.add(id, input[i].x, input[i].y, input[i].w, input[i].h);
+        ids.push_back(id);
+    }
+    end(c, "add", c.items, s);
+
+    if (enabled("queryRect")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            std::set<int> items;
+            world.queryRect(frand(0, side), frand(0, side), 64, 64, NULL,
+                            items);
+        }
+        end(c, "queryRect", ops, s);
+    }
+
+    if (enabled("queryPoint")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            std::set<int> items;
+            world.queryPoint(frand(0, side), frand(0, side), NULL, items);
+        }
+        end(c, "queryPoint", ops, s);
+    }
+
+    if (enabled("querySegment")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            double x = frand(0, side), y = frand(0, side);
+            std::set<int> items;
+            world.querySegment(x, y, x + frand(-128, 128),
+                               y + frand(-128, 128), NULL, items);
+        }
+        end(c, "querySegment", ops, s);
+    }
+
+    if (enabled("update")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            int id = ids[(size_t)frand(0, ids.size())];
+            double x, y, w, h;
+            world.getRect(id, x, y, w, h);
+            world.update(id, x + frand(-8, 8), y + frand(-8, 8), w, h);
+        }
+        end(c, "update", ops, s);
+    }
+
+    static const struct {
+        const char *name;
+        int type;
+    } moves[] = {
+        {"move_touch",  Touch },
+        {"move_cross",  Cross },
+        {"move_slide",  Slide },
+        {"move_bounce", Bounce},
+    };
+    for (size_t m = 0; m < sizeof(moves) / sizeof(moves[0]); m++) {
+        if (!enabled(moves[m].name)) {
+            continue;
+        }
+        ColFilter *filter = world.getFilterById(moves[m].type);
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            int id = ids[(size_t)frand(0, ids.size())];
+            double x, y, w, h, ax, ay;
+            world.getRect(id, x, y, w, h);
+            std::vector<Collision> cols;
+            world.move(id, x + frand(-16, 16), y + frand(-16, 16), filter, ax,
+                       ay, cols);
+        }
+        end(c, moves[m].name, ops, s);
+    }
+
+    if (enabled("wave")) {
+        std::vector<double> packed(4 * WAVE_SIZE);
+        for (int i = 0; i < WAVE_SIZE; i++) {
+            packed[4 * i]     = frand(0, side);
+            packed[4 * i + 1] = frand(0, side);
+            packed[4 * i + 2] = frand(ITEM_MIN, ITEM_MAX);
+            packed[4 * i + 3] = frand(ITEM_MIN, ITEM_MAX);
+        }
+        std::vector<int> wave(WAVE_SIZE);
+
+        begin(s);
+        for (int i = 0; i < WAVE_SIZE; i++) {
+            wave[i] = world.allocateId();
+            world.add(wave[i], packed[4 * i], packed[4 * i + 1],
+                      packed[4 * i + 2], packed[4 * i + 3]);
+        }
+        end(c, "wave_add", WAVE_SIZE, s);
+        begin(s);
+        for (int i = 0; i < WAVE_SIZE; i++) {
+            world.remove(wave[i]);
+        }
+        end(c, "wave_remove", WAVE_SIZE, s);
+
+        begin(s);
+        world.addMany(&packed[0], WAVE_SIZE, &wave[0]);
+        end(c, "wave_addMany", WAVE_SIZE, s);
+        begin(s);
+        world.removeMany(&wave[0], WAVE_SIZE);
+        end(c, "wave_removeMany", WAVE_SIZE, s);
+    }
+
+    if (enabled("load")) {
+        std::vector<double> packed(4 * c.items);
+        for (int i = 0; i < c.items; i++) {
+            packed[4 * i]     = input[i].x;
+            packed[4 * i + 1] = input[i].y;
+            packed[4 * i + 2] = input[i].w;
+            packed[4 * i + 3] = input[i].h;
+        }
+        std::vector<int> loaded(c.items);
+        World single, batch;
+        single.initialize(c.cellSize);
+        batch.initialize(c.cellSize);
+
+        begin(s);
+        for (int i = 0; i < c.items; i++) {
+            loaded[i] = single.allocateId();
+            single.add(loaded[i], input[i].x, input[i].y, input[i].w,
+                       input[i].h);
+        }
+        end(c, "load_add", c.items, s);
+        begin(s);
+        for (int i = 0; i < c.items; i++) {
+            single.remove(loaded[i]);
+        }
+        end(c, "load_remove", c.items, s);
+        single.release();
+
+        begin(s);
+        batch.addMany(&packed[0], c.items, &loaded[0]);
+        end(c, "load_addMany", c.items, s);
+        begin(s);
+        batch.removeMany(&loaded[0], c.items);
+        end(c, "load_removeMany", c.items, s);
+        batch.release();
+    }
+
+    if (enabled("remove")) {
+        int n = ops < (int)ids.size() ? ops : (int)ids.size();
+        begin(s);
+        for (int i = 0; i < n; i++) {
+            world.remove(ids[i]);
+        }
+        end(c, "remove", n, s);
+    }
+
+    world.release();
+}
+
+/*------------------------------------------
+-- 3D
+------------------------------------------*/
+
+static void bench3d(const Case &c, int ops)
+{
+    using namespace bump3d;
+
+    double side =
+        cbrt(c.items * ITEM_AVG * ITEM_AVG * ITEM_AVG / c.density);
+    World world(c.cellSize);
+
+    std::vector<int> ids;
+    ids.reserve(c.items);
+    std::vector<Cube> input(c.items);
+    for (int i = 0; i < c.items; i++) {
+        input[i].x = frand(0, side);
+        input[i].y = frand(0, side);
+        input[i].z = frand(0, side);
+        input[i].w = frand(ITEM_MIN, ITEM_MAX);
+        input[i].h = frand(ITEM_MIN, ITEM_MAX);
+        input[i].d = frand(ITEM_MIN, ITEM_MAX);
+    }
+
+    Sample s;
+    begin(s);
+    for (int i = 0; i < c.items; i++) {
+        int id = world.allocateId();
+        world.add(id, input[i].x, input[i].y, input[i].z, input[i].w,
+                  input[i].h, input[i].d);
+        ids.push_back(id);
+    }
+    end(c, "add", c.items, s);
+
+    if (enabled("queryCube")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            std::set<int> items;
+            world.queryCube(frand(0, side), frand(0, side), frand(0, side),
+                            64, 64, 64, NULL, items);
+        }
+        end(c, "queryCube", ops, s);
+    }
+
+    if (enabled("queryPoint")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            std::set<int> items;
+            world.queryPoint(frand(0, side), frand(0, side), frand(0, side),
+                             NULL, items);
+        }
+        end(c, "queryPoint", ops, s);
+    }
+
+    if (enabled("querySegment")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            double x = frand(0, side), y = frand(0, side), z = frand(0, side);
+            std::set<int> items;
+            world.querySegment(x, y, z, x + frand(-128, 128),
+                               y + frand(-128, 128), z + frand(-128, 128),
+                               NULL, items);
+        }
+        end(c, "querySegment", ops, s);
+    }
+
+    if (enabled("update")) {
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            int id = ids[(size_t)frand(0, ids.size())];
+            double x, y, z, w, h, d;
+            world.getCube(id, x, y, z, w, h, d);
+            world.update(id, x + frand(-8, 8), y + frand(-8, 8),
+                         z + frand(-8, 8), w, h, d);
+        }
+        end(c, "update", ops, s);
+    }
+
+    static const struct {
+        const char *name;
+        int type;
+    } moves[] = {
+        {"move_touch",  Touch },
+        {"move_cross",  Cross },
+        {"move_slide",  Slide },
+        {"move_bounce", Bounce},
+    };
+    for (size_t m = 0; m < sizeof(moves) / sizeof(moves[0]); m++) {
+        if (!enabled(moves[m].name)) {
+            continue;
+        }
+        ColFilter *filter = world.getFilterById(moves[m].type);
+        begin(s);
+        for (int i = 0; i < ops; i++) {
+            int id = ids[(size_t)frand(0, ids.size())];
+            double x, y, z, w, h, d, ax, ay, az;
+            world.getCube(id, x, y, z, w, h, d);
+            std::vector<Collision> cols;
+            world.move(id, x + frand(-16, 16), y + frand(-16, 16),
+                       z + frand(-16, 16), filter, ax, ay, az, cols);
+        }
+        end(c, moves[m].name, ops, s);
+    }
+
+    if (enabled("wave")) {
+        std::vector<double> packed(6 * WAVE_SIZE);
+        for (int i = 0; i < WAVE_SIZE; i++) {
+            for (int a = 0; a < 3; a++) {
+                packed[6 * i + a]     = frand(0, side);
+                packed[6 * i + 3 + a] = frand(ITEM_MIN, ITEM_MAX);
+            }
+        }
+        std::vector<int> wave(WAVE_SIZE);
+
+        begin(s);
+        for (int i = 0; i < WAVE_SIZE; i++) {
+            const double *p = &packed[6 * i];
+            wave[i]         = world.allocateId();
+            world.add(wave[i], p[0], p[1], p[2], p[3], p[4], p[5]);
+        }
+        end(c, "wave_add", WAVE_SIZE, s);
+        begin(s);
+        for (int i = 0; i < WAVE_SIZE; i++) {
+            world.remove(wave[i]);
+        }
+        end(c, "wave_remove", WAVE_SIZE, s);
+
+        begin(s);
+        world.addMany(&packed[0], WAVE_SIZE, &wave[0]);
+        end(c, "wave_addMany", WAVE_SIZE, s);
+        begin(s);
+        world.removeMany(&wave[0], WAVE_SIZE);
+        end(c, "wave_removeMany", WAVE_SIZE, s);
+    }
+
+    if (enabled("load")) {
+        std::vector<double> packed(6 * c.items);
+        for (int i = 0; i < c.items; i++) {
+            double *p = &packed[6 * i];
+            p[0]      = input[i].x;
+            p[1]      = input[i].y;
+            p[2]      = input[i].z;
+            p[3]      = input[i].w;
+            p[4]      = input[i].h;
+            p[5]      = input[i].d;
+        }
+        std::vector<int> loaded(c.items);
+        {
+            World single(c.cellSize);
+            begin(s);
+            for (int i = 0; i < c.items; i++) {
+                const double *p = &packed[6 * i];
+                loaded[i]       = single.allocateId();
+                single.add(loaded[i], p[0], p[1], p[2], p[3], p[4], p[5]);
+            }
+            end(c, "load_add", c.items, s);
+            begin(s);
+            for (int i = 0; i < c.items; i++) {
+                single.remove(loaded[i]);
+            }
+            end(c, "load_remove", c.items, s);
+        }
+        World batch(c.cellSize);
+
+        begin(s);
+        batch.addMany(&packed[0], c.items, &loaded[0]);
+        end(c, "load_addMany", c.items, s);
+        begin(s);
+        batch.removeMany(&loaded[0], c.items);
+        end(c, "load_removeMany", c.items, s);
+    }
+
+    if (enabled("remove")) {
+        int n = ops < (int)ids.size() ? ops : (int)ids.size();
+        begin(s);
+        for (int i = 0; i < n; i++) {
+            world.remove(ids[i]);
+        }
+        end(c, "remove", n, s);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<double> dims      = parseList("2,3");
+    std::vector<double> items     = parseList("1000,10000,100000,1000000");
+    std::vector<double> densities = parseList("0.05,0.25,1");
+    std::vector<double> cells     = parseList("16,64,256");
+    int ops                       = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strncmp(a, "--dim=", 6)) {
+            dims = parseList(a + 6);
+        } else if (!strncmp(a, "--items=", 8)) {
+            items = parseList(a + 8);
+        } else if (!strncmp(a, "--density=", 10)) {
+            densities = parseList(a + 10);
+        } else if (!strncmp(a, "--cell=", 7)) {
+            cells = parseList(a + 7);
+        } else if (!strncmp(a, "--ops=", 6)) {
+            ops = atoi(a + 6);
+        } else if (!strncmp(a, "--only=", 7)) {
+            only = a + 7;
+        } else if (!strncmp(a, "--seed=", 7)) {
+            rngState = strtoull(a + 7, NULL, 10) | 1;
+        } else {
+            fprintf(stderr,
+                    "usage: %s [--dim=2,3] [--items=N,...] "
+                    "[--density=D,...] [--cell=S,...] [--ops=N] "
+                    "[--only=op,...] [--seed=N]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t d = 0; d < dims.size(); d++) {
+        for (size_t n = 0; n < items.size(); n++) {
+            for (size_t k = 0; k < densities.size(); k++) {
+                for (size_t cs = 0; cs < cells.size(); cs++) {
+                    Case c;
+                    c.dim      = (int)dims[d];
+                    c.items    = (int)items[n];
+                    c.density  = densities[k];
+                    c.cellSize = (int)cells[cs];
+                    if (c.dim == 3) {
+                        bench3d(c, ops);
+                    } else {
+                        bench2d(c, ops);
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,75 @@
+//-- Lockstep trace for the fixed-point worlds: runs a scripted random walk
+//-- and prints one hash of every move() result. `make determinism` builds it
+//-- with different compilers and flags and checks that the hashes agree;
+//-- spec/2d/fixed_spec.lua replays the 2D script and expects the same hash.
+
+#include "../2d/bump2d.hpp"
+#include "../3d/bump3d.hpp"
+#include <stdio.h>
+
+static unsigned int lcgState;
+
+static int lcg(int n)
+{
+    lcgState = (lcgState * 1103515245u + 12345u) & 0x7fffffffu;
+    return lcgState % n;
+}
+
+static unsigned int fnv(unsigned int h, long long v)
+{
+    return (h ^ (unsigned int)v) * 16777619u;
+}
+
+template <int N, class W, class C>
+static unsigned int run(int items, int steps)
+{
+    W world;
+    world.initialize(64);
+    lcgState = 1;
+
+    for (int i = 1; i <= items; i++) {
+        int pos[N], size[N];
+        for (int a = 0; a < N; a++) {
+            pos[a] = lcg(1024);
+        }
+        for (int a = 0; a < N; a++) {
+            size[a] = 16 + lcg(112);
+        }
+        world.add(i, pos, size);
+    }
+
+    unsigned int h = 2166136261u;
+    for (int s = 0; s < steps; s++) {
+        for (int i = 1; i <= items; i++) {
+            int pos[N], size[N], goal[N], actual[N];
+            world.getBox(i, pos, size);
+            for (int a = 0; a < N; a++) {
+                goal[a] = pos[a] + lcg(97) - 48;
+            }
+            std::vector<C> cols;
+            world.move(i, goal, world.getFilterById(1 + i % 4), actual, cols);
+            for (int a = 0; a < N; a++) {
+                h = fnv(h, actual[a]);
+            }
+            for (size_t k = 0; k < cols.size(); k++) {
+                h = fnv(h, cols[k].other);
+                h = fnv(h, cols[k].ti.num);
+                h = fnv(h, cols[k].ti.den);
+                for (int a = 0; a < N; a++) {
+                    h = fnv(h, cols[k].touch[a]);
+                }
+            }
+        }
+    }
+    world.release();
+    return h;
+}
+
+int main()
+{
+    printf("fixed2d %08x\n",
+           run<2, bump2d::FixedWorld, bump2d::FixedCollision>(40, 200));
+    printf("fixed3d %08x\n",
+           run<3, bump3d::FixedWorld, bump3d::FixedCollision>(40, 200));
+    return 0;
+}
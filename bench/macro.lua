@@ -0,0 +1,411 @@
+-- End-to-end scenarios through the Lua binding (argument parsing, result
+-- tables and all), run against the native bump2d module and, when it can be
+-- found, the original pure-Lua bump.lua on identical inputs.
+--
+-- Run from the repository root:
+--
+--   lua bench/macro.lua [scenario ...] [--baseline=path/to/bump.lua]
+--
+-- The baseline is kikito's bump.lua; it is not shipped here. Pass its path
+-- with --baseline, or drop it in as bench/bump.lua. Without it only the
+-- native numbers are printed.
+--
+-- Per run the columns are: calls into the world, CPU seconds, calls per
+-- second, Lua heap bytes allocated per call (GC stopped while measuring)
+-- and a checksum of the final state, which must agree between the two
+-- implementations for the comparison to mean anything.
+
+package.cpath = "2d/?.so;" .. package.cpath
+package.path = "bench/?.lua;" .. package.path
+
+local scenarios_wanted, baseline_path = {}, nil
+for i = 1, #(arg or {}) do
+    local a = arg[i]
+    if a:sub(1, 11) == "--baseline=" then
+        baseline_path = a:sub(12)
+    else
+        scenarios_wanted[#scenarios_wanted + 1] = a
+    end
+end
+
+-- RANDOM ----------------------------------------------------------------------
+-- a small LCG so both implementations see exactly the same inputs
+
+local seed
+local function reseed(s)
+    seed = s
+end
+local function rand(lo, hi)
+    seed = (seed * 1103515245 + 12345) % 2147483648
+    return lo + (hi - lo) * (seed / 2147483648)
+end
+
+-- ADAPTERS --------------------------------------------------------------------
+-- Both adapters expose the same small interface; handles are whatever the
+-- implementation uses to name an item (ids natively, tables in bump.lua).
+
+local function native_adapter()
+    local bump = require("bump2d")
+    local kinds = {touch = bump.touch, cross = bump.cross, slide = bump.slide, bounce = bump.bounce}
+    local A = {name = "native"}
+    function A.newWorld(cellSize)
+        local world = bump.newWorld(cellSize)
+        local W = {}
+        function W.add(x, y, w, h)
+            return world:add(x, y, w, h)
+        end
+        function W.remove(item)
+            world:remove(item)
+        end
+        function W.update(item, x, y, w, h)
+            world:update(item, x, y, w, h)
+        end
+        function W.move(item, gx, gy, kind)
+            return world:move(item, gx, gy, kinds[kind])
+        end
+        function W.queryRect(x, y, w, h)
+            local items = world:queryRect(x, y, w, h)
+            return items, #items
+        end
+        function W.queryPoint(x, y)
+            local items = world:queryPoint(x, y)
+            return items, #items
+        end
+        function W.querySegment(x1, y1, x2, y2)
+            local items = world:querySegment(x1, y1, x2, y2)
+            return items, #items
+        end
+        return W
+    end
+    return A
+end
+
+local function baseline_adapter()
+    local ok, bump
+    if baseline_path then
+        ok, bump = pcall(dofile, baseline_path)
+    else
+        ok, bump = pcall(require, "bump")
+    end
+    if not ok or type(bump) ~= "table" or not bump.newWorld then
+        return nil
+    end
+    local filters = {}
+    for _, kind in ipairs({"touch", "cross", "slide", "bounce"}) do
+        filters[kind] = function()
+            return kind
+        end
+    end
+    local A = {name = "bump.lua"}
+    function A.newWorld(cellSize)
+        local world = bump.newWorld(cellSize)
+        local W = {}
+        function W.add(x, y, w, h)
+            local item = {}
+            world:add(item, x, y, w, h)
+            return item
+        end
+        function W.remove(item)
+            world:remove(item)
+        end
+        function W.update(item, x, y, w, h)
+            world:update(item, x, y, w, h)
+        end
+        function W.move(item, gx, gy, kind)
+            return world:move(item, gx, gy, filters[kind])
+        end
+        function W.queryRect(x, y, w, h)
+            return world:queryRect(x, y, w, h)
+        end
+        function W.queryPoint(x, y)
+            return world:queryPoint(x, y)
+        end
+        function W.querySegment(x1, y1, x2, y2)
+            return world:querySegment(x1, y1, x2, y2)
+        end
+        return W
+    end
+    return A
+end
+
+-- SCENARIOS -------------------------------------------------------------------
+-- Each scenario builds its world untimed unless loading is what it measures,
+-- then returns a function that runs the timed part and yields
+-- (calls, checksum).
+
+local DT = 1 / 30
+local scenarios = {}
+local order = {}
+
+local function scenario(name, fn)
+    scenarios[name] = fn
+    order[#order + 1] = name
+end
+
+-- slide-moving actors with gravity over ground tiles and floating platforms
+scenario("platformer", function(A)
+    reseed(1)
+    local world = A.newWorld(64)
+    for i = 0, 149 do
+        world.add(i * 16, 1000, 16, 16)
+    end
+    for i = 1, 40 do
+        world.add(rand(0, 2200), rand(300, 950), math.floor(rand(48, 160)), 16)
+    end
+    local actors = {}
+    for i = 1, 300 do
+        local a = {x = rand(0, 2300), y = rand(0, 900), vx = rand(40, 120), vy = 0}
+        if rand(0, 1) < 0.5 then
+            a.vx = -a.vx
+        end
+        a.item = world.add(a.x, a.y, 12, 20)
+        actors[i] = a
+    end
+    return function()
+        local calls = 0
+        for _ = 1, 300 do
+            for i = 1, #actors do
+                local a = actors[i]
+                a.vy = a.vy + 900 * DT
+                local x, y, cols, len = world.move(a.item, a.x + a.vx * DT, a.y + a.vy * DT, "slide")
+                calls = calls + 1
+                for c = 1, len do
+                    local n = cols[c].normal
+                    if n.y ~= 0 then
+                        a.vy = 0
+                    end
+                    if n.x ~= 0 then
+                        a.vx = -a.vx
+                    end
+                end
+                if y > 1400 then -- fell off the map: respawn above it
+                    x, y, a.vy = rand(0, 2300), 0, 0
+                    world.update(a.item, x, y, 12, 20)
+                    calls = calls + 1
+                end
+                a.x, a.y = x, y
+            end
+        end
+        local sum = 0
+        for i = 1, #actors do
+            sum = sum + actors[i].x + actors[i].y
+        end
+        return calls, sum
+    end
+end)
+
+-- a dense top-down crowd walking to random targets, sliding off each other
+-- and periodically looking around with queryRect
+scenario("crowd", function(A)
+    reseed(2)
+    local world = A.newWorld(32)
+    world.add(-10, -10, 1520, 10)
+    world.add(-10, 1500, 1520, 10)
+    world.add(-10, 0, 10, 1500)
+    world.add(1500, 0, 10, 1500)
+    local actors = {}
+    for i = 1, 800 do
+        local a = {x = rand(0, 1490), y = rand(0, 1490), tx = rand(0, 1490), ty = rand(0, 1490)}
+        a.item = world.add(a.x, a.y, 10, 10)
+        actors[i] = a
+    end
+    return function()
+        local calls, seen = 0, 0
+        for tick = 1, 120 do
+            for i = 1, #actors do
+                local a = actors[i]
+                local dx, dy = a.tx - a.x, a.ty - a.y
+                local d = math.sqrt(dx * dx + dy * dy)
+                if d < 4 then
+                    a.tx, a.ty = rand(0, 1490), rand(0, 1490)
+                else
+                    local s = 60 * DT / d
+                    a.x, a.y = world.move(a.item, a.x + dx * s, a.y + dy * s, "slide")
+                    calls = calls + 1
+                end
+                if (tick + i) % 10 == 0 then
+                    local _, len = world.queryRect(a.x - 30, a.y - 30, 70, 70)
+                    seen = seen + len
+                    calls = calls + 1
+                end
+            end
+        end
+        local sum = seen
+        for i = 1, #actors do
+            sum = sum + actors[i].x + actors[i].y
+        end
+        return calls, sum
+    end
+end)
+
+-- many fast bullets ray-cast with querySegment against a few moving targets
+scenario("bullethell", function(A)
+    reseed(3)
+    local world = A.newWorld(64)
+    local targets = {}
+    for i = 1, 60 do
+        local t = {x = rand(0, 1000), y = rand(0, 1000), vx = rand(-50, 50), vy = rand(-50, 50)}
+        t.item = world.add(t.x, t.y, 24, 24)
+        targets[i] = t
+    end
+    local bullets = {}
+    local function spawn(b)
+        local angle = rand(0, 2 * math.pi)
+        b.x, b.y = rand(0, 1000), rand(0, 1000)
+        b.vx, b.vy = math.cos(angle) * 400, math.sin(angle) * 400
+        return b
+    end
+    for i = 1, 2000 do
+        bullets[i] = spawn({})
+    end
+    return function()
+        local calls, hits = 0, 0
+        for _ = 1, 100 do
+            for i = 1, #targets do
+                local t = targets[i]
+                t.x, t.y = t.x + t.vx * DT, t.y + t.vy * DT
+                if t.x < 0 or t.x > 1000 then
+                    t.vx = -t.vx
+                end
+                if t.y < 0 or t.y > 1000 then
+                    t.vy = -t.vy
+                end
+                world.update(t.item, t.x, t.y, 24, 24)
+                calls = calls + 1
+            end
+            for i = 1, #bullets do
+                local b = bullets[i]
+                local nx, ny = b.x + b.vx * DT, b.y + b.vy * DT
+                local _, len = world.querySegment(b.x, b.y, nx, ny)
+                calls = calls + 1
+                if len > 0 or nx < 0 or nx > 1000 or ny < 0 or ny > 1000 then
+                    hits = hits + len
+                    spawn(b)
+                else
+                    b.x, b.y = nx, ny
+                end
+            end
+        end
+        return calls, hits
+    end
+end)
+
+-- loading a large tile map one add per solid tile ...
+local function tilemap(A)
+    local world = A.newWorld(64)
+    local calls = 0
+    for ty = 0, 199 do
+        for tx = 0, 199 do
+            if tx == 0 or ty == 0 or tx == 199 or ty == 199 or rand(0, 1) < 0.3 then
+                world.add(tx * 16, ty * 16, 16, 16)
+                calls = calls + 1
+            end
+        end
+    end
+    return world, calls
+end
+
+scenario("tilemap.load", function(A)
+    reseed(4)
+    return function()
+        local _, calls = tilemap(A)
+        return calls, calls
+    end
+end)
+
+-- ... and playing on it: actors sliding through the tiles plus point picks
+scenario("tilemap.play", function(A)
+    reseed(4)
+    local world = tilemap(A)
+    local actors = {}
+    for i = 1, 100 do
+        local a = {x = rand(16, 3150), y = rand(16, 3150), vx = rand(-90, 90), vy = rand(-90, 90)}
+        a.item = world.add(a.x, a.y, 10, 10)
+        actors[i] = a
+    end
+    return function()
+        local calls, picked = 0, 0
+        for _ = 1, 300 do
+            for i = 1, #actors do
+                local a = actors[i]
+                local x, y, cols, len = world.move(a.item, a.x + a.vx * DT, a.y + a.vy * DT, "slide")
+                calls = calls + 1
+                for c = 1, len do
+                    local n = cols[c].normal
+                    if n.x ~= 0 then
+                        a.vx = -a.vx
+                    end
+                    if n.y ~= 0 then
+                        a.vy = -a.vy
+                    end
+                end
+                a.x, a.y = x, y
+                local _, n = world.queryPoint(rand(0, 3200), rand(0, 3200))
+                picked = picked + n
+                calls = calls + 1
+            end
+        end
+        local sum = picked
+        for i = 1, #actors do
+            sum = sum + actors[i].x + actors[i].y
+        end
+        return calls, sum
+    end
+end)
+
+-- RUNNER ----------------------------------------------------------------------
+
+local function measure(A, name)
+    local run = scenarios[name](A)
+    collectgarbage("collect")
+    collectgarbage("stop")
+    local kb0 = collectgarbage("count")
+    local t0 = os.clock()
+    local calls, checksum = run()
+    local secs = os.clock() - t0
+    local kb1 = collectgarbage("count")
+    collectgarbage("restart")
+    collectgarbage("collect")
+    return {
+        calls = calls,
+        secs = secs,
+        rate = calls / math.max(secs, 1e-9),
+        gc = (kb1 - kb0) * 1024 / calls,
+        checksum = checksum,
+    }
+end
+
+local function report(name, impl, r)
+    print(string.format("%-13s %-9s %9d %8.3f %12.0f %9.1f %18.4f", name, impl, r.calls, r.secs, r.rate, r.gc,
+        r.checksum))
+end
+
+local impls = {native_adapter()}
+local baseline = baseline_adapter()
+if baseline then
+    impls[2] = baseline
+else
+    print("(pure-Lua bump.lua not found: pass --baseline=path/to/bump.lua for the comparison)")
+end
+
+if #scenarios_wanted == 0 then
+    scenarios_wanted = order
+end
+
+print(string.format("%-13s %-9s %9s %8s %12s %9s %18s", "scenario", "impl", "calls", "cpu(s)", "calls/s", "gcB/call",
+    "checksum"))
+for _, name in ipairs(scenarios_wanted) do
+    assert(scenarios[name], "unknown scenario " .. name)
+    local results = {}
+    for i, A in ipairs(impls) do
+        results[i] = measure(A, name)
+        report(name, A.name, results[i])
+    end
+    if results[2] then
+        local n, b = results[1], results[2]
+        print(string.format("%-13s %-9s %8.2fx faster, %.2fx the garbage%s", name, "native", n.rate / b.rate,
+            n.gc / math.max(b.gc, 1e-9),
+            math.abs(n.checksum - b.checksum) > 1e-6 * math.max(1, math.abs(b.checksum)) and
+                " (checksums differ!)" or ""))
+    end
+end
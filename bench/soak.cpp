@@ -0,0 +1,158 @@
+// Long-run soak benchmark: random-walks a population of items across an
+// open map, the whole herd drifting along x so that it keeps entering new
+// cells, and samples the number of live grid cells and the process RSS.
+// With empty cells reclaimed, both must stay flat instead of growing with
+// the area the items have ever visited: the live cells stay within twice
+// those of the first tick, and RSS within a quarter over its value once
+// warmed up.
+//
+//   ./soak [items] [ticks] [cellSize]
+
+#include "../2d/bump2d.hpp"
+#include "../3d/bump3d.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static unsigned int seed = 12345;
+
+static double frand(double lo, double hi)
+{
+    seed = seed * 1103515245 + 12345;
+    return lo + (hi - lo) * ((seed >> 8) & 0xffff) / 65535.0;
+}
+
+static long rssKb()
+{
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) {
+        return -1;
+    }
+    long pages = 0, resident = 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+        resident = -1;
+    }
+    fclose(f);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+#define DRIFT 8
+#define JITTER 4
+
+struct SoakStats {
+    int firstCells, maxCells;
+    long warmRss, lastRss;
+
+    SoakStats() : firstCells(0), maxCells(0), warmRss(-1), lastRss(-1) {}
+
+    void sample(int tick, int ticks, int cells)
+    {
+        if (tick == 0) {
+            firstCells = cells;
+        }
+        if (cells > maxCells) {
+            maxCells = cells;
+        }
+        if (tick == ticks / 10) {
+            warmRss = rssKb();
+        }
+        lastRss = rssKb();
+    }
+
+    //-- 0 when both stayed flat; RSS is not checked where /proc is missing
+    int check(const char *dim)
+    {
+        bool cellsOk = maxCells <= 2 * firstCells;
+        bool rssOk   = warmRss < 0 || lastRss < 0 || lastRss <= warmRss * 5 / 4;
+        printf("%s,summary,first_cells=%d,max_cells=%d,warm_rss_kb=%ld,"
+               "last_rss_kb=%ld\n",
+               dim, firstCells, maxCells, warmRss, lastRss);
+        if (!cellsOk) {
+            fprintf(stderr, "soak %s: live cells grew past twice the first "
+                            "tick's\n",
+                    dim);
+        }
+        if (!rssOk) {
+            fprintf(stderr, "soak %s: RSS grew by more than a quarter after "
+                            "warm-up\n",
+                    dim);
+        }
+        return cellsOk && rssOk ? 0 : 1;
+    }
+};
+
+static int soak2d(int items, int ticks, int cellSize)
+{
+    bump2d::World world;
+    world.initialize(cellSize);
+
+    std::vector<int> ids;
+    for (int i = 0; i < items; i++) {
+        int id = world.allocateId();
+        world.add(id, frand(-1000, 1000), frand(-1000, 1000), 8, 8);
+        ids.push_back(id);
+    }
+
+    SoakStats stats;
+    printf("dim,tick,items,cells,rss_kb\n");
+    for (int tick = 0; tick <= ticks; tick++) {
+        for (size_t i = 0; i < ids.size(); i++) {
+            double x, y, w, h;
+            world.getRect(ids[i], x, y, w, h);
+            world.update(ids[i], x + DRIFT + frand(-JITTER, JITTER),
+                         y + frand(-JITTER, JITTER), w, h);
+        }
+        int cells = world.countCells();
+        stats.sample(tick, ticks, cells);
+        if (tick % (ticks / 10 > 0 ? ticks / 10 : 1) == 0) {
+            printf("2d,%d,%d,%d,%ld\n", tick, world.countItems(), cells,
+                   rssKb());
+        }
+    }
+    world.release();
+    return stats.check("2d");
+}
+
+static int soak3d(int items, int ticks, int cellSize)
+{
+    bump3d::World world(cellSize);
+
+    std::vector<int> ids;
+    for (int i = 0; i < items; i++) {
+        int id = world.allocateId();
+        world.add(id, frand(-1000, 1000), frand(-1000, 1000),
+                  frand(-1000, 1000), 8, 8, 8);
+        ids.push_back(id);
+    }
+
+    SoakStats stats;
+    for (int tick = 0; tick <= ticks; tick++) {
+        for (size_t i = 0; i < ids.size(); i++) {
+            double x, y, z, w, h, d;
+            world.getCube(ids[i], x, y, z, w, h, d);
+            world.update(ids[i], x + DRIFT + frand(-JITTER, JITTER),
+                         y + frand(-JITTER, JITTER), z + frand(-JITTER, JITTER),
+                         w, h, d);
+        }
+        int cells = world.countCells();
+        stats.sample(tick, ticks, cells);
+        if (tick % (ticks / 10 > 0 ? ticks / 10 : 1) == 0) {
+            printf("3d,%d,%d,%d,%ld\n", tick, world.countItems(), cells,
+                   rssKb());
+        }
+    }
+
+    return stats.check("3d");
+}
+
+int main(int argc, char **argv)
+{
+    int items    = argc > 1 ? atoi(argv[1]) : 2000;
+    int ticks    = argc > 2 ? atoi(argv[2]) : 5000;
+    int cellSize = argc > 3 ? atoi(argv[3]) : 64;
+
+    int failed = soak2d(items, ticks, cellSize);
+    failed |= soak3d(items, ticks, cellSize);
+    return failed;
+}
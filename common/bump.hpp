@@ -0,0 +1,3350 @@
+#pragma once
+
+#include <algorithm>
+#include <limits.h>
+#include <map>
+#include <math.h>
+#include <set>
+#include <vector>
+
+//-- Dimension-generic core shared by bump2d and bump3d.
+//--
+//-- World<N> keeps axis-aligned boxes of N axes in a uniform grid. Every
+//-- per-axis loop runs over the compile-time constant N and is marked with
+//-- BUMP_UNROLL, so World<2> and World<3> compile to straight-line code just
+//-- like the hand-written 2D and 3D versions did. 2d/bump2d.hpp and
+//-- 3d/bump3d.hpp wrap it with their rect_* / cube_* helpers and the
+//-- scalar-argument World methods the Lua bindings use.
+
+namespace bump
+{
+#define UNUSED(x) (void)(x)
+#define MATH_HUGE HUGE_VAL
+
+#define Touch  1
+#define Cross  2
+#define Slide  3
+#define Bounce 4
+
+#define DELTA   1e-10 // -- floating-point margin of error
+#define iabs(a) (((a) >= 0) ? (a) : -(a))
+
+#if defined(__clang__)
+# define BUMP_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__) && (__GNUC__ >= 8)
+# define BUMP_UNROLL _Pragma("GCC unroll 4")
+#else
+# define BUMP_UNROLL
+#endif
+
+//-- Hot-path operation counters. Build with -DBUMP_COUNTERS to enable them;
+//-- otherwise BUMP_COUNT expands to nothing and World carries no counters.
+#ifdef BUMP_COUNTERS
+# define BUMP_COUNT(world, name, n) ((world)->counters.name += (n))
+#else
+# define BUMP_COUNT(world, name, n) ((void)0)
+#endif
+
+//-- Precision the item boxes are stored in. Build with -DBUMP_FLOAT32 to keep
+//-- them as float, which halves their memory; time of impact, distances and
+//-- every other collision computation still run in double.
+#ifdef BUMP_FLOAT32
+typedef float Storage;
+#else
+typedef double Storage;
+#endif
+
+static inline double sign(double x)
+{
+    return (x > 0) ? 1 : ((x == 0) ? 0 : -1);
+}
+
+static inline double nearest(double x, double a, double b)
+{
+    return fabs(a - x) < fabs(b - x) ? a : b;
+}
+
+/*------------------------------------------
+-- Box functions
+------------------------------------------*/
+
+template <int N, class T = double> struct Box {
+    T pos[N];
+    T size[N];
+};
+
+//-- widens a stored box to the precision the collision math runs in
+template <int N, class T>
+static inline void box_load(const Box<N, T> &s, Box<N> &b)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        b.pos[a]  = s.pos[a];
+        b.size[a] = s.size[a];
+    }
+}
+
+template <int N, class T>
+static inline void box_store(const double *pos, const double *size,
+                             Box<N, T> &s)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        s.pos[a]  = pos[a];
+        s.size[a] = size[a];
+    }
+}
+
+template <int N>
+static inline void box_getNearestCorner(const double *pos, const double *size,
+                                        const double *p, double *n)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        n[a] = nearest(p[a], pos[a], pos[a] + size[a]);
+    }
+}
+
+//-- one Liang-Barsky clip step; side is the index (2 * axis + max side) of the
+//-- side being clipped against
+static inline bool box_clipSide(double p, double q, int side, double &ti1,
+                                double &ti2, int &side1, int &side2)
+{
+    if (p == 0) {
+        return q > 0;
+    }
+    double r = q / p;
+    if (p < 0) {
+        if (r > ti2) {
+            return false;
+        }
+        if (r > ti1) {
+            ti1   = r;
+            side1 = side;
+        }
+    } else { //-- p > 0
+        if (r < ti1) {
+            return false;
+        }
+        if (r < ti2) {
+            ti2   = r;
+            side2 = side;
+        }
+    }
+    return true;
+}
+
+/*-- This is a generalized implementation of the liang-barsky algorithm, which
+ also returns
+ -- the normals of the sides where the segment intersects.
+ -- Returns false if the segment never touches the box
+ -- Notice that normals are only guaranteed to be accurate when initially ti1,
+ ti2 == -math.huge, math.huge
+ */
+template <int N>
+static inline bool box_getSegmentIntersectionIndices(
+    const double *pos, const double *size, const double *p1, const double *p2,
+    double &ti1, double &ti2, double *n1, double *n2)
+{
+    int side1 = -1, side2 = -1;
+
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        double d = p2[a] - p1[a];
+        //-- left / top / front, then right / bottom / back
+        if (!box_clipSide(-d, p1[a] - pos[a], 2 * a, ti1, ti2, side1, side2) ||
+            !box_clipSide(d, pos[a] + size[a] - p1[a], 2 * a + 1, ti1, ti2,
+                          side1, side2)) {
+            return false;
+        }
+    }
+
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        n1[a] = (side1 >> 1) == a ? ((side1 & 1) ? 1 : -1) : 0;
+        n2[a] = (side2 >> 1) == a ? ((side2 & 1) ? 1 : -1) : 0;
+    }
+    return true;
+}
+
+//-- Calculates the minkowsky difference between 2 boxes, which is another box
+template <int N>
+static inline void box_getDiff(const Box<N> &b1, const Box<N> &b2, Box<N> &r)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        r.pos[a]  = b2.pos[a] - b1.pos[a] - b1.size[a];
+        r.size[a] = b1.size[a] + b2.size[a];
+    }
+}
+
+template <int N>
+static inline bool box_containsPoint(const double *pos, const double *size,
+                                     const double *p)
+{
+    bool inside = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        inside = inside && ((p[a] - pos[a]) > DELTA) &&
+                 ((pos[a] + size[a] - p[a]) > DELTA);
+    }
+    return inside;
+}
+
+template <int N>
+static inline bool box_isIntersecting(const double *pos1, const double *size1,
+                                      const double *pos2, const double *size2)
+{
+    bool intersecting = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        intersecting = intersecting && (pos1[a] < pos2[a] + size2[a]) &&
+                       (pos2[a] < pos1[a] + size1[a]);
+    }
+    return intersecting;
+}
+
+template <int N>
+static inline double box_getSquareDistance(const Box<N> &b1, const Box<N> &b2)
+{
+    double dist = 0;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        double d = b1.pos[a] - b2.pos[a] + (b1.size[a] - b2.size[a]) / 2;
+        dist += d * d;
+    }
+    return dist;
+}
+
+template <int N> struct Collision {
+    bool overlaps;
+    int item;
+    int other;
+    int type;
+    double ti;
+    double distance; //-- square distance between the boxes, ties on ti
+    double move[N];
+    double normal[N];
+    double touch[N];
+    double response[N]; //-- slide or bounce target
+    Box<N> itemBox;
+    Box<N> otherBox;
+};
+
+template <int N>
+static bool box_detectCollision(const Box<N> &b1, const Box<N> &b2,
+                                const double *goal, Collision<N> &col)
+{
+    double d[N], zero[N];
+    bool moving = false;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        d[a]    = goal[a] - b1.pos[a];
+        zero[a] = 0;
+        moving  = moving || (d[a] != 0);
+    }
+
+    Box<N> m;
+    box_getDiff<N>(b1, b2, m);
+
+    bool overlaps = false;
+    double ti;
+    double n[N], t[N];
+
+    if (box_containsPoint<N>(m.pos, m.size, zero)) {
+        //-- item was intersecting other
+        double p[N];
+        box_getNearestCorner<N>(m.pos, m.size, zero, p);
+        double overlap = 1;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            overlap *= (b1.size[a] < fabs(p[a])) ? b1.size[a] : fabs(p[a]);
+        }
+        ti       = -overlap; //-- ti is the negative area/volume of intersection
+        overlaps = true;
+    } else {
+        double ti1 = -MATH_HUGE, ti2 = MATH_HUGE;
+        double n1[N], n2[N];
+        if (!box_getSegmentIntersectionIndices<N>(m.pos, m.size, zero, d, ti1,
+                                                  ti2, n1, n2)) {
+            return false;
+        }
+        //-- item tunnels into other
+        if (!((ti1 < 1) &&
+              (fabs(ti1 - ti2) >= DELTA) //-- special case for rect going
+                                         // through another rect's corner
+              && ((0 < (ti1 + DELTA)) || ((0 == ti1) && (ti2 > 0))))) {
+            return false;
+        }
+        ti = ti1;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            n[a] = n1[a];
+        }
+    }
+
+    if (overlaps) {
+        if (!moving) {
+            //-- intersecting and not moving - use minimum displacement vector,
+            //-- along the last of the axes with the smallest displacement
+            double p[N];
+            box_getNearestCorner<N>(m.pos, m.size, zero, p);
+            int k = 0;
+            BUMP_UNROLL
+            for (int a = 1; a < N; a++) {
+                if (fabs(p[a]) <= fabs(p[k])) {
+                    k = a;
+                }
+            }
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                n[a] = (a == k) ? sign(p[a]) : 0;
+                t[a] = b1.pos[a] + ((a == k) ? p[a] : 0);
+            }
+        } else {
+            //-- intersecting and moving - move in the opposite direction
+            double ti1 = -MATH_HUGE, ti2 = 1;
+            double n2[N];
+            if (!box_getSegmentIntersectionIndices<N>(m.pos, m.size, zero, d,
+                                                      ti1, ti2, n, n2)) {
+                return false;
+            }
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                t[a] = b1.pos[a] + d[a] * ti1;
+            }
+        }
+    } else { //-- tunnel
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            t[a] = b1.pos[a] + d[a] * ti;
+        }
+    }
+
+    col.overlaps = overlaps;
+    col.ti       = ti;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        col.move[a]   = d[a];
+        col.normal[a] = n[a];
+        col.touch[a]  = t[a];
+    }
+    col.itemBox  = b1;
+    col.otherBox = b2;
+    col.distance = box_getSquareDistance<N>(b1, b2);
+    return true;
+}
+
+//-- Collisions are resolved by time of impact, then by distance
+template <int N>
+static inline bool collision_before(const Collision<N> &a,
+                                    const Collision<N> &b)
+{
+    if (a.ti == b.ti) {
+        return a.distance < b.distance;
+    }
+    return a.ti < b.ti;
+}
+
+//-- Sinks for the narrow phase: CollisionList keeps every collision found,
+//-- FirstCollision only the one a response resolves first, in one pass and
+//-- without a sort. Of equal collisions the earlier one found is kept.
+template <class C> struct CollisionList {
+    std::vector<C> &collisions;
+
+    explicit CollisionList(std::vector<C> &cols) : collisions(cols) {}
+
+    void operator()(const C &col)
+    {
+        collisions.push_back(col);
+    }
+};
+
+template <class C> struct FirstCollision {
+    C col;
+    bool found;
+
+    FirstCollision() : found(false) {}
+
+    void operator()(const C &c)
+    {
+        if (!found || collision_before(c, col)) {
+            col   = c;
+            found = true;
+        }
+    }
+};
+
+//-- Sorts collisions the way FirstCollision picks them, moving small keys
+//-- around instead of whole collisions
+struct CollisionKey {
+    double ti;
+    double distance;
+    int index;
+};
+
+static inline bool sortByKey(const CollisionKey &a, const CollisionKey &b)
+{
+    if (a.ti != b.ti) {
+        return a.ti < b.ti;
+    }
+    if (a.distance != b.distance) {
+        return a.distance < b.distance;
+    }
+    return a.index < b.index;
+}
+
+template <int N> static void collision_sort(std::vector<Collision<N> > &cols)
+{
+    if (cols.size() < 2) {
+        return;
+    }
+    std::vector<CollisionKey> keys(cols.size());
+    for (size_t i = 0; i < cols.size(); i++) {
+        keys[i].ti       = cols[i].ti;
+        keys[i].distance = cols[i].distance;
+        keys[i].index    = i;
+    }
+    std::sort(keys.begin(), keys.end(), sortByKey);
+
+    std::vector<Collision<N> > sorted;
+    sorted.reserve(cols.size());
+    for (std::vector<CollisionKey>::iterator it = keys.begin();
+         it != keys.end(); it++) {
+        sorted.push_back(cols[it->index]);
+    }
+    cols.swap(sorted);
+}
+
+/*------------------------------------------
+-- Grid functions
+------------------------------------------*/
+
+//-- The size of a cell along each axis, with its reciprocal so that
+//-- mapping a coordinate to a cell multiplies instead of dividing
+template <int N> struct CellSize {
+    double size[N];
+    double inv[N];
+
+    CellSize()
+    {
+        set(64);
+    }
+
+    void set(double s)
+    {
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            size[a] = s;
+            inv[a]  = 1 / s;
+        }
+    }
+
+    void set(const double *s)
+    {
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            size[a] = s[a];
+            inv[a]  = 1 / s[a];
+        }
+    }
+};
+
+//-- floor(x / size) and ceil(x / size) through the reciprocal. The product
+//-- can land one cell off near a border, so the result is checked against
+//-- the border itself; a coordinate on a border is in the cell after it.
+static inline double grid_floorDiv(double x, double size, double inv)
+{
+    double q = floor(x * inv);
+    if (q * size > x) {
+        q -= 1;
+    } else if ((q + 1) * size <= x) {
+        q += 1;
+    }
+    return q;
+}
+
+static inline double grid_ceilDiv(double x, double size, double inv)
+{
+    double q = ceil(x * inv);
+    if ((q - 1) * size >= x) {
+        q -= 1;
+    } else if (q * size < x) {
+        q += 1;
+    }
+    return q;
+}
+
+template <int N>
+static inline void grid_toWorld(const CellSize<N> &cs, const int *c, double *w)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        w[a] = (c[a] - 1) * cs.size[a];
+    }
+}
+
+template <int N>
+static inline void grid_toCell(const CellSize<N> &cs, const double *p, int *c)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        c[a] = grid_floorDiv(p[a], cs.size[a], cs.inv[a]) + 1;
+    }
+}
+
+/*-- grid_traverse* functions are based on "A Fast Voxel Traversal Algorithm for
+ Ray Tracing",
+ -- by John Amanides and Andrew Woo -
+ http://www.cse.yorku.ca/~amana/research/grid.pdf
+ -- It has been modified to include both cells when the ray "touches a grid
+ corner",
+ -- and with a different exit condition*/
+
+static inline int grid_traverse_initStep(double cellSize, int ct, double t1,
+                                         double t2, double &rx, double &ry)
+{
+    double v = t2 - t1;
+    if (v > 0) {
+        rx = cellSize / v;
+        ry = ((ct + v) * cellSize - t1) / v;
+        return 1;
+    }
+    if (v < 0) {
+        rx = -cellSize / v;
+        ry = ((ct + v - 1) * cellSize - t1) / v;
+        return -1;
+    }
+    rx = HUGE_VAL;
+    ry = HUGE_VAL;
+    return 0;
+}
+
+//-- returns false to stop the traversal there
+typedef bool (*cellFunc)(void *data, const int *c);
+
+template <int N>
+static void grid_traverse(const CellSize<N> &cs, const double *p1,
+                          const double *p2, cellFunc f, void *data)
+{
+    int c1[N], c2[N], c[N], step[N];
+    double delta[N], t[N];
+
+    grid_toCell<N>(cs, p1, c1);
+    grid_toCell<N>(cs, p2, c2);
+
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        step[a] = grid_traverse_initStep(cs.size[a], c1[a], p1[a], p2[a],
+                                         delta[a], t[a]);
+        c[a] = c1[a];
+    }
+
+    if (!f(data, c)) {
+        return;
+    }
+
+    //-- The default implementation had an infinite loop problem when
+    //-- approaching the last cell in some occassions. We finish iterating
+    //-- when we are *next* to the last cell
+    for (;;) {
+        int dist = 0;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            dist += iabs(c[a] - c2[a]);
+        }
+        if (dist <= 1) {
+            break;
+        }
+
+        //-- step along the axis whose boundary is nearest (the last one on
+        //-- ties)
+        int k = 0;
+        BUMP_UNROLL
+        for (int a = 1; a < N; a++) {
+            if (t[a] <= t[k]) {
+                k = a;
+            }
+        }
+        //-- Addition: include both cells when going through corners
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            if (a < k && t[a] == t[k]) {
+                c[a] += step[a];
+                if (!f(data, c)) {
+                    return;
+                }
+                c[a] -= step[a];
+            }
+        }
+        t[k] += delta[k];
+        c[k] += step[k];
+        if (!f(data, c)) {
+            return;
+        }
+    }
+
+    //-- If we have not arrived to the last cell, use it
+    bool arrived = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        arrived = arrived && (c[a] == c2[a]);
+    }
+    if (!arrived) {
+        f(data, c2);
+    }
+}
+
+template <int N>
+static inline void grid_toCellBox(const CellSize<N> &cs, const double *pos,
+                                  const double *size, int *c, int *len)
+{
+    grid_toCell<N>(cs, pos, c);
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        int c2 = grid_ceilDiv(pos[a] + size[a], cs.size[a], cs.inv[a]);
+        len[a] = c2 - c[a] + 1;
+    }
+}
+
+//-- steps the cell cursor c through the range [lo, lo + len) with axis 0
+//-- varying fastest; returns false once the whole range was visited
+template <int N>
+static inline bool grid_nextCell(int *c, const int *lo, const int *len)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        if (++c[a] < lo[a] + len[a]) {
+            return true;
+        }
+        c[a] = lo[a];
+    }
+    return false;
+}
+
+template <int N>
+static inline bool grid_isEmptyRange(const int *len)
+{
+    bool empty = false;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        empty = empty || (len[a] <= 0);
+    }
+    return empty;
+}
+
+/*------------------------------------------
+-- ColFilter
+------------------------------------------*/
+
+//-- The built-in filters answer the same response for every pair; they
+//-- carry it in kind so the move loop can read it without a virtual call.
+//-- Custom filters leave kind at 0 and are asked through Filter().
+struct ColFilter {
+    int kind;
+    ColFilter() : kind(0) {}
+    virtual int Filter(int item, int other) = 0;
+    virtual ~ColFilter(){};
+};
+
+static inline int filter_apply(ColFilter *filter, int item, int other)
+{
+    return filter->kind ? filter->kind : filter->Filter(item, other);
+}
+
+struct VisitedFilter : ColFilter {
+    std::set<int> visited;
+    ColFilter *filter;
+    int Filter(int item, int other)
+    {
+        if (visited.find(other) != visited.end()) {
+            return 0;
+        }
+        return filter_apply(filter, item, other);
+    }
+};
+
+struct SlideFilter : ColFilter {
+    SlideFilter()
+    {
+        kind = Slide;
+    }
+    int Filter(int item, int other)
+    {
+        UNUSED(item);
+        UNUSED(other);
+        return Slide;
+    };
+};
+
+struct TouchFilter : ColFilter {
+    TouchFilter()
+    {
+        kind = Touch;
+    }
+    int Filter(int item, int other)
+    {
+        UNUSED(item);
+        UNUSED(other);
+        return Touch;
+    };
+};
+
+struct CrossFilter : ColFilter {
+    CrossFilter()
+    {
+        kind = Cross;
+    }
+    int Filter(int item, int other)
+    {
+        UNUSED(item);
+        UNUSED(other);
+        return Cross;
+    };
+};
+
+struct BounceFilter : ColFilter {
+    BounceFilter()
+    {
+        kind = Bounce;
+    }
+    int Filter(int item, int other)
+    {
+        UNUSED(item);
+        UNUSED(other);
+        return Bounce;
+    };
+};
+
+struct ItemFilter {
+    virtual bool Filter(int item) = 0;
+    virtual ~ItemFilter(){};
+};
+
+//-- keeps every item but the excluded ones
+struct ExcludeFilter : ItemFilter {
+    std::set<int> excluded;
+    bool Filter(int item)
+    {
+        return excluded.find(item) == excluded.end();
+    }
+};
+
+/*------------------------------------------
+-- Responses
+------------------------------------------*/
+
+template <int N, class T = Storage> struct World;
+
+//-- goal holds the goal on entry and the actual position on return.
+//-- As with filters, kind names the built-in response a subclass computes,
+//-- which projectMove() then runs inline; custom responses leave it at 0.
+template <int N, class T = Storage> struct Response {
+    int kind;
+    Response() : kind(0) {}
+    virtual void ComputeResponse(World<N, T> *world, Collision<N> &col,
+                                 const Box<N> &box, double *goal,
+                                 ColFilter *filter,
+                                 std::vector<Collision<N> > &cols) = 0;
+    virtual ~Response(){};
+};
+
+template <int N, class T = Storage> struct TouchResponse : Response<N, T> {
+    TouchResponse()
+    {
+        this->kind = Touch;
+    }
+    void ComputeResponse(World<N, T> *world, Collision<N> &col,
+                         const Box<N> &box, double *goal, ColFilter *filter,
+                         std::vector<Collision<N> > &cols);
+};
+
+template <int N, class T = Storage> struct CrossResponse : Response<N, T> {
+    CrossResponse()
+    {
+        this->kind = Cross;
+    }
+    void ComputeResponse(World<N, T> *world, Collision<N> &col,
+                         const Box<N> &box, double *goal, ColFilter *filter,
+                         std::vector<Collision<N> > &cols);
+};
+
+template <int N, class T = Storage> struct SlideResponse : Response<N, T> {
+    SlideResponse()
+    {
+        this->kind = Slide;
+    }
+    void ComputeResponse(World<N, T> *world, Collision<N> &col,
+                         const Box<N> &box, double *goal, ColFilter *filter,
+                         std::vector<Collision<N> > &cols);
+};
+
+template <int N, class T = Storage> struct BounceResponse : Response<N, T> {
+    BounceResponse()
+    {
+        this->kind = Bounce;
+    }
+    void ComputeResponse(World<N, T> *world, Collision<N> &col,
+                         const Box<N> &box, double *goal, ColFilter *filter,
+                         std::vector<Collision<N> > &cols);
+};
+
+//-- The goal updates of the built-in responses. Touch stops at the touch
+//-- point; slide and bounce go on from it, cross from where it started.
+template <int N, class C, class V>
+static inline void response_touch(const C &col, V *goal)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        goal[a] = col.touch[a];
+    }
+}
+
+//-- keep the goal on every axis the normal does not block
+template <int N, class C, class V>
+static inline void response_slide(C &col, V *goal)
+{
+    bool moving = false;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        moving = moving || (col.move[a] != 0);
+    }
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        col.response[a] =
+            (moving && col.normal[a] == 0) ? goal[a] : col.touch[a];
+        goal[a] = col.response[a];
+    }
+}
+
+//-- mirror the remaining movement on every axis the normal blocks
+template <int N, class C, class V>
+static inline void response_bounce(C &col, V *goal)
+{
+    bool moving = false;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        moving = moving || (col.move[a] != 0);
+    }
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        V bn = moving ? goal[a] - col.touch[a] : 0;
+        if (col.normal[a] != 0) {
+            bn = -bn;
+        }
+        col.response[a] = col.touch[a] + bn;
+        goal[a]         = col.response[a];
+    }
+}
+
+/*------------------------------------------
+-- World
+------------------------------------------*/
+
+#define BOX_PAGE 256 // -- boxes per page of a BoxStore
+
+//-- The item boxes, indexed by id. Ids come from allocateId() in ascending
+//-- runs, so they are kept in pages of BOX_PAGE consecutive ids, found with
+//-- two array reads instead of a tree search. A page is freed with its last
+//-- box, so ids that have all gone cost one NULL pointer per page.
+template <int N, class T> struct BoxStore {
+    struct Page {
+        Box<N, T> boxes[BOX_PAGE];
+        bool used[BOX_PAGE];
+        int count;
+    };
+
+    std::vector<Page *> pages;
+    size_t total;
+
+    BoxStore() : total(0) {}
+
+    ~BoxStore()
+    {
+        clear();
+    }
+
+    //-- NULL when id has no box
+    Box<N, T> *find(int id)
+    {
+        size_t p = (unsigned)id / BOX_PAGE;
+        if (p >= pages.size() || pages[p] == NULL) {
+            return NULL;
+        }
+        Page *page = pages[p];
+        int i      = (unsigned)id % BOX_PAGE;
+        return page->used[i] ? &page->boxes[i] : NULL;
+    }
+
+    //-- the box of id, or an empty one when id has none
+    const Box<N, T> &get(int id)
+    {
+        static const Box<N, T> none = Box<N, T>();
+        const Box<N, T> *b          = find(id);
+        return b ? *b : none;
+    }
+
+    //-- the box of id, added empty when id has none, like std::map
+    Box<N, T> &operator[](int id)
+    {
+        size_t p = (unsigned)id / BOX_PAGE;
+        if (p >= pages.size()) {
+            pages.resize(p + 1, NULL);
+        }
+        Page *page = pages[p];
+        if (page == NULL) {
+            page = pages[p] = new Page();
+        }
+        int i = (unsigned)id % BOX_PAGE;
+        if (!page->used[i]) {
+            page->used[i]  = true;
+            page->boxes[i] = Box<N, T>();
+            page->count++;
+            total++;
+        }
+        return page->boxes[i];
+    }
+
+    bool erase(int id)
+    {
+        if (find(id) == NULL) {
+            return false;
+        }
+        Page *&page = pages[(unsigned)id / BOX_PAGE];
+        total--;
+        page->used[(unsigned)id % BOX_PAGE] = false;
+        if (--page->count == 0) {
+            delete page;
+            page = NULL;
+        }
+        return true;
+    }
+
+    //-- whether none of the count ids from start has a box
+    bool vacant(int start, int count)
+    {
+        for (size_t k = start; k < (size_t)start + count; k++) {
+            if (k / BOX_PAGE >= pages.size()) {
+                return true;
+            }
+            if (find((int)k)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //-- the smallest id with a box after id, 0 when there is none:
+    //-- for (int id = boxes.next(0); id; id = boxes.next(id))
+    int next(int id)
+    {
+        for (size_t k = (size_t)id + 1; k / BOX_PAGE < pages.size(); k++) {
+            Page *page = pages[k / BOX_PAGE];
+            if (page == NULL) {
+                k |= BOX_PAGE - 1; //-- on to the next page
+            } else if (page->used[k % BOX_PAGE]) {
+                return (int)k;
+            }
+        }
+        return 0;
+    }
+
+    size_t size()
+    {
+        return total;
+    }
+
+    void clear()
+    {
+        for (size_t p = 0; p < pages.size(); p++) {
+            delete pages[p];
+        }
+        pages.clear();
+        total = 0;
+    }
+
+private:
+    BoxStore(const BoxStore &);
+    BoxStore &operator=(const BoxStore &);
+};
+
+//-- The item ids of a cell, kept sorted in a vector: cells hold a handful
+//-- of items, so a search and a short memmove beat a tree node per item.
+struct Cell {
+    std::vector<int> items;
+
+    bool insert(int item)
+    {
+        if (items.empty() || items.back() < item) {
+            items.push_back(item);
+            return true;
+        }
+        std::vector<int>::iterator it =
+            std::lower_bound(items.begin(), items.end(), item);
+        if (*it == item) {
+            return false;
+        }
+        items.insert(it, item);
+        return true;
+    }
+
+    bool erase(int item)
+    {
+        std::vector<int>::iterator it =
+            std::lower_bound(items.begin(), items.end(), item);
+        if (it == items.end() || *it != item) {
+            return false;
+        }
+        items.erase(it);
+        return true;
+    }
+};
+
+//-- One item's membership in one cell. Batches of these are sorted into
+//-- the grid's iteration order (last axis first) so each cell is looked up
+//-- once per batch and its item set is filled in ascending order.
+template <int N> struct CellEntry {
+    int c[N];
+    int item;
+};
+
+//-- Cells live in one nested std::map per axis, the outermost keyed by the
+//-- last axis (rows[cy][cx] in 2D, cells[cz][cy][cx] in 3D). CellGrid<D>
+//-- handles the map of axis D - 1 and recurses into the inner axes.
+template <int D> struct CellGrid {
+    typedef std::map<int, typename CellGrid<D - 1>::Map> Map;
+
+    static Cell &get(Map &m, const int *c)
+    {
+        return CellGrid<D - 1>::get(m[c[D - 1]], c);
+    }
+
+    static Cell *find(Map &m, const int *c)
+    {
+        typename Map::iterator it = m.find(c[D - 1]);
+        if (it == m.end()) {
+            return NULL;
+        }
+        return CellGrid<D - 1>::find(it->second, c);
+    }
+
+    //-- get() for cells fed in iteration order: appends at the end of each
+    //-- map instead of searching it
+    static Cell &append(Map &m, const int *c)
+    {
+        typename Map::iterator it = m.end();
+        if (m.empty() || (--it)->first != c[D - 1]) {
+            typename CellGrid<D - 1>::Map inner;
+            it = m.insert(m.end(), typename Map::value_type(c[D - 1], inner));
+        }
+        return CellGrid<D - 1>::append(it->second, c);
+    }
+
+    //-- Adds a batch of n memberships sorted by grid_sortEntries. The batch
+    //-- is merged into the map: each key goes in with the node after the
+    //-- previous one as hint, so a key next to the previous one costs no
+    //-- search, and the inner maps get the batch's entries under that key.
+    template <int N>
+    static void insertSorted(Map &m, const CellEntry<N> *e, size_t n)
+    {
+        typename Map::iterator hint = m.begin();
+        size_t i                    = 0;
+        while (i < n) {
+            int k    = e[i].c[D - 1];
+            size_t j = i + 1;
+            while (j < n && e[j].c[D - 1] == k) {
+                j++;
+            }
+            typename Map::iterator it = m.insert(
+                hint,
+                typename Map::value_type(k, typename CellGrid<D - 1>::Map()));
+            CellGrid<D - 1>::insertSorted(it->second, e + i, j - i);
+            hint = ++it;
+            i    = j;
+        }
+    }
+
+    //-- Drops a sorted batch of memberships, one search per key and level,
+    //-- and the maps that become empty
+    template <int N>
+    static void removeSorted(Map &m, const CellEntry<N> *e, size_t n)
+    {
+        size_t i = 0;
+        while (i < n) {
+            int k    = e[i].c[D - 1];
+            size_t j = i + 1;
+            while (j < n && e[j].c[D - 1] == k) {
+                j++;
+            }
+            typename Map::iterator it = m.find(k);
+            if (it != m.end()) {
+                CellGrid<D - 1>::removeSorted(it->second, e + i, j - i);
+                if (it->second.empty()) {
+                    m.erase(it);
+                }
+            }
+            i = j;
+        }
+    }
+
+    //-- calls v(c, cell) for every cell, in iteration order
+    template <class V> static void visit(Map &m, int *c, V &v)
+    {
+        for (typename Map::iterator it = m.begin(); it != m.end(); it++) {
+            c[D - 1] = it->first;
+            CellGrid<D - 1>::visit(it->second, c, v);
+        }
+    }
+
+    //-- drops the maps that become empty on the way back out
+    static bool remove(Map &m, const int *c, int item)
+    {
+        typename Map::iterator it = m.find(c[D - 1]);
+        if (it == m.end()) {
+            return false;
+        }
+        bool removed = CellGrid<D - 1>::remove(it->second, c, item);
+        if (it->second.empty()) {
+            m.erase(it);
+        }
+        return removed;
+    }
+
+    template <class W>
+    static void collect(W *world, Map &m, const int *c, const int *len,
+                        std::set<int> &items)
+    {
+        for (int i = c[D - 1]; i < c[D - 1] + len[D - 1]; i++) {
+            typename Map::iterator it = m.find(i);
+            if (it != m.end()) {
+                CellGrid<D - 1>::collect(world, it->second, c, len, items);
+            }
+        }
+    }
+
+    static int count(Map &m)
+    {
+        int n = 0;
+        for (typename Map::iterator it = m.begin(); it != m.end(); it++) {
+            n += CellGrid<D - 1>::count(it->second);
+        }
+        return n;
+    }
+};
+
+template <> struct CellGrid<1> {
+    typedef std::map<int, Cell> Map;
+
+    static Cell &get(Map &m, const int *c)
+    {
+        return m[c[0]];
+    }
+
+    static Cell *find(Map &m, const int *c)
+    {
+        Map::iterator it = m.find(c[0]);
+        return (it == m.end()) ? NULL : &it->second;
+    }
+
+    static Cell &append(Map &m, const int *c)
+    {
+        Map::iterator it = m.end();
+        if (m.empty() || (--it)->first != c[0]) {
+            it = m.insert(m.end(), Map::value_type(c[0], Cell()));
+        }
+        return it->second;
+    }
+
+    template <int N>
+    static void insertSorted(Map &m, const CellEntry<N> *e, size_t n)
+    {
+        Map::iterator hint = m.begin();
+        size_t i           = 0;
+        while (i < n) {
+            size_t j = i + 1;
+            while (j < n && e[j].c[0] == e[i].c[0]) {
+                j++;
+            }
+            Map::iterator it =
+                m.insert(hint, Map::value_type(e[i].c[0], Cell()));
+            Cell &cell = it->second;
+            if (cell.items.empty()) {
+                cell.items.reserve(j - i);
+            }
+            for (; i < j; i++) {
+                cell.insert(e[i].item);
+            }
+            hint = ++it;
+        }
+    }
+
+    template <int N>
+    static void removeSorted(Map &m, const CellEntry<N> *e, size_t n)
+    {
+        size_t i = 0;
+        while (i < n) {
+            size_t j = i + 1;
+            while (j < n && e[j].c[0] == e[i].c[0]) {
+                j++;
+            }
+            Map::iterator cell = m.find(e[i].c[0]);
+            if (cell != m.end()) {
+                for (; i < j; i++) {
+                    cell->second.erase(e[i].item);
+                }
+                if (cell->second.items.empty()) {
+                    m.erase(cell);
+                }
+            }
+            i = j;
+        }
+    }
+
+    template <class V> static void visit(Map &m, int *c, V &v)
+    {
+        for (Map::iterator it = m.begin(); it != m.end(); it++) {
+            c[0] = it->first;
+            v(c, it->second);
+        }
+    }
+
+    static bool remove(Map &m, const int *c, int item)
+    {
+        Map::iterator cell = m.find(c[0]);
+        if (cell == m.end()) {
+            return false;
+        }
+        if (!cell->second.erase(item)) {
+            return false;
+        }
+        //-- reclaim the cell as soon as it becomes empty, so
+        //-- visited-but-abandoned cells do not accumulate forever
+        if (cell->second.items.empty()) {
+            m.erase(cell);
+        }
+        return true;
+    }
+
+    template <class W>
+    static void collect(W *world, Map &m, const int *c, const int *len,
+                        std::set<int> &items)
+    {
+        UNUSED(world);
+        for (int i = c[0]; i < c[0] + len[0]; i++) {
+            Map::iterator cell = m.find(i);
+            if (cell == m.end()) {
+                continue;
+            }
+            BUMP_COUNT(world, cellsVisited, 1);
+            BUMP_COUNT(world, candidates, cell->second.items.size());
+            for (std::vector<int>::iterator it = cell->second.items.begin();
+                 it != cell->second.items.end(); it++) {
+                if (!items.insert(*it).second) {
+                    BUMP_COUNT(world, dedupeHits, 1);
+                }
+            }
+        }
+    }
+
+    static int count(Map &m)
+    {
+        return m.size();
+    }
+};
+
+template <int N> struct SortByCell {
+    bool operator()(const CellEntry<N> &a, const CellEntry<N> &b) const
+    {
+        for (int k = N - 1; k >= 0; k--) {
+            if (a.c[k] != b.c[k]) {
+                return a.c[k] < b.c[k];
+            }
+        }
+        return a.item < b.item;
+    }
+};
+
+//-- The cells of a world. They all live in the nested maps unless bound()
+//-- gave the store a cell range: the cells inside it are then kept in one
+//-- flat array, axis 0 fastest, and found without any search, while the
+//-- maps only hold the overflow outside it. Either way the same items end
+//-- up in the same cells.
+template <int N> struct CellStore {
+    typedef CellGrid<N> Grid;
+
+    typename Grid::Map overflow;
+    std::vector<Cell> dense;
+    int lo[N];
+    int len[N]; //-- all 0 when unbounded
+    int live;   //-- cells of dense with items, so count() never scans it
+
+    CellStore() : live(0)
+    {
+        std::fill(lo, lo + N, 0);
+        std::fill(len, len + N, 0);
+    }
+
+    //-- moves no items around; call it on an empty store
+    void bound(const int *l, const int *n)
+    {
+        size_t total = 1;
+        for (int a = 0; a < N; a++) {
+            lo[a]  = l[a];
+            len[a] = n[a];
+            total *= n[a];
+        }
+        dense.assign(total, Cell());
+        live = 0;
+    }
+
+    //-- the array slot of c, or NULL when c is outside the bounds
+    Cell *slot(const int *c)
+    {
+        size_t i = 0, stride = 1;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            unsigned d = (unsigned)(c[a] - lo[a]);
+            if (d >= (unsigned)len[a]) {
+                return NULL;
+            }
+            i += d * stride;
+            stride *= len[a];
+        }
+        return &dense[i];
+    }
+
+    //-- like the maps, counts the cell as live from here: every caller
+    //-- inserts into it right away
+    Cell &get(const int *c)
+    {
+        Cell *cell = slot(c);
+        if (cell == NULL) {
+            return Grid::get(overflow, c);
+        }
+        live += cell->items.empty();
+        return *cell;
+    }
+
+    //-- NULL for a cell without items
+    Cell *find(const int *c)
+    {
+        Cell *cell = slot(c);
+        if (cell) {
+            return cell->items.empty() ? NULL : cell;
+        }
+        return Grid::find(overflow, c);
+    }
+
+    //-- Adds and drops batches sorted by grid_sortEntries: slots of the
+    //-- array directly, the rest merged into the maps, see Grid
+    void insertSorted(const std::vector<CellEntry<N> > &entries)
+    {
+        if (dense.empty()) {
+            Grid::insertSorted(overflow, entries.data(), entries.size());
+            return;
+        }
+        std::vector<CellEntry<N> > rest;
+        for (size_t i = 0; i < entries.size(); i++) {
+            Cell *cell = slot(entries[i].c);
+            if (cell == NULL) {
+                rest.push_back(entries[i]);
+                continue;
+            }
+            live += cell->items.empty();
+            cell->insert(entries[i].item);
+        }
+        Grid::insertSorted(overflow, rest.data(), rest.size());
+    }
+
+    void removeSorted(const std::vector<CellEntry<N> > &entries)
+    {
+        if (dense.empty()) {
+            Grid::removeSorted(overflow, entries.data(), entries.size());
+            return;
+        }
+        std::vector<CellEntry<N> > rest;
+        for (size_t i = 0; i < entries.size(); i++) {
+            Cell *cell = slot(entries[i].c);
+            if (cell == NULL) {
+                rest.push_back(entries[i]);
+            } else if (cell->erase(entries[i].item)) {
+                live -= cell->items.empty();
+            }
+        }
+        Grid::removeSorted(overflow, rest.data(), rest.size());
+    }
+
+    //-- get() for cells fed in iteration order
+    Cell &append(const int *c)
+    {
+        Cell *cell = slot(c);
+        if (cell == NULL) {
+            return Grid::append(overflow, c);
+        }
+        live += cell->items.empty();
+        return *cell;
+    }
+
+    bool remove(const int *c, int item)
+    {
+        Cell *cell = slot(c);
+        if (cell == NULL) {
+            return Grid::remove(overflow, c, item);
+        }
+        if (!cell->erase(item)) {
+            return false;
+        }
+        live -= cell->items.empty();
+        return true;
+    }
+
+    template <class W>
+    void collect(W *world, const int *c, const int *n, std::set<int> &items)
+    {
+        UNUSED(world);
+        int ilo[N], ilen[N];
+        bool inside = !dense.empty();
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            ilo[a]  = std::max(c[a], lo[a]);
+            ilen[a] = std::min(c[a] + n[a], lo[a] + len[a]) - ilo[a];
+            inside  = inside && (ilen[a] > 0);
+        }
+        if (inside) {
+            int k[N];
+            std::copy(ilo, ilo + N, k);
+            do {
+                Cell *cell = slot(k);
+                if (cell->items.empty()) {
+                    continue;
+                }
+                BUMP_COUNT(world, cellsVisited, 1);
+                BUMP_COUNT(world, candidates, cell->items.size());
+                for (std::vector<int>::iterator it = cell->items.begin();
+                     it != cell->items.end(); it++) {
+                    if (!items.insert(*it).second) {
+                        BUMP_COUNT(world, dedupeHits, 1);
+                    }
+                }
+            } while (grid_nextCell<N>(k, ilo, ilen));
+        }
+        //-- the overflow only holds cells outside the bounds
+        if (!overflow.empty()) {
+            Grid::collect(world, overflow, c, n, items);
+        }
+    }
+
+    int count()
+    {
+        return Grid::count(overflow) + live;
+    }
+
+    //-- calls v(c, cell) for every cell with items, in the maps' iteration
+    //-- order whether or not the cell is in the array
+    template <class V> void visit(int *c, V &v)
+    {
+        if (dense.empty()) {
+            Grid::visit(overflow, c, v);
+            return;
+        }
+        std::vector<CellEntry<N> > order;
+        std::vector<Cell *> refs;
+        CellRefs r(order, refs);
+        Grid::visit(overflow, c, r);
+        if (!grid_isEmptyRange<N>(len)) {
+            std::copy(lo, lo + N, c);
+            do {
+                Cell *cell = slot(c);
+                if (!cell->items.empty()) {
+                    r(c, *cell);
+                }
+            } while (grid_nextCell<N>(c, lo, len));
+        }
+        std::sort(order.begin(), order.end(), SortByCell<N>());
+        for (size_t i = 0; i < order.size(); i++) {
+            std::copy(order[i].c, order[i].c + N, c);
+            v(c, *refs[order[i].item]);
+        }
+    }
+
+    void clear()
+    {
+        overflow.clear();
+        dense.assign(dense.size(), Cell());
+        live = 0;
+    }
+
+  private:
+    struct CellRefs {
+        std::vector<CellEntry<N> > &order;
+        std::vector<Cell *> &refs;
+
+        CellRefs(std::vector<CellEntry<N> > &o, std::vector<Cell *> &r)
+            : order(o), refs(r)
+        {
+        }
+
+        void operator()(const int *c, Cell &cell)
+        {
+            CellEntry<N> e;
+            std::copy(c, c + N, e.c);
+            e.item = refs.size();
+            refs.push_back(&cell);
+            order.push_back(e);
+        }
+    };
+};
+
+template <int N>
+static inline bool grid_inRange(const int *c, const int *lo, const int *len)
+{
+    bool in = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        in = in && (c[a] >= lo[a]) && (c[a] < lo[a] + len[a]);
+    }
+    return in;
+}
+
+//-- whether the cell range lo2/len2 lies inside lo1/len1
+template <int N>
+static inline bool grid_containsRange(const int *lo1, const int *len1,
+                                      const int *lo2, const int *len2)
+{
+    bool in = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        in = in && (lo2[a] >= lo1[a]) &&
+             (lo2[a] + len2[a] <= lo1[a] + len1[a]);
+    }
+    return in;
+}
+
+template <int N>
+static inline bool grid_rangesIntersect(const int *lo1, const int *len1,
+                                        const int *lo2, const int *len2)
+{
+    bool hit = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        hit = hit && (lo1[a] < lo2[a] + len2[a]) && (lo2[a] < lo1[a] + len1[a]);
+    }
+    return hit;
+}
+
+template <int N>
+static void grid_addToRange(CellStore<N> &cells, int item,
+                            const int *lo, const int *len)
+{
+    if (grid_isEmptyRange<N>(len)) {
+        return;
+    }
+    int c[N];
+    std::copy(lo, lo + N, c);
+    do {
+        cells.get(c).insert(item);
+    } while (grid_nextCell<N>(c, lo, len));
+}
+
+template <int N>
+static void grid_removeFromRange(CellStore<N> &cells, int item,
+                                 const int *lo, const int *len)
+{
+    if (grid_isEmptyRange<N>(len)) {
+        return;
+    }
+    int c[N];
+    std::copy(lo, lo + N, c);
+    do {
+        cells.remove(c, item);
+    } while (grid_nextCell<N>(c, lo, len));
+}
+
+//-- moves an item from the cell range lo1/len1 to lo2/len2, touching only
+//-- the cells that are in one range but not the other
+template <int N>
+static void grid_moveInRange(CellStore<N> &cells, int item,
+                             const int *lo1, const int *len1, const int *lo2,
+                             const int *len2)
+{
+    bool sameCells = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        sameCells = sameCells && (lo1[a] == lo2[a]) && (len1[a] == len2[a]);
+    }
+    if (sameCells) {
+        return;
+    }
+
+    int c[N];
+    if (!grid_isEmptyRange<N>(len1)) {
+        std::copy(lo1, lo1 + N, c);
+        do {
+            if (!grid_inRange<N>(c, lo2, len2)) {
+                cells.remove(c, item);
+            }
+        } while (grid_nextCell<N>(c, lo1, len1));
+    }
+    if (!grid_isEmptyRange<N>(len2)) {
+        std::copy(lo2, lo2 + N, c);
+        do {
+            if (!grid_inRange<N>(c, lo1, len1)) {
+                cells.get(c).insert(item);
+            }
+        } while (grid_nextCell<N>(c, lo2, len2));
+    }
+}
+
+//-- Sorts a batch into grid iteration order with one stable counting sort
+//-- per axis, fastest varying axis first. Batches are built in ascending
+//-- item order, which the stable passes keep within each cell. Axes whose
+//-- cells are spread much wider than the batch fall back to std::sort.
+template <int N>
+static void grid_sortEntries(std::vector<CellEntry<N> > &entries)
+{
+    size_t n = entries.size();
+    if (n < 2) {
+        return;
+    }
+    std::vector<CellEntry<N> > sorted(n);
+    std::vector<size_t> start;
+    for (int a = 0; a < N; a++) {
+        int lo = entries[0].c[a], hi = lo;
+        for (size_t i = 1; i < n; i++) {
+            lo = std::min(lo, entries[i].c[a]);
+            hi = std::max(hi, entries[i].c[a]);
+        }
+        size_t span = (size_t)((long long)hi - lo) + 1;
+        if (span > 4 * n + 256) {
+            std::sort(entries.begin(), entries.end(), SortByCell<N>());
+            return;
+        }
+
+        start.assign(span + 1, 0);
+        for (size_t i = 0; i < n; i++) {
+            start[entries[i].c[a] - lo + 1]++;
+        }
+        for (size_t k = 1; k <= span; k++) {
+            start[k] += start[k - 1];
+        }
+        for (size_t i = 0; i < n; i++) {
+            sorted[start[entries[i].c[a] - lo]++] = entries[i];
+        }
+        entries.swap(sorted);
+    }
+}
+
+template <int N>
+static inline bool sameCell(const CellEntry<N> &l, const CellEntry<N> &r)
+{
+    bool same = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        same = same && (l.c[a] == r.c[a]);
+    }
+    return same;
+}
+
+template <int N>
+static void grid_appendRange(std::vector<CellEntry<N> > &entries, int item,
+                             const int *lo, const int *len)
+{
+    if (grid_isEmptyRange<N>(len)) {
+        return;
+    }
+    CellEntry<N> e;
+    std::copy(lo, lo + N, e.c);
+    e.item = item;
+    do {
+        entries.push_back(e);
+    } while (grid_nextCell<N>(e.c, lo, len));
+}
+
+/*------------------------------------------
+-- Navigation
+------------------------------------------*/
+
+//-- An open A* node, f = g + the Manhattan distance left
+struct NavNode {
+    int f, g;
+    int index;
+};
+
+//-- heap order: lowest f first, then the deepest, then by tile
+static inline bool navLater(const NavNode &a, const NavNode &b)
+{
+    if (a.f != b.f) {
+        return a.f > b.f;
+    }
+    if (a.g != b.g) {
+        return a.g < b.g;
+    }
+    return a.index > b.index;
+}
+
+//-- The tiles of a navigation area, indexed with axis 0 fastest
+template <int N> struct NavTiles {
+    double origin[N];
+    double tile[N];
+    int len[N];
+
+    //-- false when p is outside the area
+    bool toTile(const double *p, int *c) const
+    {
+        bool in = true;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            c[a] = (int)floor((p[a] - origin[a]) / tile[a]);
+            in   = in && c[a] >= 0 && c[a] < len[a];
+        }
+        return in;
+    }
+
+    //-- the center of tile c
+    void toWorld(const int *c, double *p) const
+    {
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            p[a] = origin[a] + (c[a] + 0.5) * tile[a];
+        }
+    }
+
+    int index(const int *c) const
+    {
+        int i = 0;
+        for (int a = N - 1; a >= 0; a--) {
+            i = i * len[a] + c[a];
+        }
+        return i;
+    }
+
+    void tileOf(int i, int *c) const
+    {
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            c[a] = i % len[a];
+            i /= len[a];
+        }
+    }
+
+    static int distance(const int *a, const int *b)
+    {
+        int d = 0;
+        BUMP_UNROLL
+        for (int i = 0; i < N; i++) {
+            d += iabs(a[i] - b[i]);
+        }
+        return d;
+    }
+};
+
+//-- A walkability bitmap over a fixed area, kept by the World in step with
+//-- its items: every tile counts the blocking items that overlap it, and a
+//-- tile with none is walkable. Tiles are joined to their 2 * N neighbours
+//-- along the axes, at a cost of 1.
+template <int N> struct NavGrid : NavTiles<N> {
+    using NavTiles<N>::origin;
+    using NavTiles<N>::tile;
+    using NavTiles<N>::len;
+    using NavTiles<N>::index;
+    using NavTiles<N>::tileOf;
+    using NavTiles<N>::distance;
+
+    std::vector<int> blockers; //-- empty while there is no navigation
+    std::set<int> passable;    //-- items that do not block
+
+    NavGrid()
+    {
+        std::fill(len, len + N, 0);
+    }
+
+    bool enabled() const
+    {
+        return !blockers.empty();
+    }
+
+    bool blocks(int item) const
+    {
+        return enabled() && passable.find(item) == passable.end();
+    }
+
+    void setup(const double *pos, const double *size, const double *tileSize)
+    {
+        size_t total = 1;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            origin[a] = pos[a];
+            tile[a]   = tileSize[a];
+            len[a]    = std::max(1, (int)ceil(size[a] / tileSize[a]));
+            total *= len[a];
+        }
+        blockers.assign(total, 0);
+    }
+
+    //-- adds delta to the tiles b overlaps with a positive area
+    void rasterize(const Box<N> &b, int delta)
+    {
+        int lo[N], hi[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            double l = (b.pos[a] - origin[a]) / tile[a];
+            double h = (b.pos[a] + b.size[a] - origin[a]) / tile[a];
+            lo[a]    = std::max(0, (int)floor(l));
+            hi[a]    = std::min(len[a] - 1, (int)ceil(h) - 1);
+            if (lo[a] > hi[a]) {
+                return;
+            }
+        }
+        int c[N];
+        std::copy(lo, lo + N, c);
+        for (;;) {
+            blockers[index(c)] += delta;
+            int a = 0;
+            while (a < N && c[a] == hi[a]) {
+                c[a] = lo[a];
+                a++;
+            }
+            if (a == N) {
+                return;
+            }
+            c[a]++;
+        }
+    }
+
+    bool walkable(const int *c) const
+    {
+        return blockers[index(c)] == 0;
+    }
+
+    //-- A* from tile from to tile to; path receives the tile indexes from
+    //-- one to the other, both included. False when to cannot be reached.
+    bool findPath(const int *from, const int *to, std::vector<int> &path) const
+    {
+        path.clear();
+        if (!walkable(from) || !walkable(to)) {
+            return false;
+        }
+        int start = index(from), goal = index(to);
+        std::vector<int> g(blockers.size(), INT_MAX);
+        std::vector<int> parent(blockers.size(), -1);
+        std::vector<NavNode> open;
+        NavNode node = {distance(from, to), 0, start};
+        g[start]     = 0;
+        open.push_back(node);
+
+        int c[N];
+        while (!open.empty()) {
+            std::pop_heap(open.begin(), open.end(), navLater);
+            node = open.back();
+            open.pop_back();
+            if (node.g != g[node.index]) {
+                continue; //-- reached again by a shorter way since
+            }
+            if (node.index == goal) {
+                for (int i = goal; i != -1; i = parent[i]) {
+                    path.push_back(i);
+                }
+                std::reverse(path.begin(), path.end());
+                return true;
+            }
+            tileOf(node.index, c);
+            for (int a = 0; a < N; a++) {
+                for (int d = -1; d <= 1; d += 2) {
+                    c[a] += d;
+                    if (c[a] >= 0 && c[a] < len[a]) {
+                        int i = index(c);
+                        if (blockers[i] == 0 && node.g + 1 < g[i]) {
+                            g[i]         = node.g + 1;
+                            parent[i]    = node.index;
+                            NavNode next = {g[i] + distance(c, to), g[i], i};
+                            open.push_back(next);
+                            std::push_heap(open.begin(), open.end(), navLater);
+                        }
+                    }
+                    c[a] -= d;
+                }
+            }
+        }
+        return false;
+    }
+
+    //-- A flow field toward tile to, for any number of agents: next[i] is
+    //-- the tile to step to from tile i and dist[i] the steps left, both -1
+    //-- where to cannot be reached. The goal tile leads to itself.
+    void flowField(const int *to, std::vector<int> &next,
+                   std::vector<int> &dist) const
+    {
+        next.assign(blockers.size(), -1);
+        dist.assign(blockers.size(), -1);
+        if (!walkable(to)) {
+            return;
+        }
+        std::vector<int> queue;
+        queue.reserve(blockers.size());
+        int goal   = index(to);
+        next[goal] = goal;
+        dist[goal] = 0;
+        queue.push_back(goal);
+
+        int c[N];
+        for (size_t head = 0; head < queue.size(); head++) {
+            int u = queue[head];
+            tileOf(u, c);
+            for (int a = 0; a < N; a++) {
+                for (int d = -1; d <= 1; d += 2) {
+                    c[a] += d;
+                    if (c[a] >= 0 && c[a] < len[a]) {
+                        int i = index(c);
+                        if (blockers[i] == 0 && dist[i] < 0) {
+                            next[i] = u;
+                            dist[i] = dist[u] + 1;
+                            queue.push_back(i);
+                        }
+                    }
+                    c[a] -= d;
+                }
+            }
+        }
+    }
+};
+
+//-- A broad-phase candidate of a move, with its box and its cell range
+//-- loaded once for all the projections of that move
+template <int N> struct Candidate {
+    int item;
+    Box<N> box;
+    int lo[N];
+    int len[N];
+};
+
+//-- One item of a swept batch move: its box at the start of the tick, its
+//-- move over the tick and the tick time it stopped at (1 while it moves)
+template <int N> struct SweptMover {
+    int item;
+    Box<N> box;
+    double move[N];
+    double stop;
+    int version;  //-- bumped on every stop, to drop stale events
+    bool blocked; //-- stopped by a static item, see World::moveSwept()
+    double lo[N], hi[N]; //-- bounds of the swept box
+    std::vector<int> pairs;
+    std::vector<Collision<N> > cols;
+};
+
+//-- A pending contact between movers i and j, seen from i, valid while
+//-- both still have the versions it was computed with. j is -1 for the
+//-- first static item i stops against.
+template <int N> struct SweptEvent {
+    int i, j;
+    int vi, vj;
+    Collision<N> col;
+};
+
+//-- heap order: earliest first, then by pair for a deterministic order
+template <int N>
+static bool sweptLater(const SweptEvent<N> &a, const SweptEvent<N> &b)
+{
+    if (a.col.ti != b.col.ti) {
+        return a.col.ti > b.col.ti;
+    }
+    if (a.i != b.i) {
+        return a.i > b.i;
+    }
+    return a.j > b.j;
+}
+
+template <int N>
+static bool sweptEarlier(const Collision<N> &a, const Collision<N> &b)
+{
+    return a.ti < b.ti;
+}
+
+template <int N> struct SortBySweptLo {
+    const std::vector<SweptMover<N> > *movers;
+    bool operator()(int a, int b) const
+    {
+        const SweptMover<N> &ma = (*movers)[a], &mb = (*movers)[b];
+        return ma.lo[0] < mb.lo[0] || (ma.lo[0] == mb.lo[0] && a < b);
+    }
+};
+
+//-- A kinematic body, see World::step()
+template <int N> struct Body {
+    double velocity[N];
+    double gravity[N];
+    int response; //-- the filter id its moves use
+};
+
+template <int N> struct ItemInfo {
+    int item;
+    double ti1, ti2, weight;
+    double p1[N], p2[N];
+};
+
+#ifdef BUMP_COUNTERS
+struct Counters {
+    unsigned long long cellsVisited;  //-- non-empty cells read by the broad phase
+    unsigned long long candidates;    //-- item ids gathered from those cells
+    unsigned long long dedupeHits;    //-- candidates already gathered from another cell
+    unsigned long long detectCalls;   //-- box_detectCollision calls in project()
+    unsigned long long detectHits;    //-- ... that returned a collision
+    unsigned long long responseIters; //-- response iterations in projectMove()
+    unsigned long long traverseSteps; //-- cells emitted by grid_traverse
+
+    Counters() { reset(); }
+    void reset()
+    {
+        cellsVisited = candidates = dedupeHits = detectCalls = detectHits =
+            responseIters = traverseSteps = 0;
+    }
+};
+#endif
+
+template <int N, class T> struct World {
+    CellSize<N> cellSize;
+    int itemId;
+    std::map<int, Response<N, T> *> responses;
+    //-- responses[Touch .. Bounce], without the map lookup
+    Response<N, T> *builtinResponses[Bounce + 1];
+    std::map<int, ColFilter *> filters;
+    BoxStore<N, T> boxes;
+    std::map<int, Body<N> > bodies;
+    NavGrid<N> nav;
+    CellStore<N> cells;
+    //-- the area whose cells are kept in a flat array, see bound()
+    bool bounded;
+    double boundsPos[N];
+    double boundsSize[N];
+    //-- sum and count of the largest sides of queried and swept boxes, for
+    //-- suggestCellSize()
+    double footprintSum[N];
+    unsigned long long footprintCount;
+#ifdef BUMP_COUNTERS
+    Counters counters;
+#endif
+
+    World() : itemId(0), bounded(false)
+    {
+        std::fill(builtinResponses, builtinResponses + Bounce + 1,
+                  (Response<N, T> *)NULL);
+        resetFootprints();
+    }
+
+    void initialize(double cellSize)
+    {
+        double sizes[N];
+        std::fill(sizes, sizes + N, cellSize);
+        initialize(sizes);
+    }
+
+    //-- one cell size per axis; they need not be equal nor integers
+    void initialize(const double *cellSizes)
+    {
+        this->cellSize.set(cellSizes);
+        this->itemId = 0;
+
+        this->addFilter(Touch, new TouchFilter());
+        this->addFilter(Cross, new CrossFilter());
+        this->addFilter(Slide, new SlideFilter());
+        this->addFilter(Bounce, new BounceFilter());
+
+        this->addResponse(Touch, new TouchResponse<N, T>());
+        this->addResponse(Cross, new CrossResponse<N, T>());
+        this->addResponse(Slide, new SlideResponse<N, T>());
+        this->addResponse(Bounce, new BounceResponse<N, T>());
+    }
+
+    void release()
+    {
+        for (typename std::map<int, Response<N, T> *>::iterator it =
+                 responses.begin();
+             it != responses.end(); it++) {
+            delete it->second;
+        }
+        responses.clear();
+        std::fill(builtinResponses, builtinResponses + Bounce + 1,
+                  (Response<N, T> *)NULL);
+
+        for (std::map<int, ColFilter *>::iterator it = filters.begin();
+             it != filters.end(); it++) {
+            delete it->second;
+        }
+        filters.clear();
+
+        this->clear();
+    }
+
+    //-- Private functions and methods
+    static bool sortByWeight(const ItemInfo<N> &a, const ItemInfo<N> &b)
+    {
+        return a.weight < b.weight;
+    }
+
+    void addItemToCell(int item, const int *c)
+    {
+        cells.get(c).insert(item);
+    }
+
+    bool removeItemFromCell(int item, const int *c)
+    {
+        return cells.remove(c, item);
+    }
+
+    void getDictItemsInCellBox(const int *c, const int *len,
+                               std::set<int> &items_dict)
+    {
+        cells.collect(this, c, len, items_dict);
+    }
+
+    void noteFootprint(const double *size)
+    {
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            footprintSum[a] += size[a];
+        }
+        footprintCount++;
+    }
+
+    //-- fills an empty grid from memberships sorted by grid_sortEntries
+    void appendEntries(const std::vector<CellEntry<N> > &entries)
+    {
+        Cell *cell = NULL;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i == 0 || !sameCell<N>(entries[i], entries[i - 1])) {
+                cell = &cells.append(entries[i].c);
+            }
+            cell->insert(entries[i].item);
+        }
+    }
+
+    struct _CellTraversal {
+        World *world;
+        std::set<Cell *> cells;
+    };
+
+    static bool cellsTraversal_(void *ctx, const int *c)
+    {
+        struct _CellTraversal *ct = (struct _CellTraversal *)ctx;
+        BUMP_COUNT(ct->world, traverseSteps, 1);
+        Cell *cell = ct->world->cells.find(c);
+        if (cell) {
+            ct->cells.insert(cell);
+        }
+        return true;
+    }
+
+    struct _SightTraversal {
+        World *world;
+        const double *p1, *p2;
+        ItemFilter *filter;
+        bool blocked;
+    };
+
+    //-- stops in the first cell with an item across the segment
+    static bool sightTraversal_(void *ctx, const int *c)
+    {
+        struct _SightTraversal *st = (struct _SightTraversal *)ctx;
+        BUMP_COUNT(st->world, traverseSteps, 1);
+        Cell *cell = st->world->cells.find(c);
+        if (cell == NULL) {
+            return true;
+        }
+        BUMP_COUNT(st->world, cellsVisited, 1);
+        BUMP_COUNT(st->world, candidates, cell->items.size());
+        for (std::vector<int>::iterator i = cell->items.begin();
+             i != cell->items.end(); i++) {
+            if (st->filter && !st->filter->Filter(*i)) {
+                continue;
+            }
+            Box<N> b = st->world->boxOf(*i);
+            double n1[N], n2[N];
+            double ti1 = 0;
+            double ti2 = 1;
+            if (box_getSegmentIntersectionIndices<N>(
+                    b.pos, b.size, st->p1, st->p2, ti1, ti2, n1, n2) &&
+                (((0 < ti1) && (ti1 < 1)) || ((0 < ti2) && (ti2 < 1)))) {
+                st->blocked = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::set<Cell *> getCellsTouchedBySegment(const double *p1,
+                                              const double *p2)
+    {
+        struct _CellTraversal ct;
+        ct.world = this;
+        grid_traverse<N>(cellSize, p1, p2, cellsTraversal_, &ct);
+        return ct.cells;
+    }
+
+    void getInfoAboutItemsTouchedBySegment(const double *p1, const double *p2,
+                                           ItemFilter *filter,
+                                           std::vector<ItemInfo<N> > &itemInfo)
+    {
+        std::set<Cell *> cells = getCellsTouchedBySegment(p1, p2);
+        std::set<int> visited;
+
+        for (std::set<Cell *>::iterator it = cells.begin(); it != cells.end();
+             it++) {
+            Cell *cell = (*it);
+            BUMP_COUNT(this, cellsVisited, 1);
+            BUMP_COUNT(this, candidates, cell->items.size());
+            for (std::vector<int>::iterator i = cell->items.begin();
+                 i != cell->items.end(); i++) {
+                if (!visited.insert(*i).second) {
+                    BUMP_COUNT(this, dedupeHits, 1);
+                    continue;
+                }
+                if (filter && !filter->Filter(*i)) {
+                    continue;
+                }
+                Box<N> b = boxOf(*i);
+                double n1[N], n2[N];
+                double ti1 = 0;
+                double ti2 = 1;
+                if (box_getSegmentIntersectionIndices<N>(b.pos, b.size, p1, p2,
+                                                         ti1, ti2, n1, n2) &&
+                    (((0 < ti1) && (ti1 < 1)) || ((0 < ti2) && (ti2 < 1)))) {
+                    //-- the sorting is according to the t of an infinite
+                    //-- line, not the segment
+                    double tii0 = -MATH_HUGE;
+                    double tii1 = MATH_HUGE;
+                    box_getSegmentIntersectionIndices<N>(
+                        b.pos, b.size, p1, p2, tii0, tii1, n1, n2);
+                    ItemInfo<N> ii;
+                    ii.item   = *i;
+                    ii.ti1    = ti1;
+                    ii.ti2    = ti2;
+                    ii.weight = tii0 < tii1 ? tii0 : tii1;
+                    itemInfo.push_back(ii);
+                }
+            }
+        }
+        std::sort(itemInfo.begin(), itemInfo.end(), sortByWeight);
+    }
+
+    Response<N, T> *getResponseById(int id)
+    {
+        return responses[id];
+    }
+
+    void addResponse(int id, Response<N, T> *response)
+    {
+        responses[id] = response;
+        if (id > 0 && id <= Bounce) {
+            builtinResponses[id] = response;
+        }
+    }
+
+    void addFilter(int id, ColFilter *filter)
+    {
+        filters[id] = filter;
+    }
+
+    ColFilter *getFilterById(int id)
+    {
+        return filters[id];
+    }
+
+    void project(int item, const double *pos, const double *size,
+                 const double *goal, ColFilter *filter,
+                 std::vector<Collision<N> > &collisions)
+    {
+        int c[N], len[N];
+        sweepCells(pos, size, goal, c, len);
+        std::vector<Candidate<N> > candidates;
+        gatherCandidates(c, len, candidates);
+        std::vector<int> visited;
+        CollisionList<Collision<N> > list(collisions);
+        projectCandidates(item, pos, size, goal, filter, visited, candidates,
+                          false, c, len, list);
+        collision_sort<N>(collisions);
+    }
+
+    //-- the cells a box of the given size touches on its way from pos to
+    //-- goal
+    void sweepCells(const double *pos, const double *size, const double *goal,
+                    int *c, int *len)
+    {
+        //-- This could probably be done with less cells using a polygon raster
+        // over the cells instead of a
+        //-- bounding box of the whole movement. Conditional to building a
+        // queryPolygon method
+        double tpos[N], tsize[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            double t1 = (goal[a] < pos[a]) ? goal[a] : pos[a];
+            double t2 = (goal[a] > pos[a]) ? goal[a] : pos[a];
+            tpos[a]   = t1;
+            tsize[a]  = (t2 + size[a]) - t1;
+        }
+        grid_toCellBox<N>(cellSize, tpos, tsize, c, len);
+    }
+
+    void gatherCandidates(const int *c, const int *len,
+                          std::vector<Candidate<N> > &candidates)
+    {
+        std::set<int> dictItemsInCellBox;
+        getDictItemsInCellBox(c, len, dictItemsInCellBox);
+
+        candidates.resize(dictItemsInCellBox.size());
+        typename std::vector<Candidate<N> >::iterator k = candidates.begin();
+        for (std::set<int>::iterator it = dictItemsInCellBox.begin();
+             it != dictItemsInCellBox.end(); it++, k++) {
+            k->item = *it;
+            k->box  = boxOf(*it);
+            grid_toCellBox<N>(cellSize, k->box.pos, k->box.size, k->lo,
+                              k->len);
+        }
+    }
+
+    //-- The narrow phase of project() over gathered candidates, skipping
+    //-- item and the visited items. With clip set, candidates outside the
+    //-- cells c/len are skipped too, so a projection over a wider gathered
+    //-- set finds exactly what its own broad phase would. Collisions go to
+    //-- sink unsorted.
+    template <class Sink>
+    void projectCandidates(int item, const double *pos, const double *size,
+                           const double *goal, ColFilter *filter,
+                           const std::vector<int> &visited,
+                           const std::vector<Candidate<N> > &candidates,
+                           bool clip, const int *c, const int *len, Sink &sink)
+    {
+        Box<N> b;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            b.pos[a]  = pos[a];
+            b.size[a] = size[a];
+        }
+
+        for (typename std::vector<Candidate<N> >::const_iterator it =
+                 candidates.begin();
+             it != candidates.end(); it++) {
+            int other = it->item;
+            if (other == item || std::find(visited.begin(), visited.end(),
+                                           other) != visited.end()) {
+                continue;
+            }
+            if (clip && !grid_rangesIntersect<N>(c, len, it->lo, it->len)) {
+                continue;
+            }
+            int responseId = filter_apply(filter, item, other);
+            if (responseId > 0) {
+                Collision<N> col;
+                BUMP_COUNT(this, detectCalls, 1);
+                if (box_detectCollision<N>(b, it->box, goal, col)) {
+                    BUMP_COUNT(this, detectHits, 1);
+                    col.other = other;
+                    col.item  = item;
+                    col.type  = responseId;
+                    sink(col);
+                }
+            }
+        }
+    }
+
+    int countCells()
+    {
+        return cells.count();
+    }
+
+    bool hasItem(int item)
+    {
+        return boxes.find(item) != NULL;
+    }
+
+    std::set<int> getItems()
+    {
+        std::set<int> items;
+        for (int id = boxes.next(0); id; id = boxes.next(id)) {
+            items.insert(items.end(), id);
+        }
+        return items;
+    }
+
+    int countItems()
+    {
+        return boxes.size();
+    }
+
+    void getBox(int item, double *pos, double *size)
+    {
+        const Box<N, T> &b = boxes.get(item);
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            pos[a]  = b.pos[a];
+            size[a] = b.size[a];
+        }
+    }
+
+    //-- the item's box, widened to double
+    Box<N> boxOf(int item)
+    {
+        Box<N> b;
+        box_load<N, T>(boxes.get(item), b);
+        return b;
+    }
+
+    void toWorld(const int *c, double *p)
+    {
+        grid_toWorld<N>(cellSize, c, p);
+    }
+
+    void toCell(const double *p, int *c)
+    {
+        grid_toCell<N>(cellSize, p, c);
+    }
+
+    //--- Query methods
+
+    void queryBox(const double *pos, const double *size, ItemFilter *filter,
+                  std::set<int> &dictItemsInCellBox)
+    {
+        noteFootprint(size);
+        int c[N], len[N];
+        grid_toCellBox<N>(cellSize, pos, size, c, len);
+        getDictItemsInCellBox(c, len, dictItemsInCellBox);
+        for (std::set<int>::iterator it = dictItemsInCellBox.begin();
+             it != dictItemsInCellBox.end();) {
+            bool drop = (filter && !filter->Filter(*it));
+            if (!drop) {
+                Box<N> b = boxOf(*it);
+                drop = !box_isIntersecting<N>(pos, size, b.pos, b.size);
+            }
+            if (drop) {
+                dictItemsInCellBox.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void queryPoint(const double *p, ItemFilter *filter,
+                    std::set<int> &dictItemsInCellBox)
+    {
+        int c[N], len[N];
+        toCell(p, c);
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            len[a] = 1;
+        }
+        getDictItemsInCellBox(c, len, dictItemsInCellBox);
+        for (std::set<int>::iterator it = dictItemsInCellBox.begin();
+             it != dictItemsInCellBox.end();) {
+            Box<N> b = boxOf(*it);
+            if ((filter && !filter->Filter(*it)) ||
+                !box_containsPoint<N>(b.pos, b.size, p)) {
+                dictItemsInCellBox.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    //-- queryPoint() for count points packed one after another. They are
+    //-- answered grouped by cell, so each cell is looked up once per batch.
+    //-- The items holding point i end up in items[start[i] .. start[i + 1]),
+    //-- ascending; with first set only the lowest id is kept.
+    void queryPointMany(const double *points, int count, ItemFilter *filter,
+                        bool first, std::vector<int> &start,
+                        std::vector<int> &items)
+    {
+        std::vector<CellEntry<N> > entries(count);
+        for (int i = 0; i < count; i++) {
+            toCell(points + N * i, entries[i].c);
+            entries[i].item = i;
+        }
+        grid_sortEntries<N>(entries);
+
+        //-- (point, item) hits in cell order, then bucketed by point
+        std::vector<std::pair<int, int> > hits;
+        Cell *cell = NULL;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i == 0 || !sameCell<N>(entries[i], entries[i - 1])) {
+                cell = cells.find(entries[i].c);
+                BUMP_COUNT(this, cellsVisited, cell ? 1 : 0);
+            }
+            if (cell == NULL) {
+                continue;
+            }
+            int point       = entries[i].item;
+            const double *p = points + N * point;
+            for (std::vector<int>::iterator it = cell->items.begin();
+                 it != cell->items.end(); it++) {
+                if (filter && !filter->Filter(*it)) {
+                    continue;
+                }
+                Box<N> b = boxOf(*it);
+                if (box_containsPoint<N>(b.pos, b.size, p)) {
+                    hits.push_back(std::make_pair(point, *it));
+                    if (first) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        start.assign(count + 1, 0);
+        for (size_t i = 0; i < hits.size(); i++) {
+            start[hits[i].first + 1]++;
+        }
+        for (int i = 0; i < count; i++) {
+            start[i + 1] += start[i];
+        }
+        std::vector<int> at(start.begin(), start.end() - 1);
+        items.resize(hits.size());
+        for (size_t i = 0; i < hits.size(); i++) {
+            items[at[hits[i].first]++] = hits[i].second;
+        }
+    }
+
+    void querySegment(const double *p1, const double *p2, ItemFilter *filter,
+                      std::set<int> &items)
+    {
+        std::vector<ItemInfo<N> > itemInfo;
+        getInfoAboutItemsTouchedBySegment(p1, p2, filter, itemInfo);
+        for (typename std::vector<ItemInfo<N> >::iterator it = itemInfo.begin();
+             it != itemInfo.end(); it++) {
+            items.insert((*it).item);
+        }
+    }
+
+    //-- Whether no item the filter keeps crosses the segment p1, p2, with
+    //-- the test of querySegment(). The walk along the cells stops at the
+    //-- first such item, and nothing is sorted or collected.
+    bool lineOfSight(const double *p1, const double *p2, ItemFilter *filter)
+    {
+        struct _SightTraversal st;
+        st.world   = this;
+        st.p1      = p1;
+        st.p2      = p2;
+        st.filter  = filter;
+        st.blocked = false;
+        grid_traverse<N>(cellSize, p1, p2, sightTraversal_, &st);
+        return !st.blocked;
+    }
+
+    //-- lineOfSight() for count segments packed as {p1, p2, ...}: bit i % 32
+    //-- of clear[i / 32] is set when segment i is clear
+    void lineOfSightMany(const double *segments, int count,
+                         ItemFilter *filter, std::vector<unsigned> &clear)
+    {
+        clear.assign((count + 31) / 32, 0);
+        for (int i = 0; i < count; i++) {
+            const double *p1 = segments + 2 * N * i;
+            if (lineOfSight(p1, p1 + N, filter)) {
+                clear[i / 32] |= 1u << (i % 32);
+            }
+        }
+    }
+
+    void querySegmentWithCoords(const double *p1, const double *p2,
+                                ItemFilter *filter,
+                                std::vector<ItemInfo<N> > &itemInfo)
+    {
+        getInfoAboutItemsTouchedBySegment(p1, p2, filter, itemInfo);
+        for (typename std::vector<ItemInfo<N> >::iterator it = itemInfo.begin();
+             it != itemInfo.end(); it++) {
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                double d     = p2[a] - p1[a];
+                (*it).p1[a] = p1[a] + d * (*it).ti1;
+                (*it).p2[a] = p1[a] + d * (*it).ti2;
+            }
+        }
+    }
+
+    //--- Main methods
+    int allocateId()
+    {
+        if (itemId >= INT_MAX) {
+            itemId = 0;
+        }
+
+        int nid = (++itemId);
+
+        while (hasItem(nid)) {
+            nid++;
+        }
+
+        itemId = nid;
+        return nid;
+    }
+
+    //-- count fresh ids; a contiguous block after itemId when it is free
+    void allocateIds(int count, int *ids)
+    {
+        int start = (itemId >= INT_MAX - count) ? 1 : itemId + 1;
+        if (count > 0 && boxes.vacant(start, count)) {
+            for (int i = 0; i < count; i++) {
+                ids[i] = start + i;
+            }
+            itemId = start + count - 1;
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            ids[i] = allocateId();
+        }
+    }
+
+    //-- adds count items, whose boxes are packed as {pos[N], size[N]} per
+    //-- item, under fresh ids written to ids. The memberships of the whole
+    //-- batch are sorted by cell and written in one pass over the grid.
+    void addMany(const double *packed, int count, int *ids)
+    {
+        allocateIds(count, ids);
+
+        std::vector<CellEntry<N> > entries;
+        entries.reserve(2 * count);
+        for (int i = 0; i < count; i++) {
+            const double *pos = packed + 2 * N * i;
+            Box<N, T> &s      = boxes[ids[i]];
+            box_store<N, T>(pos, pos + N, s);
+
+            Box<N> b;
+            box_load<N, T>(s, b);
+            int lo[N], len[N];
+            grid_toCellBox<N>(cellSize, b.pos, b.size, lo, len);
+            grid_appendRange<N>(entries, ids[i], lo, len);
+            if (nav.blocks(ids[i])) {
+                nav.rasterize(b, 1);
+            }
+        }
+
+        grid_sortEntries<N>(entries);
+        cells.insertSorted(entries);
+    }
+
+    //-- removes count items; ids that are not in the world are skipped
+    void removeMany(const int *items, int count)
+    {
+        std::vector<CellEntry<N> > entries;
+        for (int i = 0; i < count; i++) {
+            Box<N, T> *b = boxes.find(items[i]);
+            if (b == NULL) {
+                continue;
+            }
+            Box<N> r;
+            box_load<N, T>(*b, r);
+            int lo[N], len[N];
+            grid_toCellBox<N>(cellSize, r.pos, r.size, lo, len);
+            grid_appendRange<N>(entries, items[i], lo, len);
+            if (nav.blocks(items[i])) {
+                nav.rasterize(r, -1);
+            }
+            nav.passable.erase(items[i]);
+            boxes.erase(items[i]);
+        }
+
+        grid_sortEntries<N>(entries);
+        cells.removeSorted(entries);
+        for (int i = 0; i < count; i++) {
+            bodies.erase(items[i]);
+        }
+    }
+
+    void add(int item, const double *pos, const double *size)
+    {
+        Box<N, T> &s = boxes[item];
+        box_store<N, T>(pos, size, s);
+
+        //-- the cells come from the stored box, so remove() finds them again
+        Box<N> b;
+        box_load<N, T>(s, b);
+        int lo[N], len[N];
+        grid_toCellBox<N>(cellSize, b.pos, b.size, lo, len);
+        grid_addToRange<N>(cells, item, lo, len);
+        if (nav.blocks(item)) {
+            nav.rasterize(b, 1);
+        }
+    }
+
+    void remove(int item)
+    {
+        Box<N, T> *b = boxes.find(item);
+        if (b == NULL) {
+            return;
+        }
+
+        Box<N> r;
+        box_load<N, T>(*b, r);
+        int lo[N], len[N];
+        grid_toCellBox<N>(cellSize, r.pos, r.size, lo, len);
+        grid_removeFromRange<N>(cells, item, lo, len);
+        if (nav.blocks(item)) {
+            nav.rasterize(r, -1);
+        }
+
+        nav.passable.erase(item);
+        boxes.erase(item);
+        bodies.erase(item);
+    }
+
+    void clear()
+    {
+        itemId = 0;
+        boxes.clear();
+        bodies.clear();
+        nav.passable.clear();
+        std::fill(nav.blockers.begin(), nav.blockers.end(), 0);
+        cells.clear();
+    }
+
+    //-- A cell size per axis for what the world holds and how it is
+    //-- queried: twice the median item side along that axis, so a typical
+    //-- item spans one or two cells, or half the mean query and move
+    //-- footprint when that is larger, so a typical query reads about three
+    //-- cells. Axes with nothing to go on keep their current size.
+    void suggestCellSize(double *sizes)
+    {
+        std::vector<double> extents(boxes.size());
+        for (int a = 0; a < N; a++) {
+            std::vector<double>::iterator e = extents.begin();
+            for (int id = boxes.next(0); id; id = boxes.next(id), e++) {
+                *e = boxes.find(id)->size[a];
+            }
+
+            double size = 0;
+            if (!extents.empty()) {
+                std::vector<double>::iterator mid =
+                    extents.begin() + extents.size() / 2;
+                std::nth_element(extents.begin(), mid, extents.end());
+                size = 2 * (*mid);
+            }
+            if (footprintCount > 0) {
+                size = std::max(size, footprintSum[a] / footprintCount / 2);
+            }
+            sizes[a] = (size > 0) ? ceil(size) : cellSize.size[a];
+        }
+    }
+
+    //-- forgets the query footprints seen so far
+    void resetFootprints()
+    {
+        std::fill(footprintSum, footprintSum + N, 0.0);
+        footprintCount = 0;
+    }
+
+    //-- Keeps the cells that cover the box pos/size in one flat array,
+    //-- indexed directly, instead of the maps. Items may still reach outside
+    //-- it; their cells there go to the maps. Queries and moves return the
+    //-- same results as in an unbounded world. The array holds a cell for
+    //-- every slot of the area, so the area should be a known, finite map.
+    void bound(const double *pos, const double *size)
+    {
+        bounded = true;
+        std::copy(pos, pos + N, boundsPos);
+        std::copy(size, size + N, boundsSize);
+        rebuild(cellSize.size);
+    }
+
+    //-- Re-buckets every item under a new cell size in one pass: the
+    //-- memberships are recomputed from the stored boxes, sorted by cell and
+    //-- appended to an empty grid. Ids and boxes are kept as they are.
+    void rebuild(const double *cellSizes)
+    {
+        cells.clear();
+        cellSize.set(cellSizes);
+        if (bounded) {
+            int lo[N], len[N];
+            grid_toCellBox<N>(cellSize, boundsPos, boundsSize, lo, len);
+            cells.bound(lo, len);
+        }
+
+        std::vector<CellEntry<N> > entries;
+        entries.reserve(2 * boxes.size());
+        for (int id = boxes.next(0); id; id = boxes.next(id)) {
+            Box<N> b;
+            box_load<N, T>(*boxes.find(id), b);
+            int lo[N], len[N];
+            grid_toCellBox<N>(cellSize, b.pos, b.size, lo, len);
+            grid_appendRange<N>(entries, id, lo, len);
+        }
+        grid_sortEntries<N>(entries);
+        appendEntries(entries);
+    }
+
+    //-- sizes that are not positive keep the item's current size
+    void update(int item, const double *pos2, const double *size)
+    {
+        Box<N, T> &s = boxes[item];
+        Box<N> b, b2;
+        box_load<N, T>(s, b);
+
+        double size2[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            size2[a] = (size[a] <= 0) ? b.size[a] : size[a];
+        }
+        Box<N, T> s2;
+        box_store<N, T>(pos2, size2, s2);
+        box_load<N, T>(s2, b2);
+
+        bool same = true;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            same = same && (b.pos[a] == b2.pos[a]) && (b.size[a] == b2.size[a]);
+        }
+        if (same) {
+            return;
+        }
+
+        int lo1[N], len1[N], lo2[N], len2[N];
+        grid_toCellBox<N>(cellSize, b.pos, b.size, lo1, len1);
+        grid_toCellBox<N>(cellSize, b2.pos, b2.size, lo2, len2);
+
+        grid_moveInRange<N>(cells, item, lo1, len1, lo2, len2);
+        if (nav.blocks(item)) {
+            nav.rasterize(b, -1);
+            nav.rasterize(b2, 1);
+        }
+
+        s = s2;
+    }
+
+    //-- The broad phase runs once, for the cells of the first sweep. Every
+    //-- later projection whose sweep stays inside those cells only re-runs
+    //-- the narrow phase over the same candidates; one that leaves them
+    //-- (a bounce off the side) gathers its own.
+    //-- Only the first collision of each projection is resolved, so it is
+    //-- picked in the narrow phase instead of sorting them all.
+    //-- The four built-in responses run inline here; a custom one is asked
+    //-- through its virtual ComputeResponse() with a VisitedFilter.
+    void projectMove(int item, const double *pos, const double *size,
+                     const double *goal, ColFilter *filter, double *actual,
+                     std::vector<Collision<N> > &cols)
+    {
+        std::vector<int> visited;
+
+        Box<N> b;
+        double sweep[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            b.pos[a]  = pos[a];
+            b.size[a] = size[a];
+            actual[a] = goal[a];
+            sweep[a]  = fabs(goal[a] - pos[a]) + size[a];
+        }
+        noteFootprint(sweep);
+
+        int gc[N], glen[N];
+        sweepCells(pos, size, actual, gc, glen);
+        std::vector<Candidate<N> > candidates;
+        gatherCandidates(gc, glen, candidates);
+
+        FirstCollision<Collision<N> > next;
+        projectCandidates(item, pos, size, actual, filter, visited,
+                          candidates, false, gc, glen, next);
+
+        while (next.found) {
+            BUMP_COUNT(this, responseIters, 1);
+            Collision<N> col = next.col;
+            next.found       = false;
+            visited.push_back(col.other);
+            Response<N, T> *response = (col.type > 0 && col.type <= Bounce)
+                                           ? builtinResponses[col.type]
+                                           : getResponseById(col.type);
+
+            int kind           = response ? response->kind : 0;
+            const double *from = NULL;
+            switch (kind) {
+            case Touch:
+                response_touch<N>(col, actual);
+                break;
+            case Cross:
+                from = b.pos;
+                break;
+            case Slide:
+                response_slide<N>(col, actual);
+                from = col.touch;
+                break;
+            case Bounce:
+                response_bounce<N>(col, actual);
+                from = col.touch;
+                break;
+            default:
+                if (response) {
+                    std::vector<Collision<N> > projected_cols;
+                    VisitedFilter vf;
+                    vf.visited.insert(visited.begin(), visited.end());
+                    vf.visited.insert(item);
+                    vf.filter = filter;
+                    response->ComputeResponse(this, col, b, actual, &vf,
+                                              projected_cols);
+                    if (projected_cols.size() > 0) {
+                        next.col   = projected_cols[0];
+                        next.found = true;
+                    }
+                }
+                break;
+            }
+
+            if (from) {
+                int c[N], len[N];
+                sweepCells(from, b.size, actual, c, len);
+                bool inside = grid_containsRange<N>(gc, glen, c, len);
+                if (!inside) {
+                    std::copy(c, c + N, gc);
+                    std::copy(len, len + N, glen);
+                    gatherCandidates(gc, glen, candidates);
+                }
+                projectCandidates(item, from, b.size, actual, filter, visited,
+                                  candidates, inside, c, len, next);
+            }
+            cols.push_back(col);
+        }
+    }
+
+    //-- Keeps a walkability bitmap of tileSize tiles over the area at pos,
+    //-- size, which every item blocks until setPassable() exempts it, and
+    //-- fills it from the items already in the world. Later adds, updates
+    //-- and removes keep it current.
+    void navigate(const double *pos, const double *size,
+                  const double *tileSize)
+    {
+        nav.setup(pos, size, tileSize);
+        for (int id = boxes.next(0); id; id = boxes.next(id)) {
+            if (nav.blocks(id)) {
+                Box<N> b;
+                box_load<N, T>(*boxes.find(id), b);
+                nav.rasterize(b, 1);
+            }
+        }
+    }
+
+    //-- Whether item is left out of the walkability bitmap, for the
+    //-- agents themselves and anything else that does not block a path
+    void setPassable(int item, bool passable)
+    {
+        bool blocked = nav.blocks(item);
+        if (passable) {
+            nav.passable.insert(item);
+        } else {
+            nav.passable.erase(item);
+        }
+        Box<N, T> *s = boxes.find(item);
+        if (s && blocked != nav.blocks(item)) {
+            Box<N> b;
+            box_load<N, T>(*s, b);
+            nav.rasterize(b, blocked ? -1 : 1);
+        }
+    }
+
+    //-- Makes item a body that step() moves, or updates it
+    void setBody(int item, const double *velocity, const double *gravity,
+                 int response)
+    {
+        Body<N> &body = bodies[item];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            body.velocity[a] = velocity[a];
+            body.gravity[a]  = gravity[a];
+        }
+        body.response = response;
+    }
+
+    Body<N> *getBody(int item)
+    {
+        typename std::map<int, Body<N> >::iterator it = bodies.find(item);
+        return it == bodies.end() ? NULL : &it->second;
+    }
+
+    void removeBody(int item)
+    {
+        bodies.erase(item);
+    }
+
+    //-- Advances every body by dt, in id order: gravity is added to its
+    //-- velocity, then it moves by velocity * dt with its response. Each
+    //-- slide collision takes the velocity along the normal away, a bounce
+    //-- mirrors it and a touch stops the body; cross and custom responses
+    //-- leave it alone. The bodies that collided are appended to hit.
+    void step(double dt, std::vector<int> &hit)
+    {
+        std::vector<Collision<N> > cols;
+        for (typename std::map<int, Body<N> >::iterator it = bodies.begin();
+             it != bodies.end(); it++) {
+            Body<N> &body     = it->second;
+            ColFilter *filter = getFilterById(body.response);
+            if (filter == NULL) {
+                continue;
+            }
+            Box<N> b = boxOf(it->first);
+            double goal[N], actual[N];
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                body.velocity[a] += body.gravity[a] * dt;
+                goal[a] = b.pos[a] + body.velocity[a] * dt;
+            }
+
+            cols.clear();
+            move(it->first, goal, filter, actual, cols);
+            if (cols.empty()) {
+                continue;
+            }
+            for (typename std::vector<Collision<N> >::iterator c =
+                     cols.begin();
+                 c != cols.end(); c++) {
+                Response<N, T> *response = (c->type > 0 && c->type <= Bounce)
+                                               ? builtinResponses[c->type]
+                                               : NULL;
+                int kind  = response ? response->kind : 0;
+                double vn = 0;
+                BUMP_UNROLL
+                for (int a = 0; a < N; a++) {
+                    vn += body.velocity[a] * c->normal[a];
+                }
+                double k = (kind == Slide) ? 1 : (kind == Bounce) ? 2 : 0;
+                BUMP_UNROLL
+                for (int a = 0; a < N; a++) {
+                    if (kind == Touch) {
+                        body.velocity[a] = 0;
+                    } else if (vn < 0) {
+                        body.velocity[a] -= k * vn * c->normal[a];
+                    }
+                }
+            }
+            hit.push_back(it->first);
+        }
+    }
+
+    //-- Where movers a and b first touch after tick time t0, with a's
+    //-- collision fields; false when they do not before the end of the tick
+    //-- or already overlap. The test runs in b's frame: a moves by the
+    //-- relative displacement left in the tick, against b held still.
+    bool sweptContact(const SweptMover<N> &a, const SweptMover<N> &b,
+                      double t0, Collision<N> &col)
+    {
+        Box<N> ba, bb;
+        double goal[N];
+        double ta = std::min(t0, a.stop), tb = std::min(t0, b.stop);
+        double ka = (t0 < a.stop) ? 1 : 0, kb = (t0 < b.stop) ? 1 : 0;
+        BUMP_UNROLL
+        for (int i = 0; i < N; i++) {
+            ba.pos[i]  = a.box.pos[i] + a.move[i] * ta;
+            ba.size[i] = a.box.size[i];
+            bb.pos[i]  = b.box.pos[i] + b.move[i] * tb;
+            bb.size[i] = b.box.size[i];
+
+            goal[i] = ba.pos[i] + (ka * a.move[i] - kb * b.move[i]) * (1 - t0);
+        }
+        if (!box_detectCollision<N>(ba, bb, goal, col) || col.overlaps) {
+            return false;
+        }
+        col.ti = t0 + col.ti * (1 - t0);
+        BUMP_UNROLL
+        for (int i = 0; i < N; i++) {
+            col.touch[i] = ba.pos[i] + ka * a.move[i] * (col.ti - t0);
+            col.move[i]  = a.move[i];
+        }
+        col.itemBox  = a.box;
+        col.otherBox = b.box;
+        return true;
+    }
+
+    void sweptSchedule(std::vector<SweptMover<N> > &movers, int i, int j,
+                       double t0, ColFilter *filter,
+                       std::vector<SweptEvent<N> > &events)
+    {
+        if (movers[i].blocked || movers[j].blocked) {
+            return;
+        }
+        int type = filter_apply(filter, movers[i].item, movers[j].item);
+        SweptEvent<N> e;
+        if (type == 0 || !sweptContact(movers[i], movers[j], t0, e.col)) {
+            return;
+        }
+        e.i         = i;
+        e.j         = j;
+        e.vi        = movers[i].version;
+        e.vj        = movers[j].version;
+        e.col.item  = movers[i].item;
+        e.col.other = movers[j].item;
+        e.col.type  = type;
+        events.push_back(e);
+        std::push_heap(events.begin(), events.end(), sweptLater<N>);
+    }
+
+    //-- The built-in response a response type runs, 0 for a custom one
+    int responseKind(int type)
+    {
+        Response<N, T> *response = (type > 0 && type <= Bounce)
+                                       ? builtinResponses[type]
+                                       : getResponseById(type);
+        return response ? response->kind : 0;
+    }
+
+    //-- Turns the ti of cols[first ..], each relative to the projection it
+    //-- came from, into tick time for a projectMove() spanning [0, span] of
+    //-- the tick: every response but cross starts a new projection from its
+    //-- touch over what is left of the span.
+    void sweptTickTimes(std::vector<Collision<N> > &cols, size_t first,
+                        double span)
+    {
+        double start = 0;
+        for (size_t k = first; k < cols.size(); k++) {
+            double t = start + cols[k].ti * span;
+            if (responseKind(cols[k].type) != Cross) {
+                span -= t - start;
+                start = t;
+            }
+            cols[k].ti = t;
+        }
+    }
+
+    //-- Moves count distinct items together over one tick, item i from its
+    //-- box toward goals[N * i ..], with the time of impact between two
+    //-- movers taken from their relative motion, so fast movers meet
+    //-- instead of passing through each other.
+    //-- Contacts are resolved in time order, along with the first static
+    //-- item each mover would stop against. The filter is asked with the
+    //-- earlier mover of a pair as item; a pair it answers Cross for is
+    //-- recorded and keeps going, any other response stops both movers
+    //-- where they touch, and the pairs of a stopped mover are tested again
+    //-- from then on. A mover reaching its static item first leaves the
+    //-- contacts between movers there, its events with the others dropped.
+    //-- Each mover then runs the usual projectMove(), in batch order: toward
+    //-- the point it stopped at when a mover stopped it, toward its goal
+    //-- otherwise, so static items keep their responses. It is tested
+    //-- against the static items and the movers placed before it, except
+    //-- those it has already met.
+    //-- actual receives N numbers per mover and ncols its number of
+    //-- collisions, whose records are appended to cols mover after mover,
+    //-- each mover's ordered by ti in tick time.
+    void moveSwept(const int *items, const double *goals, int count,
+                   ColFilter *filter, double *actual, int *ncols,
+                   std::vector<Collision<N> > &cols)
+    {
+        std::vector<SweptMover<N> > movers(count);
+        std::vector<int> order(count);
+        VisitedFilter others;
+        others.filter = filter;
+        for (int i = 0; i < count; i++) {
+            SweptMover<N> &m = movers[i];
+            m.item           = items[i];
+            m.box            = boxOf(items[i]);
+            m.stop           = 1;
+            m.version        = 0;
+            m.blocked        = false;
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                m.move[a] = goals[N * i + a] - m.box.pos[a];
+                m.lo[a]   = std::min(m.box.pos[a], goals[N * i + a]);
+                m.hi[a]   = std::max(m.box.pos[a], goals[N * i + a]) +
+                          m.box.size[a];
+            }
+            order[i] = i;
+            others.visited.insert(items[i]);
+        }
+
+        //-- the first static item each mover stops against on its way
+        std::vector<SweptEvent<N> > events;
+        for (int i = 0; i < count; i++) {
+            SweptMover<N> &m = movers[i];
+            double probe[N];
+            std::vector<Collision<N> > hits;
+            projectMove(m.item, m.box.pos, m.box.size, goals + N * i, &others,
+                        probe, hits);
+            for (size_t k = 0; k < hits.size(); k++) {
+                if (responseKind(hits[k].type) != Cross) {
+                    SweptEvent<N> e;
+                    e.i   = i;
+                    e.j   = -1;
+                    e.vi  = 0;
+                    e.vj  = 0;
+                    e.col = hits[k];
+                    events.push_back(e);
+                    std::push_heap(events.begin(), events.end(),
+                                   sweptLater<N>);
+                    break;
+                }
+            }
+        }
+
+        //-- candidate pairs: swept boxes overlapping over the whole tick,
+        //-- found by sorting on axis 0 and sweeping
+        SortBySweptLo<N> byLo;
+        byLo.movers = &movers;
+        std::sort(order.begin(), order.end(), byLo);
+        for (int k = 0; k < count; k++) {
+            SweptMover<N> &a = movers[order[k]];
+            for (int l = k + 1;
+                 l < count && movers[order[l]].lo[0] <= a.hi[0]; l++) {
+                const SweptMover<N> &b = movers[order[l]];
+                bool overlap = true;
+                BUMP_UNROLL
+                for (int x = 1; x < N; x++) {
+                    overlap =
+                        overlap && a.lo[x] <= b.hi[x] && b.lo[x] <= a.hi[x];
+                }
+                if (overlap) {
+                    int i = std::min(order[k], order[l]);
+                    int j = std::max(order[k], order[l]);
+                    movers[i].pairs.push_back(j);
+                    movers[j].pairs.push_back(i);
+                    sweptSchedule(movers, i, j, 0, filter, events);
+                }
+            }
+        }
+
+        while (!events.empty()) {
+            std::pop_heap(events.begin(), events.end(), sweptLater<N>);
+            SweptEvent<N> e = events.back();
+            events.pop_back();
+            SweptMover<N> &a = movers[e.i];
+            if (e.j < 0) {
+                if (e.vi == a.version) {
+                    a.stop    = e.col.ti;
+                    a.blocked = true;
+                    a.version++;
+                }
+                continue;
+            }
+            SweptMover<N> &b = movers[e.j];
+            if (e.vi != a.version || e.vj != b.version) {
+                continue;
+            }
+
+            //-- the same contact seen from b
+            double t        = e.col.ti;
+            double tb       = std::min(t, b.stop);
+            Collision<N> cb = e.col;
+            cb.item         = b.item;
+            cb.other        = a.item;
+            cb.itemBox      = b.box;
+            cb.otherBox     = a.box;
+            BUMP_UNROLL
+            for (int x = 0; x < N; x++) {
+                cb.move[x]        = b.move[x];
+                cb.normal[x]      = -e.col.normal[x];
+                cb.touch[x]       = b.box.pos[x] + b.move[x] * tb;
+                cb.response[x]    = cb.touch[x];
+                e.col.response[x] = e.col.touch[x];
+            }
+            a.cols.push_back(e.col);
+            b.cols.push_back(cb);
+            if (e.col.type == Cross) {
+                continue;
+            }
+
+            int stopped[2] = {e.i, e.j};
+            for (int s = 0; s < 2; s++) {
+                SweptMover<N> &m = movers[stopped[s]];
+                if (m.stop > t) {
+                    m.stop = t;
+                }
+                m.version++;
+            }
+            for (int s = 0; s < 2; s++) {
+                int i = stopped[s];
+                for (std::vector<int>::iterator it = movers[i].pairs.begin();
+                     it != movers[i].pairs.end(); it++) {
+                    if (s == 1 && *it == stopped[0]) {
+                        continue; //-- already scheduled from the other side
+                    }
+                    sweptSchedule(movers, std::min(i, *it), std::max(i, *it),
+                                  t, filter, events);
+                }
+            }
+        }
+
+        //-- then each mover in batch order, against the static items and the
+        //-- movers already placed; others holds the movers left out of it
+        double keep[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            keep[a] = -1;
+        }
+        for (int i = 0; i < count; i++) {
+            SweptMover<N> &m = movers[i];
+            double span = m.blocked ? 1 : m.stop;
+            double goal[N];
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                goal[a] = m.box.pos[a] + m.move[a] * span;
+            }
+            std::vector<int> met;
+            for (size_t k = 0; k < m.cols.size(); k++) {
+                if (others.visited.insert(m.cols[k].other).second) {
+                    met.push_back(m.cols[k].other);
+                }
+            }
+
+            size_t first = cols.size();
+            projectMove(m.item, m.box.pos, m.box.size, goal, &others,
+                        actual + N * i, cols);
+            sweptTickTimes(cols, first, span);
+            cols.insert(cols.end(), m.cols.begin(), m.cols.end());
+            std::stable_sort(cols.begin() + first, cols.end(),
+                             sweptEarlier<N>);
+            ncols[i] = cols.size() - first;
+            update(m.item, actual + N * i, keep);
+
+            for (size_t k = 0; k < met.size(); k++) {
+                others.visited.erase(met[k]);
+            }
+            others.visited.erase(m.item);
+        }
+    }
+
+    void check(int item, const double *goal, ColFilter *filter, double *actual,
+               std::vector<Collision<N> > &cols)
+    {
+        Box<N> b = boxOf(item);
+        projectMove(item, b.pos, b.size, goal, filter, actual, cols);
+    }
+
+    void move(int item, const double *goal, ColFilter *filter, double *actual,
+              std::vector<Collision<N> > &cols)
+    {
+        check(item, goal, filter, actual, cols);
+        double keep[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            keep[a] = -1;
+        }
+        update(item, actual, keep);
+    }
+};
+
+template <int N, class T>
+void TouchResponse<N, T>::ComputeResponse(
+    World<N, T> *world, Collision<N> &col, const Box<N> &box, double *goal,
+    ColFilter *filter, std::vector<Collision<N> > &cols)
+{
+    UNUSED(world);
+    UNUSED(box);
+    UNUSED(filter);
+    UNUSED(cols);
+    response_touch<N>(col, goal);
+}
+
+template <int N, class T>
+void CrossResponse<N, T>::ComputeResponse(
+    World<N, T> *world, Collision<N> &col, const Box<N> &box, double *goal,
+    ColFilter *filter, std::vector<Collision<N> > &cols)
+{
+    world->project(col.item, box.pos, box.size, goal, filter, cols);
+}
+
+template <int N, class T>
+void SlideResponse<N, T>::ComputeResponse(
+    World<N, T> *world, Collision<N> &col, const Box<N> &box, double *goal,
+    ColFilter *filter, std::vector<Collision<N> > &cols)
+{
+    response_slide<N>(col, goal);
+    world->project(col.item, col.touch, box.size, goal, filter, cols);
+}
+
+template <int N, class T>
+void BounceResponse<N, T>::ComputeResponse(
+    World<N, T> *world, Collision<N> &col, const Box<N> &box, double *goal,
+    ColFilter *filter, std::vector<Collision<N> > &cols)
+{
+    response_bounce<N>(col, goal);
+    world->project(col.item, col.touch, box.size, goal, filter, cols);
+}
+
+} // namespace bump
@@ -0,0 +1,590 @@
+#pragma once
+
+#include "bump.hpp"
+
+//-- Deterministic fixed-point variant of World<N>, for lockstep simulations
+//-- where every peer must get bit-identical move() results.
+//--
+//-- Boxes have integer coordinates in whatever fixed-point unit the caller
+//-- picks (1/256 px, mm, ...). Cells come from integer division, the time of
+//-- impact is kept as an exact fraction and touch points are rounded by one
+//-- fixed rule, so no floating point is involved anywhere and the results do
+//-- not depend on the compiler, the optimisation level or the FPU.
+//--
+//-- Coordinates and sizes must stay within +-FIXED_LIMIT so that every
+//-- intermediate product fits in 64 bits. In 3D the overlap volume is the
+//-- product of three lengths; keep items under 2^20 units per side there.
+
+namespace bump
+{
+#define FIXED_LIMIT (1 << 27)
+
+/*------------------------------------------
+-- Exact fractions
+------------------------------------------*/
+
+//-- num / den with den >= 0; {+-1, 0} stands for +-infinity
+struct Ratio {
+    long long num;
+    long long den;
+};
+
+static inline Ratio ratio_make(long long num, long long den)
+{
+    Ratio r;
+    r.num = (den < 0) ? -num : num;
+    r.den = (den < 0) ? -den : den;
+    return r;
+}
+
+static inline bool ratio_less(const Ratio &a, const Ratio &b)
+{
+    if (a.den == b.den) {
+        return a.num < b.num;
+    }
+    if (a.den == 0) {
+        return a.num < 0;
+    }
+    if (b.den == 0) {
+        return b.num > 0;
+    }
+    //-- overlap tis are whole (possibly huge) negative volumes, so settle the
+    //-- sign before cross multiplying
+    bool na = a.num < 0, nb = b.num < 0;
+    if (na != nb) {
+        return na;
+    }
+    return a.num * b.den < b.num * a.den;
+}
+
+static inline bool ratio_equal(const Ratio &a, const Ratio &b)
+{
+    return !ratio_less(a, b) && !ratio_less(b, a);
+}
+
+//-- d * r rounded toward zero, or away from zero when outward is set
+static inline long long ratio_scale(long long d, const Ratio &r, bool outward)
+{
+    long long p = d * r.num;
+    long long q = p / r.den;
+    if (outward && (q * r.den != p)) {
+        q += (p < 0) ? -1 : 1;
+    }
+    return q;
+}
+
+/*------------------------------------------
+-- Integer box functions
+------------------------------------------*/
+
+static inline long long fixed_nearest(long long a, long long b)
+{
+    return ((a < 0 ? -a : a) < (b < 0 ? -b : b)) ? a : b;
+}
+
+static inline long long fixed_floorDiv(long long a, long long b)
+{
+    long long q = a / b;
+    return ((a % b != 0) && (a < 0)) ? q - 1 : q;
+}
+
+static inline long long fixed_ceilDiv(long long a, long long b)
+{
+    long long q = a / b;
+    return ((a % b != 0) && (a > 0)) ? q + 1 : q;
+}
+
+template <int N>
+static inline void fixed_toCellBox(int cellSize, const int *pos,
+                                   const int *size, int *c, int *len)
+{
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        c[a]   = fixed_floorDiv(pos[a], cellSize) + 1;
+        len[a] = fixed_ceilDiv((long long)pos[a] + size[a], cellSize) - c[a] + 1;
+    }
+}
+
+static inline bool fixed_clipSide(long long p, long long q, int side,
+                                  Ratio &ti1, Ratio &ti2, int &side1,
+                                  int &side2)
+{
+    if (p == 0) {
+        return q > 0;
+    }
+    Ratio r = ratio_make(q, p);
+    if (p < 0) {
+        if (ratio_less(ti2, r)) {
+            return false;
+        }
+        if (ratio_less(ti1, r)) {
+            ti1   = r;
+            side1 = side;
+        }
+    } else {
+        if (ratio_less(r, ti1)) {
+            return false;
+        }
+        if (ratio_less(r, ti2)) {
+            ti2   = r;
+            side2 = side;
+        }
+    }
+    return true;
+}
+
+//-- Liang-Barsky clip of the segment 0 -> d against the box; n1 is the
+//-- normal of the entry side
+template <int N>
+static bool fixed_getSegmentIntersectionIndices(const long long *pos,
+                                                const long long *size,
+                                                const long long *d, Ratio &ti1,
+                                                Ratio &ti2, int *n1)
+{
+    int side1 = -1, side2 = -1;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        if (!fixed_clipSide(-d[a], -pos[a], 2 * a, ti1, ti2, side1, side2) ||
+            !fixed_clipSide(d[a], pos[a] + size[a], 2 * a + 1, ti1, ti2, side1,
+                            side2)) {
+            return false;
+        }
+    }
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        n1[a] = (side1 >> 1) == a ? ((side1 & 1) ? 1 : -1) : 0;
+    }
+    return true;
+}
+
+template <int N> struct FixedCollision {
+    bool overlaps;
+    int item;
+    int other;
+    int type;
+    Ratio ti;
+    unsigned long long distance; //-- doubled center distance, squared
+    int move[N];
+    int normal[N];
+    int touch[N];
+    int response[N];
+    Box<N, int> itemBox;
+    Box<N, int> otherBox;
+};
+
+template <int N>
+static inline bool collision_before(const FixedCollision<N> &a,
+                                    const FixedCollision<N> &b)
+{
+    if (ratio_equal(a.ti, b.ti)) {
+        return a.distance < b.distance;
+    }
+    return ratio_less(a.ti, b.ti);
+}
+
+//-- Same cases as box_detectCollision. A touch point that falls between two
+//-- units is rounded toward the item's start when tunnelling, so it stops
+//-- short of the other box, and away from it when backing out of an overlap
+template <int N>
+static bool fixed_detectCollision(const Box<N, int> &b1, const Box<N, int> &b2,
+                                  const int *goal, FixedCollision<N> &col)
+{
+    long long d[N], mpos[N], msize[N], p[N];
+    bool moving = false, inside = true;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        d[a]     = (long long)goal[a] - b1.pos[a];
+        moving   = moving || (d[a] != 0);
+        mpos[a]  = (long long)b2.pos[a] - b1.pos[a] - b1.size[a];
+        msize[a] = (long long)b1.size[a] + b2.size[a];
+        inside   = inside && (mpos[a] < 0) && (mpos[a] + msize[a] > 0);
+        p[a]     = fixed_nearest(mpos[a], mpos[a] + msize[a]);
+    }
+
+    Ratio ti;
+    int n[N];
+    long long t[N];
+
+    if (inside) {
+        //-- item was intersecting other; ti is the negative overlap volume
+        long long overlap = 1;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            long long pa = p[a] < 0 ? -p[a] : p[a];
+            overlap *= (b1.size[a] < pa) ? b1.size[a] : pa;
+        }
+        ti = ratio_make(-overlap, 1);
+
+        if (!moving) {
+            //-- not moving - use the minimum displacement vector, along the
+            //-- last of the axes with the smallest displacement
+            int k = 0;
+            BUMP_UNROLL
+            for (int a = 1; a < N; a++) {
+                if ((p[a] < 0 ? -p[a] : p[a]) <= (p[k] < 0 ? -p[k] : p[k])) {
+                    k = a;
+                }
+            }
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                n[a] = (a == k) ? ((p[a] > 0) - (p[a] < 0)) : 0;
+                t[a] = b1.pos[a] + ((a == k) ? p[a] : 0);
+            }
+        } else {
+            //-- moving - move in the opposite direction
+            Ratio ti1 = {-1, 0}, ti2 = {1, 1};
+            if (!fixed_getSegmentIntersectionIndices<N>(mpos, msize, d, ti1,
+                                                        ti2, n)) {
+                return false;
+            }
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                t[a] = b1.pos[a] + ratio_scale(d[a], ti1, true);
+            }
+        }
+    } else {
+        Ratio ti1 = {-1, 0}, ti2 = {1, 0};
+        if (!fixed_getSegmentIntersectionIndices<N>(mpos, msize, d, ti1, ti2,
+                                                    n)) {
+            return false;
+        }
+        //-- item tunnels into other; a segment that only grazes a corner
+        //-- (ti1 == ti2) does not count
+        Ratio zero = {0, 1}, one = {1, 1};
+        if (!(ratio_less(ti1, one) && !ratio_equal(ti1, ti2) &&
+              !ratio_less(ti1, zero))) {
+            return false;
+        }
+        ti = ti1;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            t[a] = b1.pos[a] + ratio_scale(d[a], ti1, false);
+        }
+    }
+
+    unsigned long long distance = 0;
+    BUMP_UNROLL
+    for (int a = 0; a < N; a++) {
+        long long dc = 2 * ((long long)b1.pos[a] - b2.pos[a]) +
+                       ((long long)b1.size[a] - b2.size[a]);
+        distance += (unsigned long long)(dc * dc);
+        col.move[a]   = d[a];
+        col.normal[a] = n[a];
+        col.touch[a]  = t[a];
+    }
+    col.overlaps = inside;
+    col.ti       = ti;
+    col.distance = distance;
+    col.itemBox  = b1;
+    col.otherBox = b2;
+    return true;
+}
+
+/*------------------------------------------
+-- FixedWorld
+------------------------------------------*/
+
+template <int N> struct FixedWorld {
+    int cellSize;
+    int itemId;
+    std::map<int, ColFilter *> filters;
+    std::map<int, Box<N, int> > boxes;
+    CellStore<N> cells;
+#ifdef BUMP_COUNTERS
+    Counters counters;
+#endif
+
+    FixedWorld() : cellSize(64), itemId(0) {}
+
+    void initialize(int cellSize)
+    {
+        this->cellSize = cellSize;
+        this->itemId   = 0;
+
+        filters[Touch]  = new TouchFilter();
+        filters[Cross]  = new CrossFilter();
+        filters[Slide]  = new SlideFilter();
+        filters[Bounce] = new BounceFilter();
+    }
+
+    void release()
+    {
+        for (std::map<int, ColFilter *>::iterator it = filters.begin();
+             it != filters.end(); it++) {
+            delete it->second;
+        }
+        filters.clear();
+
+        this->clear();
+    }
+
+    static bool sortByTiAndDistance(const FixedCollision<N> &a,
+                                    const FixedCollision<N> &b)
+    {
+        return collision_before(a, b);
+    }
+
+    ColFilter *getFilterById(int id)
+    {
+        return filters[id];
+    }
+
+    bool hasItem(int item)
+    {
+        return boxes.find(item) != boxes.end();
+    }
+
+    int countItems()
+    {
+        return boxes.size();
+    }
+
+    int countCells()
+    {
+        return cells.count();
+    }
+
+    void getBox(int item, int *pos, int *size)
+    {
+        const Box<N, int> &b = boxes[item];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            pos[a]  = b.pos[a];
+            size[a] = b.size[a];
+        }
+    }
+
+    void toCell(const int *p, int *c)
+    {
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            c[a] = fixed_floorDiv(p[a], cellSize) + 1;
+        }
+    }
+
+    int allocateId()
+    {
+        if (itemId >= INT_MAX) {
+            itemId = 0;
+        }
+        int nid = (++itemId);
+        while (hasItem(nid)) {
+            nid++;
+        }
+        itemId = nid;
+        return nid;
+    }
+
+    void add(int item, const int *pos, const int *size)
+    {
+        Box<N, int> &b = boxes[item];
+        int lo[N], len[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            b.pos[a]  = pos[a];
+            b.size[a] = size[a];
+        }
+        fixed_toCellBox<N>(cellSize, pos, size, lo, len);
+        grid_addToRange<N>(cells, item, lo, len);
+    }
+
+    void remove(int item)
+    {
+        typename std::map<int, Box<N, int> >::iterator b = boxes.find(item);
+        if (b == boxes.end()) {
+            return;
+        }
+        int lo[N], len[N];
+        fixed_toCellBox<N>(cellSize, b->second.pos, b->second.size, lo, len);
+        grid_removeFromRange<N>(cells, item, lo, len);
+        boxes.erase(b);
+    }
+
+    void clear()
+    {
+        itemId = 0;
+        boxes.clear();
+        cells.clear();
+    }
+
+    //-- sizes that are not positive keep the item's current size
+    void update(int item, const int *pos2, const int *size)
+    {
+        Box<N, int> &b = boxes[item];
+        Box<N, int> b2;
+        bool same = true;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            b2.pos[a]  = pos2[a];
+            b2.size[a] = (size[a] <= 0) ? b.size[a] : size[a];
+            same = same && (b.pos[a] == b2.pos[a]) && (b.size[a] == b2.size[a]);
+        }
+        if (same) {
+            return;
+        }
+
+        int lo1[N], len1[N], lo2[N], len2[N];
+        fixed_toCellBox<N>(cellSize, b.pos, b.size, lo1, len1);
+        fixed_toCellBox<N>(cellSize, b2.pos, b2.size, lo2, len2);
+        grid_moveInRange<N>(cells, item, lo1, len1, lo2, len2);
+        b = b2;
+    }
+
+    void queryBox(const int *pos, const int *size, ItemFilter *filter,
+                  std::set<int> &items)
+    {
+        int c[N], len[N];
+        fixed_toCellBox<N>(cellSize, pos, size, c, len);
+        cells.collect(this, c, len, items);
+        for (std::set<int>::iterator it = items.begin(); it != items.end();) {
+            const Box<N, int> &b = boxes[*it];
+            bool hit = !(filter && !filter->Filter(*it));
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                hit = hit && (pos[a] < (long long)b.pos[a] + b.size[a]) &&
+                      (b.pos[a] < (long long)pos[a] + size[a]);
+            }
+            if (hit) {
+                ++it;
+            } else {
+                items.erase(it++);
+            }
+        }
+    }
+
+    void queryPoint(const int *p, ItemFilter *filter, std::set<int> &items)
+    {
+        int c[N], len[N];
+        toCell(p, c);
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            len[a] = 1;
+        }
+        cells.collect(this, c, len, items);
+        for (std::set<int>::iterator it = items.begin(); it != items.end();) {
+            const Box<N, int> &b = boxes[*it];
+            bool hit = !(filter && !filter->Filter(*it));
+            BUMP_UNROLL
+            for (int a = 0; a < N; a++) {
+                hit = hit && (p[a] > b.pos[a]) &&
+                      (p[a] < (long long)b.pos[a] + b.size[a]);
+            }
+            if (hit) {
+                ++it;
+            } else {
+                items.erase(it++);
+            }
+        }
+    }
+
+    //-- candidates in visited, and item itself, are skipped
+    void project(int item, const int *pos, const int *size, const int *goal,
+                 ColFilter *filter, const std::vector<int> &visited,
+                 std::vector<FixedCollision<N> > &collisions)
+    {
+        CollisionList<FixedCollision<N> > list(collisions);
+        projectInto(item, pos, size, goal, filter, visited, list);
+        std::sort(collisions.begin(), collisions.end(), sortByTiAndDistance);
+    }
+
+    template <class Sink>
+    void projectInto(int item, const int *pos, const int *size,
+                     const int *goal, ColFilter *filter,
+                     const std::vector<int> &visited, Sink &sink)
+    {
+
+        int tpos[N], tsize[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            int t1   = (goal[a] < pos[a]) ? goal[a] : pos[a];
+            int t2   = (goal[a] > pos[a]) ? goal[a] : pos[a];
+            tpos[a]  = t1;
+            tsize[a] = t2 + size[a] - t1;
+        }
+
+        int c[N], len[N];
+        fixed_toCellBox<N>(cellSize, tpos, tsize, c, len);
+        std::set<int> dictItemsInCellBox;
+        cells.collect(this, c, len, dictItemsInCellBox);
+
+        Box<N, int> b;
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            b.pos[a]  = pos[a];
+            b.size[a] = size[a];
+        }
+
+        for (std::set<int>::iterator it = dictItemsInCellBox.begin();
+             it != dictItemsInCellBox.end(); it++) {
+            int other = *it;
+            if (other == item || std::find(visited.begin(), visited.end(),
+                                           other) != visited.end()) {
+                continue;
+            }
+            int responseId = filter_apply(filter, item, other);
+            if (responseId > 0) {
+                FixedCollision<N> col;
+                if (fixed_detectCollision<N>(b, boxes[other], goal, col)) {
+                    col.other = other;
+                    col.item  = item;
+                    col.type  = responseId;
+                    sink(col);
+                }
+            }
+        }
+    }
+
+    void check(int item, const int *goal, ColFilter *filter, int *actual,
+               std::vector<FixedCollision<N> > &cols)
+    {
+        std::vector<int> visited;
+        Box<N, int> b = boxes[item];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            actual[a] = goal[a];
+        }
+
+        FirstCollision<FixedCollision<N> > next;
+        projectInto(item, b.pos, b.size, actual, filter, visited, next);
+
+        while (next.found) {
+            FixedCollision<N> col = next.col;
+            next.found            = false;
+            visited.push_back(col.other);
+
+            switch (col.type) {
+            case Touch:
+                response_touch<N>(col, actual);
+                break;
+            case Cross:
+                projectInto(item, b.pos, b.size, actual, filter, visited, next);
+                break;
+            case Slide:
+                response_slide<N>(col, actual);
+                projectInto(item, col.touch, b.size, actual, filter, visited,
+                            next);
+                break;
+            case Bounce:
+                response_bounce<N>(col, actual);
+                projectInto(item, col.touch, b.size, actual, filter, visited,
+                            next);
+                break;
+            }
+            cols.push_back(col);
+        }
+    }
+
+    void move(int item, const int *goal, ColFilter *filter, int *actual,
+              std::vector<FixedCollision<N> > &cols)
+    {
+        check(item, goal, filter, actual, cols);
+        int keep[N];
+        BUMP_UNROLL
+        for (int a = 0; a < N; a++) {
+            keep[a] = -1;
+        }
+        update(item, actual, keep);
+    }
+};
+
+} // namespace bump
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "bump.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+//-- Binary world snapshots: snapshot_save() writes the item boxes and the
+//-- grid membership of a World<N, T>, snapshot_load() reads the file back
+//-- and rebuilds the world from it in one pass, without recomputing any
+//-- cell range. Both return NULL on success and an error message otherwise.
+//--
+//-- The file is read whole into one buffer and copied into the world's item
+//-- and cell maps; nothing is used in place. Each process that loads a
+//-- snapshot owns its own copy, so memory pages are never shared.
+//--
+//-- The file holds no pointers, only counts and arrays in native byte order,
+//-- each section 8 byte aligned:
+//--
+//--   SnapshotHeader
+//--   int32  ids[items]                  ascending
+//--   Box<N, T> boxes[items]             T is float in a FLOAT32 build
+//--   SnapshotCell<N> cells[cells]       in grid iteration order
+//--   int32  members[sum of cell counts] ascending within each cell
+
+namespace bump
+{
+#define SNAPSHOT_MAGIC "BMPW"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+#define SNAPSHOT_MAX_DIMS 3
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t dims;
+    uint32_t storageSize; //-- sizeof(T)
+    int32_t itemId;
+    double cellSize[SNAPSHOT_MAX_DIMS]; //-- per axis, unused ones are 0
+    uint64_t items;
+    uint64_t cells;
+    uint64_t members;
+};
+
+template <int N> struct SnapshotCell {
+    int32_t c[N];
+    uint32_t count;
+};
+
+static inline size_t snapshot_align(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+template <int N, class T> struct SnapshotLayout {
+    size_t ids, boxes, cells, members, size;
+
+    SnapshotLayout(const SnapshotHeader &h)
+    {
+        ids     = snapshot_align(sizeof(SnapshotHeader));
+        boxes   = snapshot_align(ids + h.items * sizeof(int32_t));
+        cells   = snapshot_align(boxes + h.items * sizeof(Box<N, T>));
+        members = snapshot_align(cells + h.cells * sizeof(SnapshotCell<N>));
+        size    = members + h.members * sizeof(int32_t);
+    }
+};
+
+template <int N> struct SnapshotCellWriter {
+    std::vector<SnapshotCell<N> > cells;
+    std::vector<int32_t> members;
+
+    void operator()(const int *c, Cell &cell)
+    {
+        SnapshotCell<N> sc;
+        memset(&sc, 0, sizeof(sc));
+        for (int a = 0; a < N; a++) {
+            sc.c[a] = c[a];
+        }
+        sc.count = cell.items.size();
+        cells.push_back(sc);
+        members.insert(members.end(), cell.items.begin(), cell.items.end());
+    }
+};
+
+static inline bool snapshot_write(FILE *f, const void *p, size_t n,
+                                  size_t &at)
+{
+    static const char pad[8] = {0};
+    size_t gap = snapshot_align(at) - at;
+    if ((gap && fwrite(pad, 1, gap, f) != gap) ||
+        (n && fwrite(p, 1, n, f) != n)) {
+        return false;
+    }
+    at += gap + n;
+    return true;
+}
+
+template <int N, class T>
+static const char *snapshot_save(World<N, T> &world, const char *path)
+{
+    std::vector<int32_t> ids;
+    std::vector<Box<N, T> > boxes;
+    ids.reserve(world.boxes.size());
+    boxes.reserve(world.boxes.size());
+    for (int id = world.boxes.next(0); id; id = world.boxes.next(id)) {
+        ids.push_back(id);
+        boxes.push_back(*world.boxes.find(id));
+    }
+
+    SnapshotCellWriter<N> w;
+    int c[N];
+    world.cells.visit(c, w);
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, 4);
+    h.version     = SNAPSHOT_VERSION;
+    h.byteOrder   = SNAPSHOT_BYTE_ORDER;
+    h.dims        = N;
+    h.storageSize = sizeof(T);
+    h.itemId      = world.itemId;
+    for (int a = 0; a < N; a++) {
+        h.cellSize[a] = world.cellSize.size[a];
+    }
+    h.items       = ids.size();
+    h.cells       = w.cells.size();
+    h.members     = w.members.size();
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        return "cannot open file for writing";
+    }
+    size_t at = 0;
+    bool ok   = snapshot_write(f, &h, sizeof(h), at) &&
+              snapshot_write(f, ids.data(), ids.size() * sizeof(int32_t), at) &&
+              snapshot_write(f, boxes.data(), boxes.size() * sizeof(Box<N, T>),
+                             at) &&
+              snapshot_write(f, w.cells.data(),
+                             w.cells.size() * sizeof(SnapshotCell<N>), at) &&
+              snapshot_write(f, w.members.data(),
+                             w.members.size() * sizeof(int32_t), at);
+    if (fclose(f) != 0 || !ok) {
+        return "cannot write file";
+    }
+    return NULL;
+}
+
+//-- Fills world, which must be initialized and empty, from a snapshot
+//-- taken with the same number of axes and the same storage type. Boxes go
+//-- straight to the slot of their id and cells are appended in file order,
+//-- so the grid is built without a single search.
+template <int N, class T>
+static const char *snapshot_read(World<N, T> &world, const char *data,
+                                 size_t size)
+{
+    if (size < sizeof(SnapshotHeader)) {
+        return "not a bump snapshot";
+    }
+    SnapshotHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, 4) != 0) {
+        return "not a bump snapshot";
+    }
+    if (h.version != SNAPSHOT_VERSION) {
+        return "unsupported snapshot version";
+    }
+    if (h.byteOrder != SNAPSHOT_BYTE_ORDER) {
+        return "snapshot was written with another byte order";
+    }
+    if (h.dims != N) {
+        return "snapshot has a different number of axes";
+    }
+    if (h.storageSize != sizeof(T)) {
+        return "snapshot has a different storage type (FLOAT32 build?)";
+    }
+    for (int a = 0; a < N; a++) {
+        if (!(h.cellSize[a] > 0)) {
+            return "corrupt snapshot";
+        }
+    }
+    if (h.items > (uint64_t)size || h.cells > (uint64_t)size ||
+        h.members > (uint64_t)size) {
+        return "corrupt snapshot";
+    }
+    SnapshotLayout<N, T> l(h);
+    if (l.size != size) {
+        return "corrupt snapshot";
+    }
+
+    const int32_t *ids       = (const int32_t *)(data + l.ids);
+    const Box<N, T> *boxes   = (const Box<N, T> *)(data + l.boxes);
+    const SnapshotCell<N> *sc = (const SnapshotCell<N> *)(data + l.cells);
+    const int32_t *members   = (const int32_t *)(data + l.members);
+
+    world.clear();
+    world.cellSize.set(h.cellSize);
+    world.itemId = h.itemId;
+
+    for (uint64_t i = 0; i < h.items; i++) {
+        if (ids[i] <= (i > 0 ? ids[i - 1] : 0)) {
+            world.clear();
+            return "corrupt snapshot";
+        }
+        world.boxes[ids[i]] = boxes[i];
+    }
+
+    uint64_t m = 0;
+    for (uint64_t i = 0; i < h.cells; i++) {
+        if (sc[i].count == 0 || sc[i].count > h.members - m) {
+            world.clear();
+            return "corrupt snapshot";
+        }
+        Cell &cell = world.cells.append(sc[i].c);
+        cell.items.reserve(sc[i].count);
+        for (uint32_t k = 0; k < sc[i].count; k++, m++) {
+            //-- a member without a box would read back as an empty one
+            if (world.boxes.find(members[m]) == NULL) {
+                world.clear();
+                return "corrupt snapshot";
+            }
+            cell.insert(members[m]);
+        }
+    }
+    return NULL;
+}
+
+template <int N, class T>
+static const char *snapshot_load(World<N, T> &world, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return "cannot open file for reading";
+    }
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) {
+        fclose(f);
+        return "cannot stat file";
+    }
+    if (st.st_size <= 0) {
+        fclose(f);
+        return "not a bump snapshot";
+    }
+    std::vector<char> data((size_t)st.st_size);
+    size_t n = fread(data.data(), 1, data.size(), f);
+    fclose(f);
+    if (n != data.size()) {
+        return "cannot read file";
+    }
+    return snapshot_read(world, data.data(), data.size());
+}
+
+} // namespace bump
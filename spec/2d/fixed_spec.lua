@@ -0,0 +1,135 @@
+local bump = require('bump2d')
+local test = require('u-test')
+
+local Touch = bump.touch
+local Slide = bump.slide
+
+local world = bump.newFixedWorld(64)
+
+test['fixed world stores integer rects and cells'] = function()
+    local a = world:add(-1, 0, 65, 64)
+    test.equal(world:countItems(), 1)
+    test.equal(world:countCells(), 2) -- x spans cells 0 and 1, y ends on a border
+    test.equal(select(1, world:getRect(a)), -1)
+    test.equal(select(3, world:getRect(a)), 65)
+    test.equal(math.type(select(1, world:getRect(a))), 'integer')
+
+    test.equal(select(1, world:toCell(-1, 0)), 0)
+    test.equal(select(1, world:toCell(0, 0)), 1)
+    test.equal(select(2, world:toCell(64, 63)), 1)
+    test.equal(select(2, world:toCell(64, 64)), 2)
+
+    world:clear()
+end
+
+test['fixed world rejects non-integer and out of range coordinates'] = function()
+    test.error_raised(function() world:add(0.5, 0, 10, 10) end)
+    test.error_raised(function() world:add(0, 0, 0, 10) end)
+    test.error_raised(function() world:add(1 << 30, 0, 10, 10) end)
+    test.equal(world:countItems(), 0)
+end
+
+test['fixed move reports an exact time of impact'] = function()
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(20, 0, 10, 10)
+
+    local x, y, cols, len = world:move(a, 30, 3, Slide)
+    test.equal(len, 1)
+    test.equal(cols[1].other, b)
+    test.equal(cols[1].ti.num * 3, cols[1].ti.den) -- 1/3, not reduced
+    test.equal(cols[1].touch.x, 10)
+    test.equal(cols[1].touch.y, 1)
+    test.equal(cols[1].normal.x, -1)
+    test.equal(cols[1].normal.y, 0)
+    test.equal(x, 10)
+    test.equal(y, 3)
+
+    world:clear()
+end
+
+test['fixed touch points are rounded toward the start of the move'] = function()
+    local a = world:add(0, 0, 10, 10)
+    world:add(20, 0, 10, 10)
+
+    local _, _, cols = world:check(a, 30, 7, Touch)
+    test.equal(cols[1].touch.x, 10)
+    test.equal(cols[1].touch.y, 2) -- 7/3
+    _, _, cols = world:check(a, 30, -7, Touch)
+    test.equal(cols[1].touch.y, -2) -- -7/3
+
+    world:clear()
+end
+
+test['fixed overlaps use the negative overlap area as ti'] = function()
+    local a = world:add(0, 0, 10, 10)
+    world:add(5, 5, 10, 10)
+
+    local x, y, cols, len = world:check(a, 0, 0, Touch)
+    test.equal(len, 1)
+    test.is_true(cols[1].overlaps)
+    test.equal(cols[1].ti.num, -25)
+    test.equal(cols[1].ti.den, 1)
+    test.equal(cols[1].normal.x, 0)
+    test.equal(cols[1].normal.y, -1)
+    test.equal(x, 0)
+    test.equal(y, -5)
+
+    world:clear()
+end
+
+test['fixed queries'] = function()
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(-100, 40, 10, 10)
+    test.equal(#world:queryRect(-200, -200, 400, 400), 2)
+    test.equal(world:queryRect(5, 5, 1, 1)[1], a)
+    test.equal(#world:queryRect(10, 0, 5, 5), 0) -- only touching
+    test.equal(world:queryPoint(-95, 45)[1], b)
+    test.equal(#world:queryPoint(-100, 45), 0) -- on the edge
+
+    world:remove(a)
+    test.is_false(world:hasItem(a))
+    world:update(b, 0, 0)
+    test.equal(select(3, world:getRect(b)), 10)
+    test.equal(world:countCells(), 1)
+
+    world:clear()
+end
+
+-- replays the script of bench/lockstep.cpp; every build on every platform
+-- must produce the same trace
+test['fixed world lockstep trace matches the known answer'] = function()
+    local state = 1
+    local lcg = function(n)
+        state = (state * 1103515245 + 12345) & 0x7fffffff
+        return state % n
+    end
+    local h = 2166136261
+    local fnv = function(v)
+        h = ((h ~ (v & 0xffffffff)) * 16777619) & 0xffffffff
+    end
+
+    local w = bump.newFixedWorld(64)
+    for _ = 1, 40 do
+        local x, y = lcg(1024), lcg(1024)
+        w:add(x, y, 16 + lcg(112), 16 + lcg(112))
+    end
+    for _ = 1, 200 do
+        for i = 1, 40 do
+            local x, y = w:getRect(i)
+            local gx = x + lcg(97) - 48
+            local gy = y + lcg(97) - 48
+            local ax, ay, cols, len = w:move(i, gx, gy, 1 + i % 4)
+            fnv(ax)
+            fnv(ay)
+            for k = 1, len do
+                local col = cols[k]
+                fnv(col.other)
+                fnv(col.ti.num)
+                fnv(col.ti.den)
+                fnv(col.touch.x)
+                fnv(col.touch.y)
+            end
+        end
+    end
+    test.equal(string.format('%08x', h), '51963a4d')
+end
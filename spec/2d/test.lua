@@ -2,4 +2,5 @@ package.cpath = "2d/?.so;" .. package.cpath
 
 require("spec.2d.world_spec")
 require("spec.2d.rect_spec")
-require("spec.2d.responses_spec")
\ No newline at end of file
+require("spec.2d.responses_spec")
+require("spec.2d.fixed_spec")
@@ -21,6 +21,13 @@ local sorted = function(array)
     return array
 end
 
+local same = function(l, r)
+    test.equal(#l, #r)
+    for i = 1, #r do
+        test.equal(l[i], r[i])
+    end
+end
+
 test['creates as many cells as needed to hold the item'] = function()
     world:add(0, 0, 10, 10) -- adss one cell
     test.equal(world:countCells(), 1)
@@ -40,6 +47,28 @@ test['creates as many cells as needed to hold the item'] = function()
     world:clear()
 end
 
+test['reclaims cells emptied by remove and update'] = function()
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(100, 100, 10, 10)
+    test.equal(world:countCells(), 2)
+
+    world:update(a, 300, 300, 64, 64) -- leaves its cell, occupies 4 new ones
+    test.equal(world:countCells(), 5)
+
+    world:remove(b)
+    test.equal(world:countCells(), 4)
+
+    for i = 1, 100 do
+        world:update(a, i * 64, 0, 10, 10) -- walk across 100 cells
+    end
+    test.equal(world:countCells(), 1)
+
+    world:remove(a)
+    test.equal(world:countCells(), 0)
+
+    world:clear()
+end
+
 test['updates the object'] = function()
     local id = world:add(0, 0, 10, 10)
     world:update(id, 40, 40, 20, 20)
@@ -99,6 +128,35 @@ test['querySegment returns the items touched by the segment, sorted by touch ord
     world:clear()
 end
 
+test['querySegment walks every cell of long segments and starts inside items'] = function()
+    local a = world:add(500, 0, 10, 10)
+    local b = world:add(0, 0, 10, 10)
+
+    local items = sorted(world:querySegment(0, 5, 1000, 5))
+    test.equal(#items, 2)
+    test.equal(items[1], a)
+    test.equal(items[2], b)
+
+    items = world:querySegment(1000, 5, 5, 5)
+    test.equal(#items, 2)
+
+    world:clear()
+end
+
+test['move out of an overlap reports the side it backs out through'] = function()
+    local a = world:add(0, 0, 10, 10)
+    world:add(8, 2, 10, 10)
+
+    local x, y, cols, len = world:move(a, 1, 0, Touch)
+    test.equal(len, 1)
+    test.is_true(cols[1].overlaps)
+    test.equal(cols[1].normal.x, -1)
+    test.equal(cols[1].normal.y, 0)
+    test.equal(x, -2)
+
+    world:clear()
+end
+
 test['hasItem returns wether the world has an item'] = function()
     test.is_false(world:hasItem(1))
     world:add(0,0,1,1)
@@ -122,6 +180,72 @@ test['move when there are no collisions'] = function()
     world:clear()
 end
 
+test['queries and move fill and trim caller supplied tables'] = function()
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(20, 0, 10, 10)
+    world:add(40, 0, 10, 10)
+
+    local out = {}
+    local items, len = world:queryRect(0, 0, 64, 64, out)
+    test.equal(items, out)
+    test.equal(len, 3)
+    items, len = world:queryPoint(5, 5, out)
+    test.equal(items, out)
+    test.equal(len, 1)
+    test.is_table(out, {a})
+    items, len = world:querySegment(0, 5, 25, 5, out)
+    test.equal(len, 2)
+    test.is_table(out, {a, b})
+
+    local mover = world:add(20, 20, 10, 10)
+    local cols = {}
+    local _, _, res, n = world:move(mover, 20, 5, Slide, cols)
+    test.equal(res, cols)
+    test.equal(n, 1)
+    local col = cols[1]
+    test.equal(col.other, b)
+    test.is_table(col.slide, {x = 20, y = 10})
+
+    world:update(mover, 20, 20, 10, 10)
+    _, _, res, n = world:move(mover, 20, 5, Touch, cols)
+    test.equal(n, 1)
+    test.equal(cols[1], col) -- the collision table itself is reused
+    test.equal(col.type, Touch)
+    test.is_nil(col.slide)
+
+    _, _, res, n = world:move(mover, 60, 60, Touch, cols)
+    test.equal(n, 0)
+    test.is_nil(cols[1])
+
+    world:clear()
+end
+
+test['moveLazy returns the same collisions as move, field by field'] = function()
+    local w = bump.newWorld()
+    local a = w:add(0, 0, 1, 1)
+    local b = w:add(0, 2, 1, 1)
+
+    local x, y, cols, len = w:moveLazy(a, 0, 5)
+    test.is_table({x, y}, {0, 1})
+    test.equal(len, 1)
+    test.equal(#cols, 1)
+    test.equal(cols:other(1), b)
+    test.equal(cols:item(1), a)
+    test.equal(cols:type(1), Slide)
+    test.is_table({cols:normal(1)}, {0, -1})
+    test.is_table({cols:slide(1)}, {0, 1})
+    test.is_table({cols:otherRect(1)}, {0, 2, 1, 1})
+    test.is_nil(cols:bounce(1))
+    test.is_false(pcall(cols.other, cols, 2))
+
+    x, y, cols, len = w:moveLazy(a, 5, 1)
+    test.is_table({x, y}, {5, 1})
+    test.equal(len, 0)
+    test.equal(#cols, 0)
+
+    test.is_false(pcall(w.moveLazy, w, a, 0, 0, 99))
+end
+
 test['move when touching returns a collision with the first item it touches'] = function()
     local a = world:add(0, 0, 1, 1)
     local b = world:add(0, 2, 1, 1)
@@ -165,6 +289,26 @@ test['move when sliding slides with every element'] = function()
     world:clear()
 end
 
+test['move reports the slide and bounce targets of each collision'] = function()
+    local a = world:add(0, 0, 1, 1)
+    local b = world:add(0, 2, 1, 2)
+
+    local _, _, cols, len = world:move(a, 1, 5, Slide)
+    test.equal(len, 1)
+    test.equal(cols[1].other, b)
+    test.equal(cols[1].slide.x, 1)
+    test.equal(cols[1].slide.y, 1)
+
+    world:update(a, 0, 0, 1, 1)
+    _, _, cols, len = world:move(a, 0, 5, Bounce)
+    test.equal(len, 1)
+    test.equal(cols[1].other, b)
+    test.equal(cols[1].bounce.x, 0)
+    test.equal(cols[1].bounce.y, -3)
+
+    world:clear()
+end
+
 test['move when bouncing bounces on each element'] = function()
     local a = world:add(0, 0, 1, 1)
     local b = world:add(0, 2, 1, 2)
@@ -178,4 +322,613 @@ test['move when bouncing bounces on each element'] = function()
     world:clear()
 end
 
+test['float32 storage stays within float rounding of the double results'] = function()
+    -- a few float ulps at 2^15, i.e. a world tens of km across
+    local eps = bump.float32 and 1 / 256 or 1e-9
+    local near = function(l, r)
+        for i = 1, #r do
+            test.assert(math.abs(l[i] - r[i]) <= eps)
+        end
+    end
+
+    local a = world:add(30000.1, 20000.3, 10.7, 10.7)
+    local b = world:add(30050.3, 19990.1, 5.3, 40.9)
+    near({world:getRect(b)}, {30050.3, 19990.1, 5.3, 40.9})
+
+    local x, y, cols, len = world:move(a, 30100.1, 20005.3, Slide)
+    test.equal(len, 1)
+    test.equal(cols[1].other, b)
+    near({x, y}, {30039.6, 20005.3})
+    near({cols[1].touch.x, cols[1].touch.y}, {30039.6, 20000.3 + 5 * 0.395})
+    near({world:getRect(a)}, {30039.6, 20005.3, 10.7, 10.7})
+
+    local items = world:queryPoint(30050.3 + 0.01, 20000)
+    test.equal(#items, 1)
+    test.equal(items[1], b)
+
+    world:clear()
+end
+
+test['counters report broad and narrow phase work'] = function()
+    if world:counters() == nil then
+        return -- built without BUMP_COUNTERS
+    end
+    local a = world:add(0, 0, 1, 1)
+    world:add(0, 2, 1, 1)
+    world:add(0, 3, 1, 1)
+    world:counters(true)
+
+    world:move(a, 0, 5, Cross)
+    local c = world:counters(true)
+    test.equal(c.detectCalls, 3) -- b and c, then c again after crossing b
+    test.equal(c.detectHits, 3)
+    test.equal(c.responseIters, 2)
+    test.assert(c.cellsVisited > 0)
+    test.assert(c.candidates >= 3)
+
+    c = world:counters()
+    test.equal(c.detectCalls, 0)
+    test.equal(c.responseIters, 0)
+
+    world:querySegment(0, 0, 200, 0)
+    c = world:counters()
+    test.assert(c.traverseSteps >= 2)
+
+    world:clear()
+end
+
 world = nil
+
+test['save and load round-trip items, cells and moves'] = function()
+    local path = os.tmpname()
+    local w1 = bump.newWorld(32)
+    local a = w1:add(-40.5, 10, 100, 20)
+    local b = w1:add(200, -300, 8, 8)
+    w1:remove(w1:add(0, 0, 1, 1))
+    test.is_true(w1:save(path))
+
+    local w2 = bump.load(path)
+    os.remove(path)
+    test.equal(w2:cellSize(), 32)
+    test.equal(w2:countItems(), 2)
+    test.equal(w2:countCells(), w1:countCells())
+    test.equal(select(1, w2:getRect(a)), -40.5)
+    test.equal(select(4, w2:getRect(b)), 8)
+    test.equal(w2:queryPoint(0, 20)[1], a)
+
+    local x1, y1 = w1:move(b, -20, 20)
+    local x2, y2 = w2:move(b, -20, 20)
+    test.equal(x1, x2)
+    test.equal(y1, y2)
+    test.assert(w2:add(0, 0, 1, 1) > b) -- ids keep counting
+
+    local w3, err = bump.load('spec/2d/world_spec.lua')
+    test.is_nil(w3)
+    test.equal(err, 'not a bump snapshot')
+
+    -- the last member of the last cell now names no item
+    test.is_true(w1:save(path))
+    local f = io.open(path, 'rb')
+    local data = f:read('*a')
+    f:close()
+    f = io.open(path, 'wb')
+    f:write(data:sub(1, -5), '\255\255\255\127')
+    f:close()
+    w3, err = bump.load(path)
+    os.remove(path)
+    test.is_nil(w3)
+    test.equal(err, 'corrupt snapshot')
+end
+
+test['addMany and removeMany match add and remove'] = function()
+    local w1, w2 = bump.newWorld(), bump.newWorld()
+    local rects = {}
+    for i = 0, 49 do
+        local x, y, w, h = (i * 37) % 500 - 250, (i * 91) % 300, 5 + i % 80, 3 + i % 50
+        w1:add(x, y, w, h)
+        rects[#rects + 1] = x
+        rects[#rects + 1] = y
+        rects[#rects + 1] = w
+        rects[#rects + 1] = h
+    end
+    local ids, n = w2:addMany(rects)
+    test.equal(n, 50)
+    test.equal(#ids, 50)
+    test.equal(ids[1], 1)
+    test.equal(ids[50], 50)
+    test.equal(w2:countItems(), w1:countItems())
+    test.equal(w2:countCells(), w1:countCells())
+    test.equal(#w2:queryRect(-100, 0, 200, 200), #w1:queryRect(-100, 0, 200, 200))
+    test.equal(select(3, w2:getRect(7)), select(3, w1:getRect(7)))
+    test.equal(w2:add(0, 0, 1, 1), 51)
+
+    local gone = {}
+    for i = 1, 50, 2 do
+        w1:remove(i)
+        gone[#gone + 1] = i
+    end
+    gone[#gone + 1] = 1000 -- not in the world
+    w2:removeMany(gone)
+    w2:remove(51)
+    test.equal(w2:countItems(), 25)
+    test.equal(w2:countCells(), w1:countCells())
+    test.is_false(w2:hasItem(1))
+    test.is_true(w2:hasItem(2))
+
+    test.error_raised(function() w2:addMany({0, 0, 1}) end)
+    test.error_raised(function() w2:addMany({0, 0, 1, 0}) end)
+end
+
+test['items keep their boxes across whole pages of removed ids'] = function()
+    local w = bump.newWorld(64)
+    local rects = {}
+    for i = 1, 1000 do
+        rects[#rects + 1] = i
+        rects[#rects + 1] = 2 * i
+        rects[#rects + 1] = 1
+        rects[#rects + 1] = 1
+    end
+    local ids = w:addMany(rects)
+    local gone = {}
+    for i = 100, 899 do
+        gone[#gone + 1] = ids[i]
+    end
+    w:removeMany(gone)
+    test.equal(w:countItems(), 200)
+    test.is_true(w:hasItem(ids[99]))
+    test.is_false(w:hasItem(ids[500]))
+    same({w:getRect(ids[900])}, {900, 1800, 1, 1})
+    same(sorted(w:queryRect(95, 190, 10, 20)),
+         {ids[95], ids[96], ids[97], ids[98], ids[99]})
+
+    local id = w:add(0, 0, 1, 1)
+    test.equal(id, 1001)
+    w:remove(ids[1000])
+    test.is_false(w:hasItem(ids[1000]))
+    test.is_true(w:hasItem(id))
+end
+
+test['addTilemap merges solid tiles into rects'] = function()
+    local w = bump.newWorld(64)
+    local ids, tiles = w:addTilemap({
+        1, 1, 0, 1,
+        1, 1, 2, 1,
+        0, 0, 0, 1,
+    }, 4, 3, 16, 1) -- 2 is not solid under mask 1
+    test.equal(#ids, 2)
+    test.equal(w:countItems(), 2)
+    local x, y, rw, rh = w:getRect(ids[1])
+    test.equal(x + y, 0)
+    test.equal(rw, 32)
+    test.equal(rh, 32)
+    x, y, rw, rh = w:getRect(ids[2])
+    test.equal(x, 48)
+    test.equal(y, 0)
+    test.equal(rw, 16)
+    test.equal(rh, 48)
+    test.equal(tiles[1], ids[1])
+    test.equal(tiles[6], ids[1])
+    test.equal(tiles[4], ids[2])
+    test.equal(tiles[12], ids[2])
+    test.is_nil(tiles[3])
+    test.is_nil(tiles[7])
+
+    -- a row of tiles is one floor, so nothing snags on the seams
+    local floor = {}
+    for i = 1, 100 do
+        floor[i] = 1
+    end
+    ids = w:addTilemap(floor, 100, 1, 16)
+    test.equal(#ids, 1)
+end
+
+test['rebuild re-buckets items under a new cell size'] = function()
+    local w = bump.newWorld(64)
+    local a = w:add(0, 0, 10, 10)
+    local b = w:add(100, 0, 10, 10)
+    w:add(0, 100, 10, 10)
+    test.equal(w:countCells(), 3)
+
+    test.equal(w:suggestCellSize(), 20)
+    w:queryRect(0, 0, 200, 200)
+    test.equal(w:suggestCellSize(true), 100)
+    test.equal(w:suggestCellSize(), 20)
+
+    w:rebuild(200)
+    test.equal(w:cellSize(), 200)
+    test.equal(w:countCells(), 1)
+    test.is_table({w:getRect(b)}, {100, 0, 10, 10})
+    test.is_table(sorted(w:queryPoint(5, 5)), {a})
+
+    w:rebuild(8)
+    test.equal(w:countCells(), 12)
+    local x, y = w:move(a, 120, 0)
+    test.is_table({x, y}, {90, 0})
+
+    test.error_raised(function() w:rebuild(0) end)
+end
+
+test['cells can be non-square and fractional'] = function()
+    local w = bump.newWorld(50, 10)
+    test.is_table({w:cellSize()}, {50, 10})
+    test.is_table({w:toCell(49.999, 9.999)}, {1, 1})
+    test.is_table({w:toCell(50, 10)}, {2, 2}) -- a border belongs to the next cell
+    test.is_table({w:toCell(-0.001, 0)}, {0, 1})
+    test.is_table({w:toWorld(3, 3)}, {100, 20})
+
+    w:add(0, 0, 100, 5)
+    test.equal(w:countCells(), 2)
+    w:add(50, 10, 50, 10) -- ends on borders, so one cell
+    test.equal(w:countCells(), 3)
+    local a = w:add(0, 30, 10, 10)
+    local b = w:add(0, 55, 10, 10)
+    local x, y, cols, len = w:move(a, 0, 80)
+    test.is_table({x, y}, {0, 45})
+    test.equal(cols[1].other, b)
+
+    -- whatever the rounding of a fractional size, a point lies in the cell
+    -- toWorld() says it does
+    for _, size in ipairs({0.1, 0.3, 1 / 3, 7.7}) do
+        local f = bump.newWorld(size, size * 3)
+        for i = -40, 40 do
+            local px, py = i * 0.1, i * 0.3
+            local cx, cy = f:toCell(px, py)
+            local x1, y1 = f:toWorld(cx, cy)
+            local x2, y2 = f:toWorld(cx + 1, cy + 1)
+            test.is_true(x1 <= px and px < x2)
+            test.is_true(y1 <= py and py < y2)
+        end
+    end
+
+    local path = os.tmpname()
+    test.is_true(w:save(path))
+    local w2 = bump.load(path)
+    os.remove(path)
+    test.is_table({w2:cellSize()}, {50, 10})
+    test.equal(w2:countCells(), w:countCells())
+
+    test.error_raised(function() bump.newWorld(0) end)
+    test.error_raised(function() bump.newWorld(10, -1) end)
+end
+
+test['a bounded world returns what an unbounded one does'] = function()
+    -- the bounds cover only part of the items, the rest overflow
+    local free = bump.newWorld(32)
+    local bounded = bump.newBoundedWorld(-100, -100, 300, 300, 32)
+    local seed = 7
+    local function rnd(n)
+        seed = (seed * 1103515245 + 12345) % 2147483648
+        return seed % n
+    end
+    local function same(a, b)
+        table.sort(a)
+        table.sort(b)
+        test.is_table(a, b)
+    end
+
+    local ids = {}
+    for i = 1, 200 do
+        local x, y, w, h = rnd(800) - 400, rnd(800) - 400, rnd(40) + 1, rnd(40) + 1
+        ids[i] = free:add(x, y, w, h)
+        test.equal(bounded:add(x, y, w, h), ids[i])
+    end
+    test.equal(bounded:countCells(), free:countCells())
+
+    for step = 1, 300 do
+        local id = ids[rnd(#ids) + 1]
+        local gx, gy, kind = rnd(800) - 400, rnd(800) - 400, rnd(4) + 1
+        local x1, y1, c1, n1 = free:move(id, gx, gy, kind)
+        local x2, y2, c2, n2 = bounded:move(id, gx, gy, kind)
+        test.is_table({x2, y2, n2}, {x1, y1, n1})
+        for i = 1, n1 do
+            test.equal(c2[i].other, c1[i].other)
+        end
+        local qx, qy, qw, qh = rnd(800) - 400, rnd(800) - 400, rnd(300) + 1, rnd(300) + 1
+        same(bounded:queryRect(qx, qy, qw, qh), free:queryRect(qx, qy, qw, qh))
+        same(bounded:queryPoint(qx, qy), free:queryPoint(qx, qy))
+        same(bounded:querySegment(qx, qy, qx + qw, qy - qh),
+             free:querySegment(qx, qy, qx + qw, qy - qh))
+    end
+    test.equal(bounded:countCells(), free:countCells())
+
+    bounded:rebuild(50, 20)
+    free:rebuild(50, 20)
+    test.equal(bounded:countCells(), free:countCells())
+    same(bounded:queryRect(-400, -400, 800, 800), free:queryRect(-400, -400, 800, 800))
+
+    -- the live cell count follows batches in and out of the array
+    local half = {}
+    for i = 1, #ids, 2 do
+        half[#half + 1] = ids[i]
+    end
+    bounded:removeMany(half)
+    free:removeMany(half)
+    test.equal(bounded:countCells(), free:countCells())
+    local rects = {-90, -90, 60, 60, 0, 0, 10, 10, 500, 500, 10, 10}
+    bounded:addMany(rects)
+    free:addMany(rects)
+    test.equal(bounded:countCells(), free:countCells())
+
+    local path = os.tmpname()
+    test.is_true(bounded:save(path))
+    local loaded = bump.load(path)
+    os.remove(path)
+    test.equal(loaded:countCells(), free:countCells())
+    same(loaded:queryRect(-100, -100, 300, 300), free:queryRect(-100, -100, 300, 300))
+
+    bounded:clear()
+    test.equal(bounded:countCells(), 0)
+    bounded:add(0, 0, 40, 40)
+    test.equal(bounded:countCells(), 2) -- 50 x 20 cells since the rebuild
+
+    test.error_raised(function() bump.newBoundedWorld(0, 0, 1e9, 1e9, 1) end)
+end
+
+test['moveSwept stops movers where they meet'] = function()
+    local world = bump.newWorld(64)
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(100, 0, 10, 10)
+    local c = world:add(0, 50, 10, 10)
+    local wall = world:add(50, 40, 10, 30)
+
+    -- head-on at the same speed: they meet halfway, at t = 0.45
+    local out, n, cols, len = world:moveSwept({a, 100, 0, b, 0, 0, c, 100, 50})
+    test.equal(n, 3)
+    same(out, {45, 0, 1, 55, 0, 1, 40, 50, 1})
+    test.equal(len, 3)
+    test.equal(cols[1].item, a)
+    test.equal(cols[1].other, b)
+    test.equal(cols[1].ti, 0.45)
+    same({cols[1].normal.x, cols[1].normal.y}, {-1, 0})
+    test.equal(cols[2].item, b)
+    same({cols[2].normal.x, cols[2].normal.y}, {1, 0})
+    -- the static wall keeps its slide response
+    test.equal(cols[3].other, wall)
+    same({world:getRect(a)}, {45, 0, 10, 10})
+    same({world:getRect(b)}, {55, 0, 10, 10})
+
+    -- a mover that stays put still stops the other one
+    local out2 = world:moveSwept({a, 45, 0, b, 0, 0}, nil, out, cols)
+    test.equal(out2, out)
+    same(out, {45, 0, 1, 55, 0, 1})
+
+    -- cross lets them through, recording the contact on both sides
+    local out3, _, cols3, len3 = world:moveSwept({a, 200, 0, b, -100, 0}, bump.cross)
+    same(out3, {200, 0, 1, -100, 0, 1})
+    test.equal(len3, 2)
+    test.equal(cols3[2].other, a)
+
+    test.error_raised(function() world:moveSwept({a, 0, 0, a, 1, 1}) end)
+end
+
+test['moveSwept resolves static items and movers in tick time'] = function()
+    local world = bump.newWorld(64)
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(150, 0, 10, 10)
+    local wall = world:add(50, -20, 10, 50)
+
+    -- a stops at the wall at t = 0.2 and never reaches b
+    local out, n, cols, len = world:moveSwept({a, 200, 0, b, 100, 0})
+    same(out, {40, 0, 1, 100, 0, 0})
+    test.equal(len, 1)
+    test.equal(cols[1].other, wall)
+    test.equal(cols[1].ti, 0.2)
+
+    -- crossing everything, a meets the wall before b
+    world:update(a, 0, 0, 10, 10)
+    world:update(b, 150, 0, 10, 10)
+    out, n, cols, len = world:moveSwept({a, 200, 0, b, 100, 0}, bump.cross)
+    same(out, {200, 0, 2, 100, 0, 1})
+    same(collect(cols, 'other'), {wall, b, a})
+    same(collect(cols, 'ti'), {0.2, 0.56, 0.56})
+
+    -- after the wall a slides up against b, placed before it
+    world:update(a, 0, 0, 10, 10)
+    world:update(b, 40, 200, 10, 10)
+    out, n, cols, len = world:moveSwept({b, 40, 45, a, 60, 40})
+    same(out, {40, 45, 0, 40, 35, 2})
+    same(collect(cols, 'other'), {wall, b})
+    same(collect(cols, 'ti'), {cols[1].ti, 0.875})
+    test.almost_equal(cols[1].ti, 2 / 3, 1e-9)
+end
+
+test['step moves bodies and updates their velocity on contact'] = function()
+    local world = bump.newWorld(64)
+    world:add(40, 100, 160, 10)
+    local a = world:add(0, 0, 10, 10)
+    local b = world:add(50, 80, 10, 10)
+    local c = world:add(150, 0, 10, 10)
+    world:setBody(a, 10, 0, 0, 100)
+    world:setBody(b, 0, 40, 0, 0, bump.bounce)
+    world:setBody(c, 0, 0)
+
+    -- a falls freely, b bounces off the floor, c has nothing to do
+    local hit, n = world:step(1)
+    test.equal(n, 1)
+    test.is_table(hit, {b})
+    test.is_table({world:getRect(a)}, {10, 100, 10, 10})
+    test.is_table({world:getBody(a)}, {10, 100, 0, 100, bump.slide})
+    test.is_table({world:getRect(b)}, {50, 60, 10, 10})
+    test.is_table({world:getBody(b)}, {0, -40, 0, 0, bump.bounce})
+
+    -- above the floor, a lands on it, slides along and stops falling
+    world:update(a, 100, 80, 10, 10)
+    local out = {}
+    hit, n = world:step(1, out)
+    test.equal(hit, out)
+    test.is_table(out, {a})
+    test.is_table({world:getRect(a)}, {110, 90, 10, 10})
+    test.is_table({world:getBody(a)}, {10, 0, 0, 100, bump.slide})
+
+    world:removeBody(c)
+    test.is_nil(world:getBody(c))
+    world:remove(a)
+    test.is_nil(world:getBody(a))
+    test.error_raised(function() world:setBody(a, 1, 1) end)
+    test.error_raised(function() world:setBody(c, 1, 1, 0, 0, 99) end)
+end
+
+test['findPath and flowField search the walkability of the items'] = function()
+    local world = bump.newWorld(64)
+    test.error_raised(function() world:findPath(0, 0, 1, 1) end)
+
+    local agent = world:add(1, 1, 8, 8)
+    local wall = world:add(40, 0, 10, 80)
+    world:setNavigation(0, 0, 100, 100, 10)
+    test.is_false(world:isWalkable(5, 5))
+    world:setPassable(agent)
+    test.is_true(world:isWalkable(5, 5))
+    test.is_false(world:isWalkable(45, 5))
+    test.is_true(world:isWalkable(45, 85))
+    test.is_false(world:isWalkable(-5, 5))
+
+    -- around the bottom of the wall: 8 down, 9 across, 8 up
+    local path, n = world:findPath(5, 5, 95, 5)
+    test.equal(n, 26)
+    test.is_table({path[1], path[2], path[51], path[52]}, {5, 5, 95, 5})
+    for i = 1, 2 * n, 2 do
+        test.is_true(world:isWalkable(path[i], path[i + 1]))
+    end
+
+    local field = world:flowField(95, 5)
+    test.equal(field:distance(5, 5), 25)
+    test.equal(field:distance(field:next(5, 5)), 24)
+    test.is_table({field:next(95, 5)}, {95, 5})
+    test.is_nil(field:next(45, 5))
+
+    -- the bitmap follows updates and removes
+    world:update(wall, 40, 20, 10, 80)
+    local out = {}
+    path, n = world:findPath(5, 5, 95, 5, out)
+    test.equal(path, out)
+    test.equal(n, 10)
+    world:remove(wall)
+    test.is_true(world:isWalkable(45, 50))
+    world:add(90, 0, 10, 10)
+    test.is_nil(world:findPath(5, 5, 95, 5))
+    -- a field keeps what it saw when it was made
+    test.equal(field:distance(5, 5), 25)
+end
+
+test['lineOfSightMany agrees with querySegment'] = function()
+    local world = bump.newWorld(32)
+    local seed = 11
+    local function rnd(n)
+        seed = (seed * 1103515245 + 12345) % 2147483648
+        return seed % n
+    end
+    for i = 1, 60 do
+        world:add(rnd(400), rnd(400), rnd(30) + 1, rnd(30) + 1)
+    end
+
+    local segments = {}
+    for i = 1, 70 do
+        for k = 1, 4 do
+            segments[#segments + 1] = rnd(440) - 20
+        end
+    end
+    local bits, n = world:lineOfSightMany(segments)
+    test.equal(n, 70)
+    test.equal(#bits, 3)
+    for i = 1, n do
+        local s = 4 * (i - 1)
+        local _, hits = world:querySegment(segments[s + 1], segments[s + 2],
+                                           segments[s + 3], segments[s + 4])
+        local clear = (bits[(i - 1) // 32 + 1] >> ((i - 1) % 32)) & 1
+        test.equal(clear, hits == 0 and 1 or 0)
+    end
+
+    -- viewer and target boxes are crossed by the segment between them
+    local viewer = world:add(1000, 0, 10, 10)
+    local target = world:add(1100, 0, 10, 10)
+    local wall = world:add(1050, -50, 10, 30)
+    local sight = {1005, 5, 1105, 5, 1005, 5, 1105, -45}
+    local out = {}
+    bits = world:lineOfSightMany(sight, nil, out)
+    test.equal(bits, out)
+    test.is_table(out, {0})
+    world:lineOfSightMany(sight, {viewer, target}, out)
+    test.is_table(out, {1})
+    world:lineOfSightMany(sight, {viewer, target, wall}, out)
+    test.is_table(out, {3})
+end
+
+test['queryPointMany and firstHitMany answer like queryPoint'] = function()
+    local world = bump.newWorld(32)
+    local seed = 5
+    local function rnd(n)
+        seed = (seed * 1103515245 + 12345) % 2147483648
+        return seed % n
+    end
+    for i = 1, 80 do
+        world:add(rnd(300), rnd(300), rnd(50) + 1, rnd(50) + 1)
+    end
+    local points = {}
+    for i = 1, 200 do
+        points[2 * i - 1], points[2 * i] = rnd(360) - 30, rnd(360) - 30
+    end
+
+    local all, len = world:queryPointMany(points)
+    local first, n = world:firstHitMany(points)
+    test.equal(len, #all)
+    test.equal(n, 200)
+    local k = 1
+    for i = 1, 200 do
+        local items, count = world:queryPoint(points[2 * i - 1], points[2 * i])
+        table.sort(items)
+        test.equal(all[k], count)
+        test.is_table({table.unpack(all, k + 1, k + count)}, items)
+        test.equal(first[i], items[1] or 0)
+        k = k + count + 1
+    end
+
+    local out = {1, 2, 3, 4}
+    test.equal(world:firstHitMany({-100, -100}, out), out)
+    test.is_table(out, {0})
+end
+
+test['queryPolygon and queryOrientedRect run exact tests'] = function()
+    local world = bump.newWorld(16)
+    local corner = world:add(55, 55, 10, 10)
+    local inside = world:add(90, 90, 5, 5)
+    local edge = world:add(120, 70, 20, 10)
+    local touching = world:add(150, 95, 10, 10)
+
+    -- a diamond: its bounding box holds all four, the diamond two of them
+    local diamond = {100, 50, 150, 100, 100, 150, 50, 100}
+    local items, len = world:queryPolygon(diamond)
+    table.sort(items)
+    test.equal(len, 2)
+    test.is_table(items, {inside, edge})
+    local out = {}
+    test.equal(world:queryPolygon({50, 100, 100, 150, 150, 100, 100, 50}, out), out)
+    table.sort(out)
+    test.is_table(out, {inside, edge})
+
+    local side = 50 * math.sqrt(2)
+    items = world:queryOrientedRect(100, 100, side, side, math.pi / 4)
+    table.sort(items)
+    test.is_table(items, {inside, edge})
+    items = world:queryOrientedRect(100, 100, 100, 100, 0)
+    test.equal(#items, 3) -- touching only touches
+
+    -- an axis-aligned polygon finds what queryRect does
+    local seed = 9
+    local function rnd(n)
+        seed = (seed * 1103515245 + 12345) % 2147483648
+        return seed % n
+    end
+    for i = 1, 100 do
+        world:add(rnd(400), rnd(400), rnd(40) + 1, rnd(40) + 1)
+    end
+    for i = 1, 50 do
+        local x, y, w, h = rnd(400) - 20, rnd(400) - 20, rnd(100) + 1, rnd(100) + 1
+        local a = world:queryRect(x, y, w, h)
+        local b = world:queryPolygon({x, y, x + w, y, x + w, y + h, x, y + h})
+        table.sort(a)
+        table.sort(b)
+        test.is_table(b, a)
+    end
+
+    test.error_raised(function() world:queryPolygon({0, 0, 1, 1}) end)
+end
@@ -0,0 +1,73 @@
+local bump = require('bump3d')
+local test = require('u-test')
+
+local cube = bump.cube
+local detect = cube.detectCollision
+
+local same = function(l, r)
+    test.equal(#l, #r)
+    for i = 1, #r do
+        test.equal(l[i], r[i])
+    end
+end
+
+local vec = function(p)
+    return {p.x, p.y, p.z}
+end
+
+test['when itemCube does not intersect otherCube'] = function()
+    test.is_nil(detect(0, 0, 0, 1, 1, 1, 5, 5, 5, 1, 1, 1, 0, 0, 0))
+    test.is_nil(detect(0, 0, 0, 1, 1, 1, 5, 5, 5, 1, 1, 1, 0, 1, 0))
+end
+
+test['returns overlaps, normal, move, ti, touch, itemCube, otherCube'] = function()
+    local c = detect(0, 0, 0, 7, 6, 5, 5, 5, 3, 1, 1, 3, 0, 0, 0)
+
+    test.is_true(c.overlaps)
+    test.equal(c.ti, -4)
+    same(vec(c.move), {0, 0, 0})
+    same(vec(c.normal), {0, -1, 0})
+    same(vec(c.touch), {0, -1, 0})
+    same({c.itemCube.x, c.itemCube.y, c.itemCube.z, c.itemCube.w, c.itemCube.h, c.itemCube.d}, {0, 0, 0, 7, 6, 5})
+    same({c.otherCube.x, c.otherCube.y, c.otherCube.z, c.otherCube.w, c.otherCube.h, c.otherCube.d}, {5, 5, 3, 1, 1, 3})
+end
+
+test['detects collisions from every side'] = function()
+    local cases = {
+        -- item          other      goal       ti   normal
+        {{1, 0, 0}, {5, 0, 0}, {6, 0, 0}, 0.6, {-1, 0, 0}}, -- left
+        {{6, 0, 0}, {1, 0, 0}, {1, 0, 0}, 0.8, {1, 0, 0}}, -- right
+        {{0, 0, 0}, {0, 4, 0}, {0, 5, 0}, 0.6, {0, -1, 0}}, -- top
+        {{0, 4, 0}, {0, 0, 0}, {0, -1, 0}, 0.6, {0, 1, 0}}, -- bottom
+        {{0, 0, 0}, {0, 0, 4}, {0, 0, 5}, 0.6, {0, 0, -1}}, -- front
+        {{0, 0, 4}, {0, 0, 0}, {0, 0, -1}, 0.6, {0, 0, 1}}, -- back
+    }
+    for _, case in ipairs(cases) do
+        local i, o, g = case[1], case[2], case[3]
+        local c = detect(i[1], i[2], i[3], 1, 1, 1, o[1], o[2], o[3], 1, 1, 1, g[1], g[2], g[3])
+        test.is_false(c.overlaps)
+        test.almost_equal(c.ti, case[4], 1e-12)
+        same(vec(c.normal), case[5])
+    end
+end
+
+test['does not get caught by nasty corner cases'] = function()
+    test.is_nil(detect(0, 16, 0, 16, 16, 16, 16, 0, 0, 16, 16, 16, -1, 15, 0))
+end
+
+test['getSegmentIntersectionIndices clips the segment against all six sides'] = function()
+    same({cube.getSegmentIntersectionIndices(0, 0, 0, 10, 10, 10, -5, 5, 5, 15, 5, 5)},
+         {0.25, 0.75, -1, 0, 0, 1, 0, 0})
+    same({cube.getSegmentIntersectionIndices(0, 0, 0, 10, 10, 10, 5, 5, 15, 5, 5, -5)},
+         {0.25, 0.75, 0, 0, 1, 0, 0, -1})
+    test.is_nil(cube.getSegmentIntersectionIndices(0, 0, 0, 10, 10, 10, -5, 5, 12, 15, 5, 12))
+end
+
+test['getDiff, containsPoint, isIntersecting, getCubeDistance'] = function()
+    same({cube.getDiff(0, 0, 0, 2, 3, 4, 10, 10, 10, 1, 1, 1)}, {8, 7, 6, 3, 4, 5})
+    test.is_true(cube.containsPoint(0, 0, 0, 2, 2, 2, 1, 1, 1))
+    test.is_false(cube.containsPoint(0, 0, 0, 2, 2, 2, 1, 1, 2))
+    test.is_true(cube.isIntersecting(0, 0, 0, 2, 2, 2, 1, 1, 1, 2, 2, 2))
+    test.is_false(cube.isIntersecting(0, 0, 0, 2, 2, 2, 1, 1, 2, 2, 2, 2))
+    test.equal(cube.getCubeDistance(0, 0, 0, 1, 1, 1, 1, 2, 2, 1, 1, 1), 9)
+end
@@ -0,0 +1,112 @@
+local bump = require('bump3d')
+local test = require('u-test')
+
+local detect = bump.cube.detectCollision
+
+local same = function(l, r)
+    test.equal(#l, #r)
+    for i = 1, #r do
+        test.equal(l[i], r[i])
+    end
+end
+
+local world = bump.newWorld()
+
+-- the other cube is deep on z, so the 2d cases keep their x,y answers
+local touch = function(x, y, w, h, ox, oy, ow, oh, goalX, goalY)
+    goalX = goalX or x
+    goalY = goalY or y
+    local col = detect(x, y, 0, w, h, 1, ox, oy, -10, ow, oh, 20, goalX, goalY, 0)
+    return {col.touch.x, col.touch.y, col.touch.z, col.normal.x, col.normal.y, col.normal.z}
+end
+
+-- runs the native response: {touch, normal, slide/bounce target, actual}
+local respond = function(kind, x, y, z, w, h, d, ox, oy, oz, ow, oh, od, goalX, goalY, goalZ)
+    world:add(ox, oy, oz, ow, oh, od)
+    local item = world:add(x, y, z, w, h, d)
+    local ax, ay, az, cols, len = world:move(item, goalX, goalY, goalZ, kind)
+    test.equal(len, 1)
+    local col = cols[1]
+    local r = kind == bump.slide and col.slide or col.bounce
+    world:clear()
+    return {col.touch.x, col.touch.y, col.touch.z, col.normal.x, col.normal.y, col.normal.z,
+            r.x, r.y, r.z, ax, ay, az}
+end
+
+local slide = function(x, y, w, h, ox, oy, ow, oh, goalX, goalY)
+    return respond(bump.slide, x, y, 0, w, h, 1, ox, oy, -10, ow, oh, 20, goalX, goalY, 0)
+end
+
+local bounce = function(x, y, w, h, ox, oy, ow, oh, goalX, goalY)
+    return respond(bump.bounce, x, y, 0, w, h, 1, ox, oy, -10, ow, oh, 20, goalX, goalY, 0)
+end
+
+test['returns the left,top,front coordinates of the minimum displacement on static items'] = function()
+    same(touch(-1, -1, 2, 2, 0, 0, 8, 8), {-1, -2, 0, 0, -1, 0}) -- 1
+    same(touch(3, -1, 2, 2, 0, 0, 8, 8), {3, -2, 0, 0, -1, 0}) -- 2
+    same(touch(7, -1, 2, 2, 0, 0, 8, 8), {7, -2, 0, 0, -1, 0}) -- 3
+
+    same(touch(-1, 3, 2, 2, 0, 0, 8, 8), {-2, 3, 0, -1, 0, 0}) -- 4
+    same(touch(3, 3, 2, 2, 0, 0, 8, 8), {3, 8, 0, 0, 1, 0}) -- 5
+    same(touch(7, 3, 2, 2, 0, 0, 8, 8), {8, 3, 0, 1, 0, 0}) -- 6
+
+    same(touch(-1, 7, 2, 2, 0, 0, 8, 8), {-1, 8, 0, 0, 1, 0}) -- 7
+    same(touch(3, 7, 2, 2, 0, 0, 8, 8), {3, 8, 0, 0, 1, 0}) -- 8
+    same(touch(7, 7, 2, 2, 0, 0, 8, 8), {7, 8, 0, 0, 1, 0}) -- 9
+end
+
+test['returns the coordinates of the overlaps with the movement line, opposite direction'] = function()
+    same(touch(3, 3, 2, 2, 0, 0, 8, 8, 4, 3), {-2, 3, 0, -1, 0, 0})
+    same(touch(3, 3, 2, 2, 0, 0, 8, 8, 2, 3), {8, 3, 0, 1, 0, 0})
+    same(touch(3, 3, 2, 2, 0, 0, 8, 8, 3, 4), {3, -2, 0, 0, -1, 0})
+    same(touch(3, 3, 2, 2, 0, 0, 8, 8, 3, 2), {3, 8, 0, 0, 1, 0})
+end
+
+test['returns the coordinates of the item when it starts touching the other, and the normal'] = function()
+    same(touch(-3, 3, 2, 2, 0, 0, 8, 8, 3, 3), {-2, 3, 0, -1, 0, 0})
+    same(touch(9, 3, 2, 2, 0, 0, 8, 8, 3, 3), {8, 3, 0, 1, 0, 0})
+    same(touch(3, -3, 2, 2, 0, 0, 8, 8, 3, 3), {3, -2, 0, 0, -1, 0})
+    same(touch(3, 9, 2, 2, 0, 0, 8, 8, 3, 3), {3, 8, 0, 0, 1, 0})
+end
+
+test['slides on overlaps'] = function()
+    same(slide(3, 3, 2, 2, 0, 0, 8, 8, 4, 5), {0.5, -2, 0, 0, -1, 0, 4, -2, 0, 4, -2, 0})
+    same(slide(3, 3, 2, 2, 0, 0, 8, 8, 5, 4), {-2, 0.5, 0, -1, 0, 0, -2, 4, 0, -2, 4, 0})
+    same(slide(3, 3, 2, 2, 0, 0, 8, 8, 2, 1), {5.5, 8, 0, 0, 1, 0, 2, 8, 0, 2, 8, 0})
+    same(slide(3, 3, 2, 2, 0, 0, 8, 8, 1, 2), {8, 5.5, 0, 1, 0, 0, 8, 2, 0, 8, 2, 0})
+end
+
+test['slides over tunnels'] = function()
+    same(slide(10, 10, 2, 2, 0, 0, 8, 8, 1, 4), {7, 8, 0, 0, 1, 0, 1, 8, 0, 1, 8, 0})
+    same(slide(10, 10, 2, 2, 0, 0, 8, 8, 4, 1), {8, 7, 0, 1, 0, 0, 8, 1, 0, 8, 1, 0})
+
+    -- perfect corner case:
+    same(slide(10, 10, 2, 2, 0, 0, 8, 8, 1, 1), {8, 8, 0, 1, 0, 0, 8, 1, 0, 8, 1, 0})
+end
+
+test['slides along a floor keeping the two free axes'] = function()
+    same(respond(bump.slide, 0, 0, 0, 1, 1, 1, -10, -10, 2, 20, 20, 1, 2, 4, 4),
+         {0.5, 1, 1, 0, 0, -1, 2, 4, 1, 2, 4, 1})
+end
+
+test['bounces on overlaps'] = function()
+    same(bounce(3, 3, 2, 2, 0, 0, 8, 8, 4, 5), {0.5, -2, 0, 0, -1, 0, 4, -9, 0, 4, -9, 0})
+    same(bounce(3, 3, 2, 2, 0, 0, 8, 8, 5, 4), {-2, 0.5, 0, -1, 0, 0, -9, 4, 0, -9, 4, 0})
+    same(bounce(3, 3, 2, 2, 0, 0, 8, 8, 2, 1), {5.5, 8, 0, 0, 1, 0, 2, 15, 0, 2, 15, 0})
+    same(bounce(3, 3, 2, 2, 0, 0, 8, 8, 1, 2), {8, 5.5, 0, 1, 0, 0, 15, 2, 0, 15, 2, 0})
+end
+
+test['bounces over tunnels'] = function()
+    same(bounce(10, 10, 2, 2, 0, 0, 8, 8, 1, 4), {7, 8, 0, 0, 1, 0, 1, 12, 0, 1, 12, 0})
+    same(bounce(10, 10, 2, 2, 0, 0, 8, 8, 4, 1), {8, 7, 0, 1, 0, 0, 12, 1, 0, 12, 1, 0})
+
+    -- perfect corner case:
+    same(bounce(10, 10, 2, 2, 0, 0, 8, 8, 1, 1), {8, 8, 0, 1, 0, 0, 15, 1, 0, 15, 1, 0})
+end
+
+test['bounces off a floor'] = function()
+    same(respond(bump.bounce, 0, 0, 0, 1, 1, 1, -10, -10, 2, 20, 20, 1, 2, 4, 4),
+         {0.5, 1, 1, 0, 0, -1, 2, 4, -2, 2, 4, -2})
+end
+
+world = nil
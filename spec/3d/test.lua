@@ -0,0 +1,5 @@
+package.cpath = "3d/?.so;" .. package.cpath
+
+require("spec.3d.world_spec")
+require("spec.3d.cube_spec")
+require("spec.3d.responses_spec")
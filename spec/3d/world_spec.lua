@@ -0,0 +1,455 @@
+local bump = require('bump3d')
+local test = require('u-test')
+
+local Touch = bump.touch
+local Cross = bump.cross
+local Slide = bump.slide
+local Bounce = bump.bounce
+
+local world = bump.newWorld()
+
+local collect = function(t, field_name)
+    local res = {}
+    for i, v in ipairs(t) do
+        res[i] = v[field_name]
+    end
+    return res
+end
+
+local sorted = function(array)
+    table.sort(array)
+    return array
+end
+
+local same = function(l, r)
+    test.equal(#l, #r)
+    for i = 1, #r do
+        test.equal(l[i], r[i])
+    end
+end
+
+test['creates as many cells as needed to hold the item'] = function()
+    world:add(0, 0, 0, 10, 10, 10) -- adds one cell
+    test.equal(world:countCells(), 1)
+
+    world:add(100, 100, 100, 10, 10, 10) -- adds a separate single cell
+    test.equal(world:countCells(), 2)
+
+    world:add(0, 0, 0, 100, 10, 10) -- occupies 2 cells, but just adds one (the other is already added)
+    test.equal(world:countCells(), 3)
+
+    world:add(0, 0, 0, 100, 10, 10) -- occupies 2 cells, but just adds one (the other is already added)
+    test.equal(world:countCells(), 3)
+
+    world:add(300, 300, 300, 64, 64, 64) -- adds 8 new cells
+    test.equal(world:countCells(), 11)
+
+    world:clear()
+end
+
+test['reclaims cells emptied by remove and update'] = function()
+    local a = world:add(0, 0, 0, 10, 10, 10)
+    local b = world:add(100, 100, 100, 10, 10, 10)
+    test.equal(world:countCells(), 2)
+
+    world:update(a, 300, 300, 300, 64, 64, 64) -- leaves its cell, occupies 8 new ones
+    test.equal(world:countCells(), 9)
+
+    world:remove(b)
+    test.equal(world:countCells(), 8)
+
+    for i = 1, 100 do
+        world:update(a, i * 64, 0, 0, 10, 10, 10) -- walk across 100 cells
+    end
+    test.equal(world:countCells(), 1)
+
+    world:remove(a)
+    test.equal(world:countCells(), 0)
+
+    world:clear()
+end
+
+test['updates the object'] = function()
+    local id = world:add(0, 0, 0, 10, 10, 10)
+    world:update(id, 40, 40, 40, 20, 20, 20)
+    same({world:getCube(id)}, {40, 40, 40, 20, 20, 20})
+
+    world:update(id, 40, 40, 90) -- only z changes, the size is kept
+    same({world:getCube(id)}, {40, 40, 90, 20, 20, 20})
+
+    world:update(id, 41, 40, 90) -- stays in the same cells
+    same({world:getCube(id)}, {41, 40, 90, 20, 20, 20})
+    world:clear()
+end
+
+test['add and update validate their arguments'] = function()
+    test.error_raised(function() world:add(0, 0, 0, 0, 1, 1) end, 'w must be a positive number')
+    test.error_raised(function() world:add(0, 0, 'z', 1, 1, 1) end, 'z must be a number')
+    test.error_raised(function() world:remove(12345) end, 'Item 12345 must be added')
+
+    local id = world:add(0, 0, 0, 0.5, 0.5, 0.5) -- fractional sizes are fine
+    same({world:getCube(id)}, {0, 0, 0, 0.5, 0.5, 0.5})
+    test.error_raised(function() world:update(id, 0, 0, 0, 1, -1, 1) end, 'h must be a positive number')
+    world:clear()
+end
+
+test['queryCube returns nothing when the world is empty'] = function()
+    local items, len = world:queryCube(0, 0, 0, 1, 1, 1)
+    same(items, {})
+    test.equal(len, 0)
+end
+
+test['queryCube when the world has items'] = function()
+    local a = world:add(10, 0, 0, 10, 10, 10)
+    local b = world:add(70, 0, 0, 10, 10, 10)
+    local c = world:add(50, 0, 0, 10, 10, 10)
+    local d = world:add(90, 0, 0, 10, 10, 10)
+
+    same(sorted(world:queryCube(55, 5, 5, 20, 20, 20)), sorted({b, c}))
+    same(sorted(world:queryCube(0, 5, 5, 100, 20, 20)), sorted({a, b, c, d}))
+    same(world:queryCube(0, 5, 50, 100, 20, 20), {})
+
+    world:clear()
+end
+
+test['queryPoint returns the items inside/partially inside the given point'] = function()
+    local a = world:add(10, 0, 0, 10, 10, 10)
+    local b = world:add(15, 0, 0, 10, 10, 10)
+    local c = world:add(20, 0, 0, 10, 10, 10)
+
+    same(sorted(world:queryPoint(4, 5, 5)), {})
+    same(sorted(world:queryPoint(14, 5, 5)), {a})
+    same(sorted(world:queryPoint(16, 5, 5)), {a, b})
+    same(sorted(world:queryPoint(21, 5, 5)), {b, c})
+    same(sorted(world:queryPoint(26, 5, 5)), {c})
+    same(sorted(world:queryPoint(31, 5, 5)), {})
+    same(sorted(world:queryPoint(16, 5, 11)), {})
+
+    world:clear()
+end
+
+test['querySegment returns the items touched by the segment, sorted by touch order'] = function()
+    local a = world:add(5, 0, 0, 5, 10, 10)
+    local b = world:add(15, 0, 0, 5, 10, 10)
+    local c = world:add(25, 0, 0, 5, 10, 10)
+
+    same(world:querySegment(0, 5, 5, 11, 5, 5), {a})
+    same(world:querySegment(0, 5, 5, 17, 5, 5), {a, b})
+    same(world:querySegment(0, 5, 5, 30, 5, 5), {a, b, c})
+    same(world:querySegment(17, 5, 5, 26, 5, 5), {b, c})
+    same(world:querySegment(22, 5, 5, 26, 5, 5), {c})
+
+    same(world:querySegment(11, 5, 5, 0, 5, 5), {a})
+    same(world:querySegment(17, 5, 5, 0, 5, 5), {b, a})
+    same(world:querySegment(30, 5, 5, 0, 5, 5), {c, b, a})
+    same(world:querySegment(26, 5, 5, 17, 5, 5), {c, b})
+    same(world:querySegment(26, 5, 5, 22, 5, 5), {c})
+
+    same(world:querySegment(0, 5, 20, 30, 5, 20), {})
+
+    world:clear()
+end
+
+test['querySegment walks every cell of long segments'] = function()
+    local a = world:add(500, 0, 300, 10, 10, 10)
+    same(world:querySegment(0, 5, 5, 1000, 5, 605), {a})
+    same(world:querySegment(1000, 5, 605, 0, 5, 5), {a})
+    world:clear()
+end
+
+test['querySegmentWithCoords returns where the segment enters and leaves each item'] = function()
+    local a = world:add(5, 0, 0, 5, 10, 10)
+    local infos, len = world:querySegmentWithCoords(0, 5, 5, 20, 5, 5)
+    test.equal(len, 1)
+    test.equal(infos[1].item, a)
+    same({infos[1].x1, infos[1].y1, infos[1].z1}, {5, 5, 5})
+    same({infos[1].x2, infos[1].y2, infos[1].z2}, {10, 5, 5})
+    world:clear()
+end
+
+test['hasItem returns wether the world has an item'] = function()
+    test.is_false(world:hasItem(1))
+    world:add(0, 0, 0, 1, 1, 1)
+    test.is_true(world:hasItem(1))
+    world:clear()
+end
+
+test['countItems'] = function()
+    world:add(1, 1, 1, 1, 1, 1)
+    world:add(2, 2, 2, 2, 2, 2)
+    test.equal(world:countItems(), 2)
+
+    world:clear()
+end
+
+test['toCell and toWorld'] = function()
+    same({world:toCell(0, 63, 64)}, {1, 1, 2})
+    same({world:toCell(-1, -64, -65)}, {0, 0, -1})
+    same({world:toWorld(1, 2, 0)}, {0, 64, -64})
+end
+
+test['move when there are no collisions'] = function()
+    local item = world:add(0, 0, 0, 1, 1, 1)
+    local x, y, z, cols, len = world:move(item, 1, 1, 1)
+    same({x, y, z}, {1, 1, 1})
+    same(cols, {})
+    test.equal(len, 0)
+
+    world:clear()
+end
+
+test['move when touching returns a collision with the first item it touches'] = function()
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    local b = world:add(0, 2, 0, 1, 1, 1)
+    world:add(0, 3, 0, 1, 1, 1)
+
+    local x, y, z, cols, len = world:move(a, 0, 5, 0, Touch)
+    same({x, y, z}, {0, 1, 0})
+    test.equal(1, len)
+    same(collect(cols, 'other'), {b})
+    same(collect(cols, 'type'), {Touch})
+    same({world:getCube(a)}, {0, 1, 0, 1, 1, 1})
+
+    world:clear()
+end
+
+test['move when crossing returns a collision with every item it crosses'] = function()
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    local b = world:add(0, 0, 2, 1, 1, 1)
+    local c = world:add(0, 0, 3, 1, 1, 1)
+    local x, y, z, cols, len = world:move(a, 0, 0, 5, Cross)
+    same({x, y, z}, {0, 0, 5})
+    test.equal(2, len)
+    same(collect(cols, 'other'), {b, c})
+    same(collect(cols, 'type'), {Cross, Cross})
+    same({world:getCube(a)}, {0, 0, 5, 1, 1, 1})
+
+    world:clear()
+end
+
+test['move when sliding slides with every element'] = function()
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    world:add(0, 2, 0, 1, 2, 1)
+    local c = world:add(2, 1, 0, 1, 1, 1)
+    local x, y, z, cols, len = world:move(a, 5, 5, 0, Slide)
+    same({x, y, z}, {1, 5, 0})
+    test.equal(1, len)
+    same(collect(cols, 'other'), {c})
+    same(collect(cols, 'type'), {Slide})
+    same({world:getCube(a)}, {1, 5, 0, 1, 1, 1})
+
+    world:clear()
+end
+
+test['move when bouncing bounces on each element'] = function()
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    local b = world:add(0, 2, 0, 1, 2, 1)
+    local x, y, z, cols, len = world:move(a, 0, 5, 0, Bounce)
+    same({x, y, z}, {0, -3, 0})
+    test.equal(1, len)
+    same(collect(cols, 'other'), {b})
+    same(collect(cols, 'type'), {Bounce})
+    same({cols[1].bounce.x, cols[1].bounce.y, cols[1].bounce.z}, {0, -3, 0})
+    same({world:getCube(a)}, {0, -3, 0, 1, 1, 1})
+
+    world:clear()
+end
+
+test['check resolves a move without committing it'] = function()
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    local b = world:add(0, 2, 0, 1, 1, 1)
+    local x, y, z, cols, len = world:check(a, 0, 5, 0, Touch)
+    same({x, y, z}, {0, 1, 0})
+    test.equal(len, 1)
+    test.equal(cols[1].other, b)
+    same({world:getCube(a)}, {0, 0, 0, 1, 1, 1})
+
+    local _, plen = world:project(a, 0, 0, 0, 1, 1, 1, 0, 5, 0, Cross)
+    test.equal(plen, 1)
+
+    world:clear()
+end
+
+test['queries and moves fill and trim caller supplied tables'] = function()
+    local a = world:add(0, 0, 0, 10, 10, 10)
+    local b = world:add(20, 0, 0, 10, 10, 10)
+    world:add(40, 0, 0, 10, 10, 10)
+
+    local out = {}
+    local items, len = world:queryCube(0, 0, 0, 64, 64, 64, out)
+    test.equal(items, out)
+    test.equal(len, 3)
+    items, len = world:queryPoint(5, 5, 5, out)
+    test.equal(items, out)
+    test.equal(len, 1)
+    same(out, {a})
+
+    local mover = world:add(20, 20, 0, 10, 10, 10)
+    local cols = {}
+    local _, _, _, res, n = world:move(mover, 20, 5, 0, Slide, cols)
+    test.equal(res, cols)
+    test.equal(n, 1)
+    local col = cols[1]
+    test.equal(col.other, b)
+    same({col.slide.x, col.slide.y, col.slide.z}, {20, 10, 0})
+
+    world:update(mover, 20, 20, 0)
+    _, _, _, res, n = world:move(mover, 20, 5, 0, Touch, cols)
+    test.equal(n, 1)
+    test.equal(cols[1], col) -- the collision table itself is reused
+    test.equal(col.type, Touch)
+    test.is_nil(col.slide)
+
+    world:update(mover, 20, 20, 0)
+    _, _, _, res, n = world:move(mover, 20, 30, 0, Touch, cols)
+    test.equal(n, 0)
+    test.is_nil(cols[1])
+
+    world:clear()
+end
+
+test['moveMany moves a packed batch of items'] = function()
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    world:add(0, 2, 0, 1, 1, 1)
+    local c = world:add(10, 10, 10, 1, 1, 1)
+
+    local out = {}
+    local res, n = world:moveMany({a, 0, 5, 0, c, 11, 12, 13}, Touch, out)
+    test.equal(res, out)
+    test.equal(n, 2)
+    same(out, {0, 1, 0, 1, 11, 12, 13, 0})
+    same({world:getCube(c)}, {11, 12, 13, 1, 1, 1})
+
+    world:moveMany({c, 11, 12, 14}, Touch, out)
+    same(out, {11, 12, 14, 0})
+
+    test.error_raised(function() world:moveMany({a, 0, 5}) end, 'expected {item, x, y, z, ...}')
+
+    world:clear()
+end
+
+test['query*Many answer packed batches of queries'] = function()
+    local a = world:add(5, 0, 0, 5, 10, 10)
+    local b = world:add(15, 0, 0, 5, 10, 10)
+
+    local out = {}
+    local res, n = world:queryCubeMany({0, 0, 0, 12, 10, 10, 100, 0, 0, 1, 1, 1}, out)
+    test.equal(res, out)
+    test.equal(n, 3)
+    same(out, {1, a, 0})
+
+    world:queryPointMany({6, 5, 5, 16, 5, 5, 12, 5, 5}, out)
+    same(out, {1, a, 1, b, 0})
+
+    world:querySegmentMany({30, 5, 5, 0, 5, 5, 0, 5, 5, 11, 5, 5}, out)
+    same(out, {2, b, a, 1, a})
+
+    world:clear()
+end
+
+test['float32 storage stays within float rounding of the double results'] = function()
+    -- a few float ulps at 2^15, i.e. a world tens of km across
+    local eps = bump.float32 and 1 / 256 or 1e-9
+    local near = function(l, r)
+        for i = 1, #r do
+            test.assert(math.abs(l[i] - r[i]) <= eps)
+        end
+    end
+
+    local a = world:add(30000.1, 20000.3, 10000.7, 10.7, 10.7, 10.7)
+    local b = world:add(30050.3, 19990.1, 9990.3, 5.3, 40.9, 40.9)
+    near({world:getCube(b)}, {30050.3, 19990.1, 9990.3, 5.3, 40.9, 40.9})
+
+    local x, y, z, cols, len = world:move(a, 30100.1, 20005.3, 10002.7, Slide)
+    test.equal(len, 1)
+    test.equal(cols[1].other, b)
+    near({x, y, z}, {30039.6, 20005.3, 10002.7})
+    near({cols[1].touch.x, cols[1].touch.y, cols[1].touch.z},
+         {30039.6, 20000.3 + 5 * 0.395, 10000.7 + 2 * 0.395})
+    near({world:getCube(a)}, {30039.6, 20005.3, 10002.7, 10.7, 10.7, 10.7})
+
+    local items, n = world:queryPoint(30050.3 + 0.01, 20000, 10000)
+    test.equal(n, 1)
+    test.equal(items[1], b)
+
+    world:clear()
+end
+
+test['counters report broad and narrow phase work'] = function()
+    if world:counters() == nil then
+        return -- built without BUMP_COUNTERS
+    end
+    local a = world:add(0, 0, 0, 1, 1, 1)
+    world:add(0, 2, 0, 1, 1, 1)
+    world:add(0, 3, 0, 1, 1, 1)
+    world:counters(true)
+
+    world:move(a, 0, 5, 0, Cross)
+    local c = world:counters(true)
+    test.equal(c.detectCalls, 3) -- b and c, then c again after crossing b
+    test.equal(c.detectHits, 3)
+    test.equal(c.responseIters, 2)
+
+    world:querySegment(0, 0, 0, 200, 0, 0)
+    c = world:counters()
+    test.equal(c.traverseSteps, 4)
+
+    world:clear()
+end
+
+test['save and load round-trip items, cells and moves'] = function()
+    local path = os.tmpname()
+    local w1 = bump.newWorld(32)
+    local a = w1:add(-40.5, 10, 3, 100, 20, 5)
+    local b = w1:add(200, -300, 64, 8, 8, 8)
+    test.is_true(w1:save(path))
+
+    local w2 = bump.load(path)
+    os.remove(path)
+    test.equal(w2:cellSize(), 32)
+    test.equal(w2:countItems(), 2)
+    test.equal(w2:countCells(), w1:countCells())
+    same({w2:getCube(a)}, {-40.5, 10, 3, 100, 20, 5})
+    test.equal(w2:queryPoint(0, 20, 4)[1], a)
+    local x1, y1, z1 = w1:move(b, -20, 20, 0)
+    local x2, y2, z2 = w2:move(b, -20, 20, 0)
+    same({x2, y2, z2}, {x1, y1, z1})
+
+    local w3, err = bump.load('spec/3d/world_spec.lua')
+    test.is_nil(w3)
+    test.equal(err, 'not a bump snapshot')
+end
+
+test['addMany and removeMany match add and remove'] = function()
+    local w1, w2 = bump.newWorld(), bump.newWorld()
+    local cubes = {}
+    for i = 0, 49 do
+        local c = {(i * 37) % 500 - 250, (i * 91) % 300, (i * 13) % 200,
+                   5 + i % 80, 3 + i % 50, 1 + i % 70}
+        w1:add(table.unpack(c))
+        for k = 1, 6 do
+            cubes[#cubes + 1] = c[k]
+        end
+    end
+    local out = {'stale', 'stale', [51] = 'stale'}
+    local ids, n = w2:addMany(cubes, out)
+    test.equal(ids, out)
+    test.equal(n, 50)
+    test.equal(#ids, 50)
+    test.equal(ids[50], 50)
+    test.is_nil(ids[51])
+    test.equal(w2:countCells(), w1:countCells())
+    same({w2:getCube(9)}, {w1:getCube(9)})
+
+    local gone = {}
+    for i = 1, 50, 2 do
+        w1:remove(i)
+        gone[#gone + 1] = i
+    end
+    w2:removeMany(gone)
+    test.equal(w2:countItems(), 25)
+    test.equal(w2:countCells(), w1:countCells())
+    test.error_raised(function() w2:addMany({0, 0, 0, 1, 1, -1}) end)
+end
+
+world = nil